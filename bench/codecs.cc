@@ -0,0 +1,143 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "../tests/synthetic.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+
+using namespace odim_h5;
+
+/* Measures write and read throughput of each compression codec on synthetic sweeps.  Reads are timed both
+ * for the raw stored values and for unpacking to float, which runs the unpack kernel chosen for this CPU.
+ * Throughput is measured against the uncompressed size of the stored values.  Codecs provided by filter
+ * plugins are reported as unavailable when the plugin can't be loaded.
+ *
+ * usage: bench_codecs [iterations]
+ */
+
+namespace
+{
+  struct codec_case
+  {
+    const char*         name;
+    compression_policy  policy;
+  };
+}
+
+template <typename F>
+static auto time_it(size_t iterations, F func) -> double
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i)
+    func(i);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// read every layer in its storage type so that no conversion is included in the timing
+static auto read_raw(const file& f) -> void
+{
+  std::vector<uint8_t> u8;
+  std::vector<uint16_t> u16;
+  for (size_t i = 0; i < f.dataset_count(); ++i)
+  {
+    auto dset = f.dataset_open(i);
+    for (size_t j = 0; j < dset.data_count(); ++j)
+    {
+      auto layer = dset.data_open(j);
+      if (layer.type() == data::data_type::u8)
+      {
+        u8.resize(layer.size());
+        layer.read(u8.data());
+      }
+      else
+      {
+        u16.resize(layer.size());
+        layer.read(u16.data());
+      }
+    }
+  }
+}
+
+static auto kernel_target() -> const char*
+{
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+  if (__builtin_cpu_supports("avx512f"))
+    return "avx512f";
+  if (__builtin_cpu_supports("avx2"))
+    return "avx2";
+#endif
+  return "default";
+}
+
+int main(int argc, char* argv[])
+{
+  const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 8;
+  const synthetic::shape shp{10, 360, 1000};
+  const double raw_bytes = double(shp.scans) * shp.rays * shp.bins * (sizeof(uint8_t) + sizeof(uint16_t));
+
+  const codec_case cases[] =
+  {
+      { "none",           compression_policy{0} }
+    , { "deflate 6",      compression_policy{compression_policy::codec::deflate, 6} }
+    , { "fast",           compression_policy::fast() }
+    , { "balanced",       compression_policy::balanced() }
+    , { "archive",        compression_policy::archive() }
+    , { "lz4",            compression_policy{compression_policy::codec::lz4, 0, true} }
+    , { "zstd 3",         compression_policy{compression_policy::codec::zstd, 3, true} }
+  };
+
+  printf("unpack kernels: %s\n", kernel_target());
+  printf("%-12s %8s %12s %12s %12s\n", "codec", "ratio", "write MB/s", "read MB/s", "unpack MB/s");
+  for (auto& c : cases)
+  {
+    const std::string path = "bench_codecs.h5";
+    try
+    {
+      auto write_secs = time_it(iterations, [&](size_t i)
+      {
+        polar_volume vol{path, file::io_mode::create};
+        synthetic::write_volume(vol, shp, i, c.policy);
+      });
+
+      struct stat st;
+      if (stat(path.c_str(), &st) != 0)
+        throw std::runtime_error{"failed to stat " + path};
+
+      polar_volume vol{path, file::io_mode::read_only};
+      auto read_secs = time_it(iterations, [&](size_t) { read_raw(vol); });
+      auto unpack_secs = time_it(iterations, [&](size_t) { synthetic::checksum(vol); });
+
+      printf(
+            "%-12s %8.2f %12.1f %12.1f %12.1f\n"
+          , c.name
+          , raw_bytes / st.st_size
+          , raw_bytes * iterations / write_secs / 1e6
+          , raw_bytes * iterations / read_secs / 1e6
+          , raw_bytes * iterations / unpack_secs / 1e6);
+    }
+    catch (std::exception& err)
+    {
+      std::string msg{err.what()};
+      printf("%-12s unavailable: %s\n", c.name, msg.substr(0, msg.find('\n')).c_str());
+    }
+  }
+  remove("bench_codecs.h5");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "../tests/synthetic.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace odim_h5;
+
+/* Measures how decode throughput scales with thread count in thread safe mode.  HDF5 calls (including
+ * decompression) are serialised by the library lock while unpacking runs outside it, so scaling is
+ * bounded by the fraction of time spent unpacking.
+ *
+ * usage: bench_thread_contention [max_threads] [iterations]
+ */
+
+int main(int argc, char* argv[])
+{
+  const size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::max(std::thread::hardware_concurrency(), 1u);
+  const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 32;
+  const synthetic::shape shp{10, 360, 1000};
+  const size_t file_count = 4;
+
+  set_thread_safe(true);
+
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < file_count; ++i)
+  {
+    paths.push_back("bench_thread_contention_" + std::to_string(i) + ".h5");
+    polar_volume vol{paths.back(), file::io_mode::create};
+    synthetic::write_volume(vol, shp, i);
+  }
+
+  printf("%8s %12s %12s %10s\n", "threads", "files/s", "MB/s", "speedup");
+  double base = 0.0;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2)
+  {
+    std::atomic<size_t> next{0};
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t)
+    {
+      pool.emplace_back([&]
+      {
+        for (auto i = next++; i < iterations; i = next++)
+          synthetic::checksum(file{paths[i % file_count], file::io_mode::read_only});
+      });
+    }
+    for (auto& thread : pool)
+      thread.join();
+    auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    auto rate = iterations / secs;
+    auto bytes = double(iterations) * shp.scans * shp.rays * shp.bins * 2 * sizeof(float);
+    if (threads == 1)
+      base = rate;
+    printf("%8zu %12.1f %12.1f %10.2f\n", threads, rate, bytes / secs / 1e6, rate / base);
+  }
+  return EXIT_SUCCESS;
+}
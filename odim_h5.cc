@@ -18,9 +18,56 @@
 #include "odim_h5.h"
 
 #include <hdf5.h>
+#include <hdf5_hl.h>
 #include <alloca.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_set>
+
+#ifdef ODIM_H5_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <sys/stat.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define ODIM_H5_HAVE_MMAP
+#endif
+
+// the process loader relies on process shared semaphores and lock free atomics in shared memory
+#if defined(__linux__)
+#include <dirent.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/wait.h>
+#define ODIM_H5_HAVE_PROCESS_LOADER
+#endif
+
+// direct chunk I/O needs H5Dread_chunk, H5Dwrite_chunk and our own deflate implementation
+#if defined(ODIM_H5_HAVE_ZLIB) && H5_VERSION_GE(1, 10, 3)
+#define ODIM_H5_DIRECT_CHUNK_IO
+#endif
 
 using namespace odim_h5;
 
@@ -55,91 +102,201 @@ static constexpr int default_version_major = 2;
 static constexpr int default_version_minor = 2;
 static constexpr const char* default_conventions = "ODIM_H5/V2_2";
 
-// these MUST remain in ASCII sorted order
-static const char* what_names[] = 
-{
-    "date"
-  , "enddate"
-  , "endtime"
-  , "gain"
-  , "nodata"
-  , "object"
-  , "offset"
-  , "prodpar"
-  , "product"
-  , "quantity"
-  , "source"
-  , "startdate"
-  , "starttime"
-  , "time"
-  , "undetect"
-  , "version"
-  , nullptr
-};
+namespace
+{
+  enum class key_group
+  {
+      what
+    , where
+  };
+
+  struct catalogue_entry
+  {
+    const char* name;
+    key_group   group;
+  };
+}
 
 /* Note:
  * 'astart' is a how attribute, despite my best efforts to have it adopted as a
  * compulsory where attribute. It is therefore exposed via the API but deliberately
  * excluded from this list.  Hopefully in a post V2.2 release of ODIM we can get
  * astart promoted to where. */
-static const char* where_names[] =
-{
-    "LL_lat"
-  , "LL_lon"
-  , "LR_lat"
-  , "LR_lon"
-  , "UL_lat"
-  , "UL_lon"
-  , "UR_lat"
-  , "UR_lon"
-  , "a1gate"
-  , "angles"
-  , "az_angle"
-  , "elangle"
-  , "height"
-  , "interval"
-  , "lat"
-  , "levels"
-  , "lon"
-  , "maxheight"
-  , "minheight"
-  , "nbins"
-  , "nrays"
-  , "projdef"
-  , "range"
-  , "rscale"
-  , "rstart"
-  , "start_lat"
-  , "start_lon"
-  , "startaz"
-  , "stop_lon"
-  , "stop_lat"
-  , "stopaz"
-  , "xscale"
-  , "xsize"
-  , "yscale"
-  , "ysize"
-  , nullptr
+// these MUST remain in ASCII sorted order and match the order of keys::id
+// qualify uses as ::catalogue, the using directive above also makes the odim_h5::catalogue class visible
+static constexpr catalogue_entry catalogue[] =
+{
+    { "LL_lat",    key_group::where }
+  , { "LL_lon",    key_group::where }
+  , { "LR_lat",    key_group::where }
+  , { "LR_lon",    key_group::where }
+  , { "UL_lat",    key_group::where }
+  , { "UL_lon",    key_group::where }
+  , { "UR_lat",    key_group::where }
+  , { "UR_lon",    key_group::where }
+  , { "a1gate",    key_group::where }
+  , { "angles",    key_group::where }
+  , { "az_angle",  key_group::where }
+  , { "date",      key_group::what }
+  , { "elangle",   key_group::where }
+  , { "enddate",   key_group::what }
+  , { "endtime",   key_group::what }
+  , { "gain",      key_group::what }
+  , { "height",    key_group::where }
+  , { "interval",  key_group::where }
+  , { "lat",       key_group::where }
+  , { "levels",    key_group::where }
+  , { "lon",       key_group::where }
+  , { "maxheight", key_group::where }
+  , { "minheight", key_group::where }
+  , { "nbins",     key_group::where }
+  , { "nodata",    key_group::what }
+  , { "nrays",     key_group::where }
+  , { "object",    key_group::what }
+  , { "offset",    key_group::what }
+  , { "prodpar",   key_group::what }
+  , { "product",   key_group::what }
+  , { "projdef",   key_group::where }
+  , { "quantity",  key_group::what }
+  , { "range",     key_group::where }
+  , { "rscale",    key_group::where }
+  , { "rstart",    key_group::where }
+  , { "source",    key_group::what }
+  , { "start_lat", key_group::where }
+  , { "start_lon", key_group::where }
+  , { "startaz",   key_group::where }
+  , { "startdate", key_group::what }
+  , { "starttime", key_group::what }
+  , { "stop_lat",  key_group::where }
+  , { "stop_lon",  key_group::where }
+  , { "stopaz",    key_group::where }
+  , { "time",      key_group::what }
+  , { "undetect",  key_group::what }
+  , { "version",   key_group::what }
+  , { "xscale",    key_group::where }
+  , { "xsize",     key_group::where }
+  , { "yscale",    key_group::where }
+  , { "ysize",     key_group::where }
 };
 
-static auto is_what_attribute(const char* name) -> bool
-{
-  for (auto ptr = what_names; *ptr != nullptr; ++ptr)
-    if (strcmp(*ptr, name) == 0)
-      return true;
-  return false;
-}
+static constexpr auto names_equal(const char* lhs, const char* rhs) -> bool
+{
+  return *lhs == *rhs && (*lhs == '\0' || names_equal(lhs + 1, rhs + 1));
+}
+
+static constexpr auto names_ordered(const char* lhs, const char* rhs) -> bool
+{
+  return *lhs != *rhs
+    ? static_cast<unsigned char>(*lhs) < static_cast<unsigned char>(*rhs)
+    : *lhs != '\0' && names_ordered(lhs + 1, rhs + 1);
+}
+
+static constexpr auto catalogue_sorted(size_t i = 0) -> bool
+{
+  return i + 1 >= keys::count || (names_ordered(::catalogue[i].name, ::catalogue[i + 1].name) && catalogue_sorted(i + 1));
+}
+
+static_assert(sizeof(::catalogue) / sizeof(::catalogue[0]) == keys::count, "attribute catalogue does not match keys::id");
+static_assert(catalogue_sorted(), "attribute catalogue is not in ASCII sorted order");
+#define ODIM_H5_CHECK_KEY(n) \
+  static_assert(names_equal(::catalogue[static_cast<size_t>(keys::id::n)].name, #n), "attribute catalogue does not match keys::id")
+ODIM_H5_CHECK_KEY(LL_lat);
+ODIM_H5_CHECK_KEY(LL_lon);
+ODIM_H5_CHECK_KEY(LR_lat);
+ODIM_H5_CHECK_KEY(LR_lon);
+ODIM_H5_CHECK_KEY(UL_lat);
+ODIM_H5_CHECK_KEY(UL_lon);
+ODIM_H5_CHECK_KEY(UR_lat);
+ODIM_H5_CHECK_KEY(UR_lon);
+ODIM_H5_CHECK_KEY(a1gate);
+ODIM_H5_CHECK_KEY(angles);
+ODIM_H5_CHECK_KEY(az_angle);
+ODIM_H5_CHECK_KEY(date);
+ODIM_H5_CHECK_KEY(elangle);
+ODIM_H5_CHECK_KEY(enddate);
+ODIM_H5_CHECK_KEY(endtime);
+ODIM_H5_CHECK_KEY(gain);
+ODIM_H5_CHECK_KEY(height);
+ODIM_H5_CHECK_KEY(interval);
+ODIM_H5_CHECK_KEY(lat);
+ODIM_H5_CHECK_KEY(levels);
+ODIM_H5_CHECK_KEY(lon);
+ODIM_H5_CHECK_KEY(maxheight);
+ODIM_H5_CHECK_KEY(minheight);
+ODIM_H5_CHECK_KEY(nbins);
+ODIM_H5_CHECK_KEY(nodata);
+ODIM_H5_CHECK_KEY(nrays);
+ODIM_H5_CHECK_KEY(object);
+ODIM_H5_CHECK_KEY(offset);
+ODIM_H5_CHECK_KEY(prodpar);
+ODIM_H5_CHECK_KEY(product);
+ODIM_H5_CHECK_KEY(projdef);
+ODIM_H5_CHECK_KEY(quantity);
+ODIM_H5_CHECK_KEY(range);
+ODIM_H5_CHECK_KEY(rscale);
+ODIM_H5_CHECK_KEY(rstart);
+ODIM_H5_CHECK_KEY(source);
+ODIM_H5_CHECK_KEY(start_lat);
+ODIM_H5_CHECK_KEY(start_lon);
+ODIM_H5_CHECK_KEY(startaz);
+ODIM_H5_CHECK_KEY(startdate);
+ODIM_H5_CHECK_KEY(starttime);
+ODIM_H5_CHECK_KEY(stop_lat);
+ODIM_H5_CHECK_KEY(stop_lon);
+ODIM_H5_CHECK_KEY(stopaz);
+ODIM_H5_CHECK_KEY(time);
+ODIM_H5_CHECK_KEY(undetect);
+ODIM_H5_CHECK_KEY(version);
+ODIM_H5_CHECK_KEY(xscale);
+ODIM_H5_CHECK_KEY(xsize);
+ODIM_H5_CHECK_KEY(yscale);
+ODIM_H5_CHECK_KEY(ysize);
+#undef ODIM_H5_CHECK_KEY
+
+/* Thread safe mode:
+ * When enabled every call into the HDF5 library is made while holding a single recursive lock.  The lock
+ * is taken as close as practical to the HDF5 calls themselves, so value unpacking and packing, chunk
+ * (de)compression on the worker pool and error message formatting all happen outside of it.  When
+ * disabled taking the lock costs a single relaxed atomic load.
+ */
+static std::atomic<bool> thread_safe_mode_{false};
+
+// deliberately leaked so that handles destroyed during static destruction may still use it
+static auto hdf5_mutex() -> std::recursive_mutex&
+{
+  static auto mutex = new std::recursive_mutex;
+  return *mutex;
+}
+
+namespace
+{
+  // scoped lock which must be held around calls into the HDF5 library
+  class hdf5_lock
+  {
+  public:
+    hdf5_lock()
+      : locked_{thread_safe_mode_.load(std::memory_order_relaxed)}
+    {
+      if (locked_)
+        hdf5_mutex().lock();
+    }
 
-static auto is_where_attribute(const char* name) -> bool
-{
-  for (auto ptr = where_names; *ptr != nullptr; ++ptr)
-    if (strcmp(*ptr, name) == 0)
-      return true;
-  return false;
+    hdf5_lock(const hdf5_lock&) = delete;
+    auto operator=(const hdf5_lock&) -> hdf5_lock& = delete;
+
+    ~hdf5_lock()
+    {
+      if (locked_)
+        hdf5_mutex().unlock();
+    }
+
+  private:
+    bool locked_;
+  };
 }
 
 static auto make_error(
-      const handle& hnd
+      hid_t hnd
     , const char* op
     , const char* param = nullptr
     , const char* err = nullptr
@@ -151,10 +308,15 @@ static auto make_error(
   auto at = snprintf(msg, len, "odim_h5 error: %s\n  operation: %s", err ? err : "", op);
   if (at < len && param)
     at += snprintf(msg + at, len - at, "\n  parameter: %s", param);
-  if (at < len && hnd)
+  if (at < len && hnd > 0)
   {
     char loc[len];
-    if (H5Iget_name(hnd, loc, 512) > 0)
+    ssize_t loc_len;
+    {
+      hdf5_lock lock;
+      loc_len = H5Iget_name(hnd, loc, 512);
+    }
+    if (loc_len > 0)
     {
       loc[len - 1] = '\0';
       at += snprintf(msg + at, len - at, "\n   location: %s", loc);
@@ -165,7 +327,7 @@ static auto make_error(
 }
 
 static auto make_error(
-      const handle& hnd
+      hid_t hnd
     , const char* op
     , const char* param
     , herr_t err
@@ -175,8 +337,11 @@ static auto make_error(
   char buf[len];
   H5E_type_t type;
 
-  if (H5Eget_msg(err, &type, buf, len) < 0)
-    buf[0] = '\0';
+  {
+    hdf5_lock lock;
+    if (H5Eget_msg(err, &type, buf, len) < 0)
+      buf[0] = '\0';
+  }
 
   return make_error(hnd, op, param, buf);
 }
@@ -226,6 +391,379 @@ static auto hdf_storage_type(data::data_type type) -> hid_t
   }
 }
 
+// registered HDF5 filter plugin ids for codecs not built in to the library
+static constexpr H5Z_filter_t filter_lz4 = 32004;
+static constexpr H5Z_filter_t filter_zstd = 32015;
+
+// ensure the layer settings are usable before creating any objects in the file
+static auto check_layer_settings(
+      const handle& loc
+    , const compression_policy::settings& comp
+    , const chunk_layout& layout
+    ) -> void
+{
+  hdf5_lock lock;
+  if (   !layout.is_explicit()
+      && layout.pattern() == chunk_layout::access_pattern::contiguous
+      && (comp.type != compression_policy::codec::none || comp.shuffle))
+    throw make_error(loc, "create dataset", nullptr, "contiguous layers cannot be compressed");
+  if (comp.type == compression_policy::codec::lz4 && H5Zfilter_avail(filter_lz4) <= 0)
+    throw make_error(loc, "create dataset", nullptr, "lz4 compression filter (id 32004) unavailable");
+  if (comp.type == compression_policy::codec::zstd && H5Zfilter_avail(filter_zstd) <= 0)
+    throw make_error(loc, "create dataset", nullptr, "zstd compression filter (id 32015) unavailable");
+}
+
+static auto set_compression_filters(
+      const handle& loc
+    , const handle& plist
+    , const compression_policy::settings& comp
+    ) -> void
+{
+  hdf5_lock lock;
+  if (comp.shuffle && H5Pset_shuffle(plist) < 0)
+    throw make_error(loc, "create dataset", "shuffle");
+
+  switch (comp.type)
+  {
+  case compression_policy::codec::none:
+    break;
+  case compression_policy::codec::deflate:
+    if (comp.level > 0 && H5Pset_deflate(plist, comp.level) < 0)
+      throw make_error(loc, "create dataset", "deflate");
+    break;
+  case compression_policy::codec::lz4:
+    if (H5Pset_filter(plist, filter_lz4, H5Z_FLAG_MANDATORY, 0, nullptr) < 0)
+      throw make_error(loc, "create dataset", "lz4");
+    break;
+  case compression_policy::codec::zstd:
+    {
+      unsigned int level = comp.level;
+      if (H5Pset_filter(plist, filter_zstd, H5Z_FLAG_MANDATORY, 1, &level) < 0)
+        throw make_error(loc, "create dataset", "zstd");
+    }
+    break;
+  default:
+    throw make_error(loc, "create dataset", nullptr, "unsupported compression codec");
+  }
+}
+
+// throw a descriptive error if a dataset depends on a filter which is not available
+static auto check_filters_available(const handle& dset) -> void
+{
+  hdf5_lock lock;
+  handle plist{H5Dget_create_plist(dset)};
+  if (!plist)
+    return;
+  auto n = H5Pget_nfilters(plist);
+  for (int i = 0; i < n; ++i)
+  {
+    unsigned int flags;
+    size_t cd_nelmts = 0;
+    char name[64] = "";
+    auto id = H5Pget_filter2(plist, i, &flags, &cd_nelmts, nullptr, sizeof(name), name, nullptr);
+    if (id >= 0 && H5Zfilter_avail(id) <= 0)
+    {
+      char msg[128];
+      snprintf(msg, sizeof(msg), "required HDF5 filter '%s' (id %d) unavailable", name[0] ? name : "unknown", id);
+      throw make_error(dset, "read dataset", "data", msg);
+    }
+  }
+}
+
+/* Unpacking kernels:
+ * The unpack loop is written so that each element is handled without branches, allowing the compiler
+ * to vectorize it using masked selects for the undetect and nodata substitutions.  Where the toolchain
+ * supports it on x86_64 the commonly used (storage, output) type pairs are compiled for multiple
+ * instruction sets and the best version is selected at load time based on the running CPU.  On other
+ * architectures (such as aarch64, where NEON is part of the baseline) the default build is used.
+ *
+ * The arithmetic is always performed in double precision so that every variant produces exactly the
+ * same results as the scalar loop.  For the same reason the build disables FMA contraction (AVX-512
+ * would otherwise fuse the multiply-add).  The build also disables floating point trapping semantics,
+ * without which the compiler will not convert the selects below into vector blends. */
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define ODIM_H5_SIMD_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef ODIM_H5_SIMD_CLONES
+#define ODIM_H5_SIMD_CLONES
+#endif
+
+template <typename S, typename T>
+static inline auto unpack_kernel(
+      const S* in
+    , T* out
+    , size_t size
+    , double a
+    , double b
+    , S ud
+    , S nd
+    , T undetect
+    , T nodata
+    ) -> void
+{
+  for (size_t i = 0; i < size; ++i)
+  {
+    const S v = in[i];
+    T r = static_cast<T>(a * v + b);
+    r = v == nd ? nodata : r;
+    r = v == ud ? undetect : r;
+    out[i] = r;
+  }
+}
+
+#define ODIM_H5_UNPACK_KERNEL(S, T) \
+  ODIM_H5_SIMD_CLONES static auto unpack_kernel( \
+        const S* in, T* out, size_t size, double a, double b, S ud, S nd, T undetect, T nodata) -> void \
+  { \
+    unpack_kernel<S, T>(in, out, size, a, b, ud, nd, undetect, nodata); \
+  }
+ODIM_H5_UNPACK_KERNEL(uint8_t, float)
+ODIM_H5_UNPACK_KERNEL(uint8_t, double)
+ODIM_H5_UNPACK_KERNEL(uint16_t, float)
+ODIM_H5_UNPACK_KERNEL(uint16_t, double)
+ODIM_H5_UNPACK_KERNEL(int16_t, float)
+ODIM_H5_UNPACK_KERNEL(int16_t, double)
+ODIM_H5_UNPACK_KERNEL(float, float)
+ODIM_H5_UNPACK_KERNEL(float, double)
+ODIM_H5_UNPACK_KERNEL(double, double)
+#undef ODIM_H5_UNPACK_KERNEL
+
+/* Scratch space used to hold packed values between the HDF5 read and unpacking pass.  The buffer is
+ * retained and reused by each thread so that it is only allocated the first time a layer of a given
+ * size is seen. */
+static auto scratch_buffer(size_t bytes) -> void*
+{
+  static thread_local std::vector<unsigned char> buf;
+  if (buf.size() < bytes)
+  {
+    buf.clear();
+    buf.shrink_to_fit();
+    buf.resize(bytes);
+  }
+  return buf.data();
+}
+
+/* Packing kernels:
+ * As for unpacking, the loop is branch free so that it can be vectorized.  Values flagged as undetect or
+ * nodata by the caller are marked in a parallel array of flags (1 = undetect, 2 = nodata).  Other values
+ * are scaled, saturated to [lo, hi] and rounded to the nearest integer (ties to even), then moved off
+ * the reserved codes. */
+template <typename S>
+static inline auto pack_value(double x, double lo, double hi)
+  -> typename std::enable_if<std::is_integral<S>::value && sizeof(S) < 8, S>::type
+{
+  x = x >= lo ? x : lo; // also maps NaN to lo
+  x = x <= hi ? x : hi;
+  // adding and removing 1.5 * 2^52 rounds to an integer in the current (nearest) rounding mode, unlike
+  // std::nearbyint this can be vectorized on all targets and is exact for the 32 bit range
+  constexpr double magic = 6755399441055744.0;
+  return static_cast<S>((x + magic) - magic);
+}
+
+template <typename S>
+static inline auto pack_value(double x, double lo, double hi)
+  -> typename std::enable_if<std::is_integral<S>::value && sizeof(S) >= 8, S>::type
+{
+  x = x >= lo ? x : lo;
+  x = x <= hi ? x : hi;
+  return static_cast<S>(std::nearbyint(x));
+}
+
+template <typename S>
+static inline auto pack_value(double x, double lo, double hi)
+  -> typename std::enable_if<std::is_floating_point<S>::value, S>::type
+{
+  return static_cast<S>(x);
+}
+
+// reserved codes and the codes which real values rounding onto them are moved to
+template <typename S>
+struct pack_codes
+{
+  S ud;
+  S nd;
+  S ud_below;
+  S ud_above;
+  S nd_below;
+  S nd_above;
+};
+
+template <typename T, typename S>
+static inline auto pack_kernel(
+      const T* in
+    , const unsigned char* flags
+    , S* out
+    , size_t size
+    , double a
+    , double b
+    , double lo
+    , double hi
+    , pack_codes<S> codes
+    ) -> void
+{
+  const S ud = codes.ud, nd = codes.nd;
+  const S ud_below = codes.ud_below, ud_above = codes.ud_above;
+  const S nd_below = codes.nd_below, nd_above = codes.nd_above;
+  for (size_t i = 0; i < size; ++i)
+  {
+    const double x = (in[i] - b) / a;
+    S r = pack_value<S>(x, lo, hi);
+    // a real value must never be written as a reserved code, move it to the nearest free code instead
+    r = r == ud ? (x < ud ? ud_below : ud_above) : r;
+    r = r == nd ? (x < nd ? nd_below : nd_above) : r;
+    r = flags[i] == 2 ? nd : r;
+    r = flags[i] == 1 ? ud : r;
+    out[i] = r;
+  }
+}
+
+#define ODIM_H5_PACK_KERNEL(T, S) \
+  ODIM_H5_SIMD_CLONES static auto pack_kernel( \
+        const T* in, const unsigned char* flags, S* out, size_t size, double a, double b, double lo, double hi \
+      , pack_codes<S> codes) -> void \
+  { \
+    pack_kernel<T, S>(in, flags, out, size, a, b, lo, hi, codes); \
+  }
+ODIM_H5_PACK_KERNEL(float, uint8_t)
+ODIM_H5_PACK_KERNEL(float, uint16_t)
+ODIM_H5_PACK_KERNEL(float, int16_t)
+ODIM_H5_PACK_KERNEL(double, uint8_t)
+ODIM_H5_PACK_KERNEL(double, uint16_t)
+ODIM_H5_PACK_KERNEL(double, int16_t)
+#undef ODIM_H5_PACK_KERNEL
+
+// convert a nodata or undetect code into the storage type, saturating if needed
+template <typename S>
+static auto saturate_code(double val) -> typename std::enable_if<std::is_integral<S>::value, S>::type
+{
+  if (!(val > std::numeric_limits<S>::lowest()))
+    return std::numeric_limits<S>::lowest();
+  if (val >= static_cast<double>(std::numeric_limits<S>::max()))
+    return std::numeric_limits<S>::max();
+  return static_cast<S>(std::nearbyint(val));
+}
+
+template <typename S>
+static auto saturate_code(double val) -> typename std::enable_if<std::is_floating_point<S>::value, S>::type
+{
+  return static_cast<S>(val);
+}
+
+// find the nearest code to a reserved one in the given direction which is neither reserved nor outside [min, max]
+template <typename S>
+static auto free_code(S code, bool up, S min, S max, S ud, S nd) -> typename std::enable_if<std::is_integral<S>::value, S>::type
+{
+  for (auto dir : { up, !up })
+  {
+    auto c = code;
+    while (dir ? c < max : c > min)
+    {
+      c = dir ? c + 1 : c - 1;
+      if (c != ud && c != nd)
+        return c;
+    }
+  }
+  return code;
+}
+
+// floating point storage represents real values exactly, so they are never moved
+template <typename S>
+static auto free_code(S code, bool up, S min, S max, S ud, S nd) -> typename std::enable_if<std::is_floating_point<S>::value, S>::type
+{
+  return code;
+}
+
+template <typename T, typename S>
+static auto pack_values(const T* in, const unsigned char* flags, S* out, size_t count, double a, double b, double nodata, double undetect)
+  -> void
+{
+  const auto ud = saturate_code<S>(undetect);
+  const auto nd = saturate_code<S>(nodata);
+
+  // determine the saturation range, excluding reserved codes at either end
+  auto min = std::numeric_limits<S>::lowest();
+  auto max = std::numeric_limits<S>::max();
+  if (std::is_integral<S>::value)
+  {
+    while (min < max && (min == ud || min == nd))
+      ++min;
+    while (max > min && (max == ud || max == nd))
+      --max;
+  }
+  double lo = min, hi = max;
+  if (std::is_integral<S>::value && sizeof(S) >= 8)
+    hi = std::nextafter(hi, 0.0);   // max is not representable as a double, avoid rounding up past it
+
+  pack_codes<S> codes;
+  codes.ud = ud;
+  codes.nd = nd;
+  codes.ud_below = free_code<S>(ud, false, min, max, ud, nd);
+  codes.ud_above = free_code<S>(ud, true, min, max, ud, nd);
+  codes.nd_below = free_code<S>(nd, false, min, max, ud, nd);
+  codes.nd_above = free_code<S>(nd, true, min, max, ud, nd);
+  pack_kernel(in, flags, out, count, a, b, lo, hi, codes);
+}
+
+static auto hdf_native_storage_type(data::data_type type) -> hid_t
+{
+  switch (type)
+  {
+  case data::data_type::i8:
+    return H5T_NATIVE_INT8;
+  case data::data_type::u8:
+    return H5T_NATIVE_UINT8;
+  case data::data_type::i16:
+    return H5T_NATIVE_INT16;
+  case data::data_type::u16:
+    return H5T_NATIVE_UINT16;
+  case data::data_type::i32:
+    return H5T_NATIVE_INT32;
+  case data::data_type::u32:
+    return H5T_NATIVE_UINT32;
+  case data::data_type::i64:
+    return H5T_NATIVE_INT64;
+  case data::data_type::u64:
+    return H5T_NATIVE_UINT64;
+  case data::data_type::f32:
+    return H5T_NATIVE_FLOAT;
+  case data::data_type::f64:
+    return H5T_NATIVE_DOUBLE;
+  default:
+    return -1;
+  }
+}
+
+static auto types_equal(hid_t lhs, hid_t rhs) -> bool
+{
+  hdf5_lock lock;
+  return H5Tequal(lhs, rhs) > 0;
+}
+
+static auto storage_size(data::data_type type) -> size_t
+{
+  switch (type)
+  {
+  case data::data_type::i8:
+  case data::data_type::u8:
+    return 1;
+  case data::data_type::i16:
+  case data::data_type::u16:
+    return 2;
+  case data::data_type::i32:
+  case data::data_type::u32:
+  case data::data_type::f32:
+    return 4;
+  case data::data_type::i64:
+  case data::data_type::u64:
+  case data::data_type::f64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
 static auto strings_to_time(const std::string& date, const std::string& time) -> time_t
 {
   struct tm tms;
@@ -248,216 +786,704 @@ static auto time_to_strings(time_t val, char date[9], char time[7]) -> void
   snprintf(time, 7, "%02d%02d%02d", tms.tm_hour, tms.tm_min, tms.tm_sec);
 }
 
-//------------------------------------------------------------------------------
-
-auto odim_h5::release_tag() -> char const*
+// read optional attributes, returning NaN, -1, an empty string or 0 time if missing or of the wrong type
+static auto optional_real(const attribute_store& attrs, keys::id key) -> double
 {
-  return ODIM_H5_RELEASE_TAG;
+  auto i = attrs.find(key);
+  if (i != attrs.end())
+  {
+    auto type = i->type();
+    if (type == attribute::data_type::real)
+      return i->get_real();
+    if (type == attribute::data_type::integer)
+      return i->get_integer();
+  }
+  return std::numeric_limits<double>::quiet_NaN();
 }
 
-auto odim_h5::default_odim_version() -> std::pair<int, int>
+static auto optional_integer(const attribute_store& attrs, keys::id key) -> long
 {
-  return {default_version_major, default_version_minor};
+  auto i = attrs.find(key);
+  if (i != attrs.end() && i->type() == attribute::data_type::integer)
+    return i->get_integer();
+  return -1;
 }
 
-handle::handle(const handle& rhs)
-  : id{rhs.id}
+static auto optional_string(const attribute_store& attrs, keys::id key) -> std::string
 {
-  if (id > 0)
-    H5Iinc_ref(id);
+  auto i = attrs.find(key);
+  if (i != attrs.end() && i->type() == attribute::data_type::string)
+    return i->get_string();
+  return std::string();
 }
 
-auto handle::operator=(const handle& rhs) -> handle&
+static auto optional_time(const attribute_store& attrs, keys::id date, keys::id time) -> time_t
 {
-  if (id == rhs.id)
-    return *this;
-  if (id > 0)
-    H5Idec_ref(id);
-  id = rhs.id;
-  if (id > 0)
-    H5Iinc_ref(id);
-  return *this;
+  auto d = optional_string(attrs, date), t = optional_string(attrs, time);
+  return d.empty() || t.empty() ? 0 : strings_to_time(d, t);
 }
 
-handle::~handle()
-{
-  if (id > 0)
-    H5Idec_ref(id);
-}
+//------------------------------------------------------------------------------
 
-error::error(const char* what)
-  : std::runtime_error{what}
+auto keys::name(id key) -> const char*
 {
-
+  return ::catalogue[static_cast<size_t>(key)].name;
 }
 
-attribute::attribute(const handle* parent, std::string name, bool existing)
-  : parent_{parent}
-  , name_{std::move(name)}
-  , type_{existing ? data_type::unknown : data_type::uninitialized}
-  , size_{0}
+auto keys::lookup(const char* name) -> id
 {
-
+  auto i = std::lower_bound(
+        std::begin(::catalogue)
+      , std::end(::catalogue)
+      , name
+      , [](const catalogue_entry& lhs, const char* rhs) { return strcmp(lhs.name, rhs) < 0; });
+  return i != std::end(::catalogue) && strcmp(i->name, name) == 0 ? static_cast<id>(i - std::begin(::catalogue)) : id::none;
 }
 
-auto attribute::type() const -> data_type
+auto odim_h5::release_tag() -> char const*
 {
-  if (type_ == data_type::unknown)
-    open();
-  return type_;
+  return ODIM_H5_RELEASE_TAG;
 }
 
-auto attribute::get_boolean() const -> bool
+auto odim_h5::default_odim_version() -> std::pair<int, int>
 {
-  if (type_ == data_type::unknown)
-    open();
-  if (type_ != data_type::boolean)
-    throw make_error(open(), "type mismatch", name_.c_str(), "boolean");
-  return size_ == 5;
+  return {default_version_major, default_version_minor};
 }
 
-auto attribute::get_integer() const -> long
+auto odim_h5::set_thread_safe(bool enable) -> void
 {
-  auto hnd = open();
-  if (type_ != data_type::integer)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "integer");
-  long val;
-  if (H5Aread(hnd, H5T_NATIVE_LONG, &val) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "integer");
-  return val;
+  thread_safe_mode_ = enable;
 }
 
-auto attribute::get_real() const -> double
+auto odim_h5::thread_safe() -> bool
 {
-  auto hnd = open();
-  if (type_ != data_type::real)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "real");
-  double val;
-  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "real");
-  return val;
+  return thread_safe_mode_;
 }
 
-auto attribute::get_string() const -> std::string
+namespace
 {
-  handle type;
+  /* Over allocates from the global heap and stores the original pointer immediately before the aligned
+   * block handed to the caller. */
+  class heap_memory_resource : public memory_resource
+  {
+  protected:
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override
+    {
+      if (alignment < alignof(void*))
+        alignment = alignof(void*);
+      auto raw = static_cast<unsigned char*>(::operator new(bytes + alignment + sizeof(void*)));
+      auto addr = reinterpret_cast<uintptr_t>(raw + sizeof(void*));
+      auto ptr = reinterpret_cast<unsigned char*>((addr + alignment - 1) & ~uintptr_t(alignment - 1));
+      reinterpret_cast<void**>(ptr)[-1] = raw;
+      return ptr;
+    }
 
-  auto hnd = open(&type);
-  if (type_ != data_type::string)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "string");
+    auto do_deallocate(void* ptr, size_t, size_t) -> void override
+    {
+      if (ptr)
+        ::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+    }
+  };
+}
 
-  // use stack allocation for short strings
-  if (size_ < 256)
-  {
-    char* buf = static_cast<char*>(alloca(size_));
-    if (H5Aread(hnd, type, buf) < 0)
-      throw make_error(hnd, "attribute read", name_.c_str(), "string");
-    return {buf, size_ - 1};
-  }
-  else
-  {
-    std::unique_ptr<char[]> buf{new char[size_]};
-    if (H5Aread(hnd, type, buf.get()) < 0)
-      throw make_error(hnd, "attribute read", name_.c_str(), "string");
-    return {buf.get(), size_ - 1};
-  }
+auto odim_h5::heap_resource() -> memory_resource&
+{
+  static heap_memory_resource mem;
+  return mem;
 }
 
-auto attribute::get_integer_array() const -> std::vector<long>
+decode_arena::decode_arena(size_t initial_size, memory_resource& upstream)
+  : upstream_{&upstream}
+  , offset_{0}
+  , used_{0}
+  , upstream_allocations_{0}
 {
-  auto hnd = open();
-  if (type_ != data_type::integer_array)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "integer_array");
-  std::vector<long> val(size_);
-  if (H5Aread(hnd, H5T_NATIVE_LONG, &val[0]) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "integer_array");
-  return val;
+  if (initial_size > 0)
+    add_block(initial_size);
 }
 
-auto attribute::get_real_array() const -> std::vector<double>
+decode_arena::~decode_arena()
 {
-  auto hnd = open();
-  if (type_ != data_type::real_array)
-    throw make_error(hnd, "type mismatch", name_.c_str(), "real_array");
-  std::vector<double> val(size_);
-  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val[0]) < 0)
-    throw make_error(hnd, "attribute read", name_.c_str(), "double_array");
-  return val;
+  release();
 }
 
-auto attribute::set(bool val) -> void
+auto decode_arena::reset() -> void
 {
-  handle type;
-  auto hnd = open_or_create(data_type::boolean, val ? 5 : 6, &type);
-  if (H5Awrite(hnd, type, val ? "True" : "False") < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+  // coalesce into a single block big enough for everything needed since the last reset
+  if (blocks_.size() > 1)
+  {
+    size_t total = 0;
+    for (auto& b : blocks_)
+      total += b.size;
+    release();
+    add_block(total);
+  }
+  offset_ = 0;
+  used_ = 0;
 }
 
-auto attribute::set(long val) -> void
+auto decode_arena::capacity() const -> size_t
 {
-  auto hnd = open_or_create(data_type::integer, 1);
-  if (H5Awrite(hnd, H5T_NATIVE_LONG, &val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer");
+  size_t total = 0;
+  for (auto& b : blocks_)
+    total += b.size;
+  return total;
 }
 
-auto attribute::set(double val) -> void
+auto decode_arena::do_allocate(size_t bytes, size_t alignment) -> void*
 {
-  auto hnd = open_or_create(data_type::real, 1);
-  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "real");
+  if (alignment < simd_alignment)
+    alignment = simd_alignment;
+
+  // blocks are simd aligned so rounding the offset is sufficient
+  auto start = (offset_ + alignment - 1) & ~(alignment - 1);
+  if (blocks_.empty() || start + bytes > blocks_.back().size)
+  {
+    // grow geometrically so that warming up takes few blocks
+    add_block(std::max(bytes + alignment, blocks_.empty() ? size_t(64 << 10) : blocks_.back().size * 2));
+    start = 0;
+  }
+  offset_ = start + bytes;
+  used_ += bytes;
+  return blocks_.back().base + start;
 }
 
-auto attribute::set(const char* val) -> void
+auto decode_arena::do_deallocate(void*, size_t, size_t) -> void
 {
-  handle type;
-  auto hnd = open_or_create(data_type::string, strlen(val) + 1, &type);
-  if (H5Awrite(hnd, type, val) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  // memory is reclaimed by reset()
 }
 
-auto attribute::set(const std::string& val) -> void
+auto decode_arena::add_block(size_t size) -> void
 {
-  handle type;
-  auto hnd = open_or_create(data_type::string, val.size() + 1, &type);
-  if (H5Awrite(hnd, type, val.c_str()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "string");
+  // reserve first so that a failure to grow the list does not leak the block
+  blocks_.reserve(blocks_.size() + 1);
+  auto base = static_cast<unsigned char*>(upstream_->allocate(size, simd_alignment));
+  blocks_.push_back(block{base, size});
+  offset_ = 0;
+  ++upstream_allocations_;
 }
 
-auto attribute::set(const std::vector<long>& val) -> void
+auto decode_arena::release() noexcept -> void
 {
-  auto hnd = open_or_create(data_type::integer_array, val.size());
-  if (H5Awrite(hnd, H5T_NATIVE_LONG, val.data()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "integer_array");
+  for (auto& b : blocks_)
+    upstream_->deallocate(b.base, b.size, simd_alignment);
+  blocks_.clear();
 }
 
-auto attribute::set(const std::vector<double>& val) -> void
+struct odim_h5::io_continuation
 {
+  std::mutex  mutex;
+  bool        done = false;
+  void        (*resume)(void*) = nullptr;
+  void*       arg = nullptr;
+};
+
+struct io_executor::state
+{
+  typedef std::chrono::steady_clock clock;
+
+  struct task
+  {
+    std::function<void()>             fn;
+    std::shared_ptr<io_continuation>  cont;
+    clock::time_point                 queued;
+  };
+
+  std::mutex                                      mutex;
+  std::condition_variable                         tasks_cv;
+  std::condition_variable                         resumes_cv;
+  std::deque<task>                                tasks;
+  std::deque<std::pair<void (*)(void*), void*>>   resumes;    // coroutines waiting to be resumed
+  size_t                                          active = 0;   // tasks and resumes currently running
+  bool                                            stop = false; // exit once idle
+  bool                                            abandon = false;
+  io_statistics                                   stats{0, 0, 0, 0, 0.0, 0.0, 0.0};
+  double                                          total_wait = 0.0;
+  double                                          total_run = 0.0;
+  std::thread                                     io_thread;
+  std::thread                                     completion_thread;
+
+  // a running task or resume may queue more work, so the threads may only exit once all three are empty
+  auto idle() const -> bool { return tasks.empty() && resumes.empty() && active == 0; }
+};
+
+auto io_executor::instance() -> io_executor&
+{
+  static io_executor executor;
+  return executor;
+}
+
+/* Tasks run on the I/O thread while awaiting coroutines are resumed on a separate completion thread, so
+ * that the work done by a coroutine after its co_await never delays the next I/O task.  Both threads are
+ * started by the first task and run until release() or destruction. */
+io_executor::io_executor()
+  : state_{new state}
+{ }
+
+io_executor::~io_executor()
+{
+  // tasks which have not yet started are abandoned, breaking the promises of their futures
+  {
+    std::lock_guard<std::mutex> lock{state_->mutex};
+    state_->stop = true;
+    state_->abandon = true;
+  }
+  state_->tasks_cv.notify_all();
+  state_->resumes_cv.notify_all();
+  if (state_->io_thread.joinable())
+    state_->io_thread.join();
+  if (state_->completion_thread.joinable())
+    state_->completion_thread.join();
+}
+
+// start the threads, called with the state mutex held
+auto io_executor::start() -> void
+{
+  auto& st = *state_;
+
+  st.io_thread = std::thread{[&st]
+  {
+    std::unique_lock<std::mutex> lock{st.mutex};
+    while (true)
+    {
+      st.tasks_cv.wait(lock, [&]{ return st.abandon || !st.tasks.empty() || (st.stop && st.idle()); });
+      if (st.abandon || st.tasks.empty())
+        return;
+      auto t = std::move(st.tasks.front());
+      st.tasks.pop_front();
+      ++st.active;
+      auto start = state::clock::now();
+      auto wait = std::chrono::duration<double>(start - t.queued).count();
+      st.total_wait += wait;
+      st.stats.max_wait = std::max(st.stats.max_wait, wait);
+      lock.unlock();
+
+      // tasks are packaged so they never throw, but be defensive since this thread must not die
+      try
+      {
+        t.fn();
+      }
+      catch (...)
+      { }
+      auto run = std::chrono::duration<double>(state::clock::now() - start).count();
+
+      {
+        std::lock_guard<std::mutex> cont_lock{t.cont->mutex};
+        t.cont->done = true;
+        if (t.cont->resume)
+        {
+          std::lock_guard<std::mutex> state_lock{st.mutex};
+          st.resumes.emplace_back(t.cont->resume, t.cont->arg);
+          st.resumes_cv.notify_one();
+        }
+      }
+
+      lock.lock();
+      ++st.stats.completed;
+      st.total_run += run;
+      --st.active;
+      st.resumes_cv.notify_all();
+    }
+  }};
+
+  st.completion_thread = std::thread{[&st]
+  {
+    std::unique_lock<std::mutex> lock{st.mutex};
+    while (true)
+    {
+      st.resumes_cv.wait(lock, [&]{ return st.abandon || !st.resumes.empty() || (st.stop && st.idle()); });
+      if (st.abandon || st.resumes.empty())
+        return;
+      auto r = st.resumes.front();
+      st.resumes.pop_front();
+      ++st.active;
+      lock.unlock();
+      r.first(r.second);
+      lock.lock();
+      --st.active;
+      st.tasks_cv.notify_all();
+    }
+  }};
+}
+
+// wait for all outstanding work and join the threads
+auto io_executor::release() -> void
+{
+  {
+    std::lock_guard<std::mutex> lock{state_->mutex};
+    if (!state_->io_thread.joinable())
+      return;
+    state_->stop = true;
+  }
+  state_->tasks_cv.notify_all();
+  state_->resumes_cv.notify_all();
+  state_->io_thread.join();
+  state_->completion_thread.join();
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  state_->stop = false;
+}
+
+auto io_executor::queue_depth() const -> size_t
+{
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  return state_->tasks.size();
+}
+
+auto io_executor::statistics() const -> io_statistics
+{
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  auto ret = state_->stats;
+  ret.queued = state_->tasks.size();
+  auto started = ret.submitted - ret.queued;
+  ret.mean_wait = started > 0 ? state_->total_wait / started : 0.0;
+  ret.mean_run = ret.completed > 0 ? state_->total_run / ret.completed : 0.0;
+  return ret;
+}
+
+auto io_executor::thread_count() const -> size_t
+{
+  std::lock_guard<std::mutex> lock{state_->mutex};
+  return state_->io_thread.joinable() ? 2 : 0;
+}
+
+auto io_executor::post(std::function<void()> task) -> std::shared_ptr<io_continuation>
+{
+  if (!thread_safe())
+    throw make_error({}, "io executor", nullptr, "thread safe mode must be enabled");
+
+  auto cont = std::make_shared<io_continuation>();
+  {
+    std::lock_guard<std::mutex> lock{state_->mutex};
+    if (!state_->io_thread.joinable())
+      start();
+    state_->tasks.push_back(state::task{std::move(task), cont, state::clock::now()});
+    ++state_->stats.submitted;
+    state_->stats.peak_queued = std::max(state_->stats.peak_queued, state_->tasks.size());
+  }
+  state_->tasks_cv.notify_one();
+  return cont;
+}
+
+auto io_executor::suspend(const std::shared_ptr<io_continuation>& cont, void (*resume)(void*), void* arg) -> bool
+{
+  // if the task has already completed the caller continues without suspending
+  std::lock_guard<std::mutex> lock{cont->mutex};
+  if (cont->done)
+    return false;
+  cont->resume = resume;
+  cont->arg = arg;
+  return true;
+}
+
+handle::handle(const handle& rhs)
+  : id{rhs.id}
+{
+  hdf5_lock lock;
+  if (id > 0)
+    H5Iinc_ref(id);
+}
+
+auto handle::operator=(const handle& rhs) -> handle&
+{
+  hdf5_lock lock;
+  if (id == rhs.id)
+    return *this;
+  if (id > 0)
+    H5Idec_ref(id);
+  id = rhs.id;
+  if (id > 0)
+    H5Iinc_ref(id);
+  return *this;
+}
+
+handle::~handle()
+{
+  hdf5_lock lock;
+  if (id > 0)
+    H5Idec_ref(id);
+}
+
+auto handle::close() -> void
+{
+  hdf5_lock lock;
+  if (id > 0)
+    H5Idec_ref(id);
+  id = -1;
+}
+
+error::error(const char* what)
+  : std::runtime_error{what}
+{
+
+}
+
+/* Attribute names are interned so that each attribute holds only a pointer to its name.  The set of distinct
+ * names seen by a process is small (mostly the ODIM catalogue), so interned names are never released. */
+static auto intern_name(const char* name) -> const std::string*
+{
+  static auto mut = new std::mutex;
+  static auto names = new std::unordered_set<std::string>;
+  std::lock_guard<std::mutex> lock{*mut};
+  return &*names->emplace(name).first;
+}
+
+attribute::attribute(handle::id_t parent, const char* name, bool existing, bool cache)
+  : parent_{parent}
+  , name_{intern_name(name)}
+  , size_{0}
+  , type_{existing ? data_type::unknown : data_type::uninitialized}
+  , cache_{cache}
+  , cached_{false}
+  , scalar_()
+{
+
+}
+
+auto attribute::type() const -> data_type
+{
+  hdf5_lock lock;
+  if (type_ == data_type::unknown)
+    open();
+  return type_;
+}
+
+auto attribute::get_boolean() const -> bool
+{
+  hdf5_lock lock;
+  if (type_ == data_type::unknown)
+    open();
+  if (type_ != data_type::boolean)
+    throw make_error(open(), "type mismatch", name_->c_str(), "boolean");
+  return size_ == 5;
+}
+
+auto attribute::get_integer() const -> long
+{
+  if (cached_)
+  {
+    if (type_ != data_type::integer)
+      throw make_error(parent_, "type mismatch", name_->c_str(), "integer");
+    return scalar_.integer;
+  }
+
+  hdf5_lock lock;
+  auto hnd = open();
+  if (type_ != data_type::integer)
+    throw make_error(hnd, "type mismatch", name_->c_str(), "integer");
+  long val;
+  if (H5Aread(hnd, H5T_NATIVE_LONG, &val) < 0)
+    throw make_error(hnd, "attribute read", name_->c_str(), "integer");
+  return val;
+}
+
+auto attribute::get_real() const -> double
+{
+  if (cached_)
+  {
+    if (type_ != data_type::real)
+      throw make_error(parent_, "type mismatch", name_->c_str(), "real");
+    return scalar_.real;
+  }
+
+  hdf5_lock lock;
+  auto hnd = open();
+  if (type_ != data_type::real)
+    throw make_error(hnd, "type mismatch", name_->c_str(), "real");
+  double val;
+  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
+    throw make_error(hnd, "attribute read", name_->c_str(), "real");
+  return val;
+}
+
+auto attribute::get_string() const -> std::string
+{
+  if (cached_)
+  {
+    if (type_ != data_type::string)
+      throw make_error(parent_, "type mismatch", name_->c_str(), "string");
+    return blob_;
+  }
+
+  hdf5_lock lock;
+  handle type;
+
+  auto hnd = open(&type);
+  if (type_ != data_type::string)
+    throw make_error(hnd, "type mismatch", name_->c_str(), "string");
+
+  // use stack allocation for short strings
+  if (size_ < 256)
+  {
+    char* buf = static_cast<char*>(alloca(size_));
+    if (H5Aread(hnd, type, buf) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "string");
+    return {buf, size_ - 1};
+  }
+  else
+  {
+    std::unique_ptr<char[]> buf{new char[size_]};
+    if (H5Aread(hnd, type, buf.get()) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "string");
+    return {buf.get(), size_ - 1};
+  }
+}
+
+auto attribute::get_integer_array() const -> std::vector<long>
+{
+  std::vector<long> val(array_size());
+  get_integer_array(val.data());
+  return val;
+}
+
+auto attribute::get_real_array() const -> std::vector<double>
+{
+  std::vector<double> val(array_size());
+  get_real_array(val.data());
+  return val;
+}
+
+auto attribute::array_size() const -> size_t
+{
+  hdf5_lock lock;
+  if (type_ == data_type::unknown)
+    open();
+  return type_ == data_type::integer_array || type_ == data_type::real_array ? size_ : 1;
+}
+
+auto attribute::get_integer_array(long* val) const -> void
+{
+  if (cached_)
+  {
+    if (type_ != data_type::integer_array)
+      throw make_error(parent_, "type mismatch", name_->c_str(), "integer_array");
+    memcpy(val, blob_.data(), size_ * sizeof(long));
+    return;
+  }
+
+  hdf5_lock lock;
+  auto hnd = open();
+  if (type_ != data_type::integer_array)
+    throw make_error(hnd, "type mismatch", name_->c_str(), "integer_array");
+  if (H5Aread(hnd, H5T_NATIVE_LONG, val) < 0)
+    throw make_error(hnd, "attribute read", name_->c_str(), "integer_array");
+}
+
+auto attribute::get_real_array(double* val) const -> void
+{
+  if (cached_)
+  {
+    if (type_ != data_type::real_array)
+      throw make_error(parent_, "type mismatch", name_->c_str(), "real_array");
+    memcpy(val, blob_.data(), size_ * sizeof(double));
+    return;
+  }
+
+  hdf5_lock lock;
+  auto hnd = open();
+  if (type_ != data_type::real_array)
+    throw make_error(hnd, "type mismatch", name_->c_str(), "real_array");
+  if (H5Aread(hnd, H5T_NATIVE_DOUBLE, val) < 0)
+    throw make_error(hnd, "attribute read", name_->c_str(), "double_array");
+}
+
+auto attribute::set(bool val) -> void
+{
+  hdf5_lock lock;
+  handle type;
+  auto hnd = open_or_create(data_type::boolean, val ? 5 : 6, &type);
+  if (H5Awrite(hnd, type, val ? "True" : "False") < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "integer");
+  cached_ = cache_;
+}
+
+auto attribute::set(long val) -> void
+{
+  hdf5_lock lock;
+  auto hnd = open_or_create(data_type::integer, 1);
+  if (H5Awrite(hnd, H5T_NATIVE_LONG, &val) < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "integer");
+  scalar_.integer = val;
+  cached_ = cache_;
+}
+
+auto attribute::set(double val) -> void
+{
+  hdf5_lock lock;
+  auto hnd = open_or_create(data_type::real, 1);
+  if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, &val) < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "real");
+  scalar_.real = val;
+  cached_ = cache_;
+}
+
+auto attribute::set(const char* val) -> void
+{
+  hdf5_lock lock;
+  handle type;
+  auto hnd = open_or_create(data_type::string, strlen(val) + 1, &type);
+  if (H5Awrite(hnd, type, val) < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "string");
+  if (cache_)
+    blob_.assign(val);
+  cached_ = cache_;
+}
+
+auto attribute::set(const std::string& val) -> void
+{
+  hdf5_lock lock;
+  handle type;
+  auto hnd = open_or_create(data_type::string, val.size() + 1, &type);
+  if (H5Awrite(hnd, type, val.c_str()) < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "string");
+  if (cache_)
+    blob_ = val;
+  cached_ = cache_;
+}
+
+auto attribute::set(const std::vector<long>& val) -> void
+{
+  hdf5_lock lock;
+  auto hnd = open_or_create(data_type::integer_array, val.size());
+  if (H5Awrite(hnd, H5T_NATIVE_LONG, val.data()) < 0)
+    throw make_error(hnd, "attribute write", name_->c_str(), "integer_array");
+  if (cache_)
+    blob_.assign(reinterpret_cast<const char*>(val.data()), val.size() * sizeof(long));
+  cached_ = cache_;
+}
+
+auto attribute::set(const std::vector<double>& val) -> void
+{
+  hdf5_lock lock;
   auto hnd = open_or_create(data_type::real_array, val.size());
   if (H5Awrite(hnd, H5T_NATIVE_DOUBLE, val.data()) < 0)
-    throw make_error(hnd, "attribute write", name_.c_str(), "real_array");
+    throw make_error(hnd, "attribute write", name_->c_str(), "real_array");
+  if (cache_)
+    blob_.assign(reinterpret_cast<const char*>(val.data()), val.size() * sizeof(double));
+  cached_ = cache_;
 }
 
 // open an existing attribute
 auto attribute::open(handle* type_out) const -> handle
 {
+  hdf5_lock lock;
   // attempt to open the attribute
-  handle hnd{H5Aopen(*parent_, name_.c_str(), H5P_DEFAULT)};
+  handle hnd{H5Aopen(parent_, name_->c_str(), H5P_DEFAULT)};
   if (!hnd)
-    throw make_error(*parent_, "attribute open", name_.c_str());
+    throw make_error(parent_, "attribute open", name_->c_str());
 
   // get the size (array elements)
   handle space{H5Aget_space(hnd)};
   if (!space)
-    throw make_error(hnd, "get attribute space", name_.c_str());
+    throw make_error(hnd, "get attribute space", name_->c_str());
   auto hsize = H5Sget_simple_extent_npoints(space);
   if (hsize < 0)
-    throw make_error(hnd, "get attribute size", name_.c_str());
+    throw make_error(hnd, "get attribute size", name_->c_str());
   size_ = hsize;
 
   // determine the type
   handle type{H5Aget_type(hnd)};
   if (!type)
-    throw make_error(hnd, "get attribute type", name_.c_str());
+    throw make_error(hnd, "get attribute type", name_->c_str());
   switch (H5Tget_class(type))
   {
   case H5T_INTEGER:
@@ -473,7 +1499,7 @@ auto attribute::open(handle* type_out) const -> handle
     {
       char buf[6];
       if (H5Aread(hnd, type, buf) < 0)
-        throw make_error(hnd, "read attribute", name_.c_str());
+        throw make_error(hnd, "read attribute", name_->c_str());
       if (strcmp(buf, "True") == 0 || strcmp(buf, "False") == 0)
         type_ = data_type::boolean;
     }
@@ -491,6 +1517,10 @@ auto attribute::open(handle* type_out) const -> handle
 
 auto attribute::open_or_create(data_type type, size_t size, handle* type_out) -> handle
 {
+  hdf5_lock lock;
+  // the cached value is replaced once the write succeeds
+  cached_ = false;
+
   if (type_ != data_type::uninitialized)
   {
     // if type is a match, just open as normal
@@ -500,8 +1530,8 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
     // typemismatch - delete existing attribute
     if (type_ != data_type::uninitialized)
     {
-      if (H5Adelete(*parent_, name_.c_str()) < 0)
-        throw make_error(*parent_, "delete attribute", name_.c_str());
+      if (H5Adelete(parent_, name_->c_str()) < 0)
+        throw make_error(parent_, "delete attribute", name_->c_str());
     }
   }
 
@@ -517,11 +1547,11 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
       if (   !type
           || H5Tset_size(type, size) < 0
           || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       handle space{H5Screate(H5S_SCALAR)};
-      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
+      handle hnd{H5Acreate(parent_, name_->c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       if (type_out)
         *type_out = std::move(type);
       return hnd;
@@ -530,20 +1560,20 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
     {
       handle space{H5Screate(H5S_SCALAR)};
       if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+        throw make_error(parent_, "create attribute", name_->c_str());
+      handle hnd{H5Acreate(parent_, name_->c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       return hnd;
     }
   case data_type::real:
     {
       handle space{H5Screate(H5S_SCALAR)};
       if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+        throw make_error(parent_, "create attribute", name_->c_str());
+      handle hnd{H5Acreate(parent_, name_->c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       return hnd;
     }
   case data_type::string:
@@ -552,11 +1582,11 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
       if (   !type
           || H5Tset_size(type, size) < 0
           || H5Tset_strpad(type, H5T_STR_NULLTERM) < 0)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       handle space{H5Screate(H5S_SCALAR)};
-      handle hnd{H5Acreate(*parent_, name_.c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
+      handle hnd{H5Acreate(parent_, name_->c_str(), type, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       if (type_out)
         *type_out = std::move(type);
       return hnd;
@@ -566,10 +1596,10 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
       hsize_t dim = size;
       handle space{H5Screate_simple(1, &dim, nullptr)};
       if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+        throw make_error(parent_, "create attribute", name_->c_str());
+      handle hnd{H5Acreate(parent_, name_->c_str(), H5T_STD_I64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       return hnd;
     }
   case data_type::real_array:
@@ -577,83 +1607,465 @@ auto attribute::open_or_create(data_type type, size_t size, handle* type_out) ->
       hsize_t dim = size;
       handle space{H5Screate_simple(1, &dim, nullptr)};
       if (!space)
-        throw make_error(*parent_, "create attribute", name_.c_str());
-      handle hnd{H5Acreate(*parent_, name_.c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
+        throw make_error(parent_, "create attribute", name_->c_str());
+      handle hnd{H5Acreate(parent_, name_->c_str(), H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT)};
       if (!hnd)
-        throw make_error(*parent_, "create attribute", name_.c_str());
+        throw make_error(parent_, "create attribute", name_->c_str());
       return hnd;
     }
   default:
     /* unreacable */
-    throw make_error(*parent_, "create attribute", name_.c_str());
+    throw make_error(parent_, "create attribute", name_->c_str());
   }
 }
 
-static inline auto group_checked_open_or_create(
-      const handle& parent
-    , const char* name
-    , size_t index
-    , bool open
-    ) -> handle::id_t
+// read the value of an existing attribute into the cache
+auto attribute::load() const -> void
 {
-  char buf[32];
-  sprintf(buf, name, index + 1);
-  auto ret = open 
-    ? H5Gopen(parent, buf, H5P_DEFAULT) 
-    : H5Gcreate(parent, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-  if (ret < 0)
-    throw make_error(parent, "group open", buf);
-  return ret;
-}
-
-attribute_store::attribute_store(handle::id_t hnd, bool existing)
+  hdf5_lock lock;
+  handle type;
+  auto hnd = open(&type);
+  switch (type_)
+  {
+  case data_type::boolean:
+    // value is implied by the size
+    break;
+  case data_type::integer:
+    if (H5Aread(hnd, H5T_NATIVE_LONG, &scalar_.integer) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "integer");
+    break;
+  case data_type::real:
+    if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &scalar_.real) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "real");
+    break;
+  case data_type::string:
+    blob_.resize(size_);
+    if (H5Aread(hnd, type, &blob_[0]) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "string");
+    blob_.resize(size_ - 1);
+    break;
+  case data_type::integer_array:
+    blob_.resize(size_ * sizeof(long));
+    if (H5Aread(hnd, H5T_NATIVE_LONG, &blob_[0]) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "integer_array");
+    break;
+  case data_type::real_array:
+    blob_.resize(size_ * sizeof(double));
+    if (H5Aread(hnd, H5T_NATIVE_DOUBLE, &blob_[0]) < 0)
+      throw make_error(hnd, "attribute read", name_->c_str(), "real_array");
+    break;
+  default:
+    // unsupported types are never cached
+    return;
+  }
+  cached_ = true;
+}
+
+static inline auto group_checked_open_or_create(
+      const handle& parent
+    , const char* name
+    , size_t index
+    , bool open
+    ) -> handle::id_t
+{
+  hdf5_lock lock;
+  char buf[32];
+  sprintf(buf, name, index + 1);
+  auto ret = open 
+    ? H5Gopen(parent, buf, H5P_DEFAULT) 
+    : H5Gcreate(parent, buf, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (ret < 0)
+    throw make_error(parent, "group open", buf);
+  return ret;
+}
+
+// open the 'data' dataset of a layer (unless only metadata is wanted) while holding the library lock
+static inline auto dataset_open_data(const handle& parent, bool metadata_only) -> handle::id_t
+{
+  if (metadata_only)
+    return -1;
+  hdf5_lock lock;
+  return H5Dopen(parent, "data", H5P_DEFAULT);
+}
+
+// get the full path of an object within its file
+static auto object_path(const handle& hnd) -> std::string
+{
+  hdf5_lock lock;
+  char buf[256];
+  auto len = H5Iget_name(hnd, buf, sizeof(buf));
+  if (len < 0)
+    throw make_error(hnd, "get object name");
+  if (static_cast<size_t>(len) < sizeof(buf))
+    return std::string(buf, len);
+  std::string ret(len + 1, '\0');
+  if (H5Iget_name(hnd, &ret[0], ret.size()) < 0)
+    throw make_error(hnd, "get object name");
+  ret.resize(len);
+  return ret;
+}
+
+// parse a 'prefixN' path component, returning the position following it or nullptr on mismatch
+static auto parse_path_component(const char* path, const char* prefix, size_t& index) -> const char*
+{
+  auto len = strlen(prefix);
+  if (strncmp(path, prefix, len) != 0 || path[len] < '1' || path[len] > '9')
+    return nullptr;
+  char* end;
+  auto val = strtoul(path + len, &end, 10);
+  if (*end != '\0' && *end != '/')
+    return nullptr;
+  index = val - 1;
+  return end;
+}
+
+constexpr size_t structure_index::npos;
+
+structure_index::structure_index(const handle& hnd, bool dims)
+{
+  hdf5_lock lock;
+  std::map<std::tuple<size_t, size_t, size_t>, layer> layers;
+  size_t datasets = 0;
+
+  // visit every link in the file once, gathering the datasetX, dataX and qualityX groups
+  auto visit = [&](hid_t loc, const char* name)
+  {
+    size_t ds, d = npos, q = npos;
+    auto rest = parse_path_component(name, "dataset", ds);
+    if (!rest)
+      return;
+    if (*rest == '\0')
+    {
+      datasets = std::max(datasets, ds + 1);
+      return;
+    }
+
+    // determine the layer and update the child counts of its parent
+    std::string parent(name, rest);
+    auto pos = rest + 1;
+    if ((rest = parse_path_component(pos, "data", d)))
+    {
+      if (*rest == '/' && (pos = parse_path_component(rest + 1, "quality", q)))
+      {
+        if (*pos == '\0')
+        {
+          auto& n = nodes_["/" + std::string(name, rest)];
+          n.quality_count = std::max(n.quality_count, q + 1);
+        }
+        rest = pos;
+      }
+      else if (*rest == '\0')
+      {
+        auto& n = nodes_["/" + parent];
+        n.data_count = std::max(n.data_count, d + 1);
+      }
+    }
+    else if ((rest = parse_path_component(pos, "quality", q)))
+    {
+      if (*rest == '\0')
+      {
+        auto& n = nodes_["/" + parent];
+        n.quality_count = std::max(n.quality_count, q + 1);
+      }
+    }
+    else
+      return;
+
+    // the sort key places each data layer before its quality layers
+    auto& l = layers[std::make_tuple(ds, d, q + 1)];
+    l.dataset = ds;
+    l.data = d;
+    l.quality = q;
+
+    // gather the layer details
+    if (dims && strcmp(rest, "/data") == 0)
+    {
+      handle dset{H5Dopen(loc, name, H5P_DEFAULT)};
+      if (!dset)
+        throw make_error(hnd, "open dataset", name);
+      handle space{H5Dget_space(dset)};
+      if (!space)
+        throw make_error(dset, "get space");
+      int rank = H5Sget_simple_extent_ndims(space);
+      if (rank < 0)
+        throw make_error(space, "get rank");
+      hsize_t extent[H5S_MAX_RANK];
+      if (H5Sget_simple_extent_dims(space, extent, nullptr) < 0)
+        throw make_error(space, "get dims");
+      l.dims.assign(extent, extent + rank);
+    }
+    else if (strcmp(rest, "/what") == 0)
+    {
+      handle what{H5Gopen(loc, name, H5P_DEFAULT)};
+      if (!what)
+        throw make_error(hnd, "group open", name);
+      auto ret = H5Aexists(what, "quantity");
+      if (ret < 0)
+        throw make_error(what, "check attribute exists", "quantity");
+      if (ret)
+        l.quantity = attribute{what, "quantity", true}.get_string();
+    }
+  };
+
+  struct op_data
+  {
+    decltype(visit)& fn;
+    std::exception_ptr err;
+  };
+  op_data od{visit, nullptr};
+  auto op = [](hid_t loc, const char* name, const H5L_info_t* info, void* odata) -> herr_t
+  {
+    // exceptions must not propagate through the HDF5 library
+    auto p = reinterpret_cast<op_data*>(odata);
+    try
+    {
+      p->fn(loc, name);
+    }
+    catch (...)
+    {
+      p->err = std::current_exception();
+      return -1;
+    }
+    return 0;
+  };
+  if (H5Lvisit(hnd, H5_INDEX_NAME, H5_ITER_NATIVE, op, &od) < 0)
+  {
+    if (od.err)
+      std::rethrow_exception(od.err);
+    throw make_error(hnd, "visit links");
+  }
+
+  datasets_ = datasets;
+  layers_.reserve(layers.size());
+  for (auto& l : layers)
+    layers_.push_back(std::move(l.second));
+}
+
+auto structure_index::data_count(size_t dataset) const -> size_t
+{
+  char name[32];
+  sprintf(name, "/dataset%zu", dataset + 1);
+  auto n = counts(name);
+  return n ? n->data_count : 0;
+}
+
+auto structure_index::quality_count(size_t dataset, size_t data) const -> size_t
+{
+  char name[64];
+  if (data == npos)
+    sprintf(name, "/dataset%zu", dataset + 1);
+  else
+    sprintf(name, "/dataset%zu/data%zu", dataset + 1, data + 1);
+  auto n = counts(name);
+  return n ? n->quality_count : 0;
+}
+
+auto structure_index::find(size_t dataset, size_t data, size_t quality) const -> const layer*
+{
+  // layers are sorted with each data layer before its quality layers
+  auto key = std::make_tuple(dataset, data, quality + 1);
+  auto i = std::lower_bound(layers_.begin(), layers_.end(), key, [](const layer& l, const std::tuple<size_t, size_t, size_t>& k)
+  {
+    return std::make_tuple(l.dataset, l.data, l.quality + 1) < k;
+  });
+  return i != layers_.end() && i->dataset == dataset && i->data == data && i->quality == quality ? &*i : nullptr;
+}
+
+auto structure_index::find(const std::string& quantity) const -> std::vector<const layer*>
+{
+  std::vector<const layer*> ret;
+  for (auto& l : layers_)
+    if (l.quality == npos && l.quantity == quantity)
+      ret.push_back(&l);
+  return ret;
+}
+
+auto structure_index::counts(const std::string& path) const -> const node*
+{
+  auto i = nodes_.find(path);
+  return i != nodes_.end() ? &i->second : nullptr;
+}
+
+namespace odim_h5
+{
+  // least recently used cache of opened dataset and data objects
+  class object_cache
+  {
+  public:
+    // kinds of indexed group which may be cached
+    enum class kind
+    {
+        dataset
+      , data
+      , quality
+    };
+
+  public:
+    object_cache(size_t limit)
+      : limit_{limit}
+      , stats_{0, 0, 0, 0, 0}
+    { }
+
+    auto statistics() const -> cache_statistics
+    {
+      hdf5_lock lock;
+      return stats_;
+    }
+
+    template <class T, class F>
+    auto open(const handle& parent, kind type, size_t index, const std::shared_ptr<file_state>& state, F make) -> T
+    {
+      hdf5_lock lock;
+      char name[32];
+      switch (type)
+      {
+      case kind::dataset:
+        snprintf(name, sizeof(name), "dataset%zu", index + 1);
+        break;
+      case kind::data:
+        snprintf(name, sizeof(name), "data%zu", index + 1);
+        break;
+      case kind::quality:
+        snprintf(name, sizeof(name), "quality%zu", index + 1);
+        break;
+      }
+      auto key = object_path(parent);
+      key.append("/").append(name).append(1, ':').append(typeid(T).name());
+
+      auto i = lookup_.find(key);
+      if (i != lookup_.end())
+      {
+        ++stats_.hits;
+        entries_.splice(entries_.begin(), entries_, i->second);
+        T ret{*static_cast<const T*>(i->second->object.get())};
+        ret.state_ = state;
+        return ret;
+      }
+      ++stats_.misses;
+
+      T ret = make();
+      auto ids = held_ids(ret);
+      if (ids > limit_)
+        return ret;
+
+      // cached copies must not refer to the shared state, otherwise the state would own itself
+      std::unique_ptr<T> copy{new T(ret)};
+      copy->state_.reset();
+      entries_.push_front(entry{key, std::move(copy), ids});
+      lookup_[key] = entries_.begin();
+      ++stats_.objects;
+      stats_.open_ids += ids;
+
+      while (stats_.open_ids > limit_)
+      {
+        auto& victim = entries_.back();
+        stats_.open_ids -= victim.ids;
+        --stats_.objects;
+        ++stats_.evictions;
+        lookup_.erase(victim.key);
+        entries_.pop_back();
+      }
+
+      return ret;
+    }
+
+  private:
+    static auto held_ids(const group& obj) -> size_t
+    {
+      return (obj.hnd_ ? 1 : 0) + (obj.table_->what ? 1 : 0) + (obj.table_->where ? 1 : 0) + (obj.table_->how ? 1 : 0);
+    }
+
+    static auto held_ids(const data& obj) -> size_t
+    {
+      return held_ids(static_cast<const group&>(obj)) + (obj.data_ ? 1 : 0);
+    }
+
+  private:
+    struct entry
+    {
+      std::string             key;
+      std::unique_ptr<group>  object;
+      size_t                  ids;
+    };
+
+  private:
+    size_t                                                        limit_;
+    std::list<entry>                                              entries_;
+    std::unordered_map<std::string, std::list<entry>::iterator>   lookup_;
+    cache_statistics                                              stats_;
+  };
+}
+
+attribute_store::attribute_store(handle::id_t hnd, bool existing, const std::shared_ptr<file_state>& state)
   : hnd_{hnd}
+  , table_(std::make_shared<table>())
+  , state_(state)
 {
+  hdf5_lock lock;
   if (existing)
   {
     if (H5Lexists(hnd_, "what", H5P_DEFAULT) > 0)
-      what_ = H5Gopen(hnd_, "what", H5P_DEFAULT);
+      table_->what = handle{H5Gopen(hnd_, "what", H5P_DEFAULT)};
     if (H5Lexists(hnd_, "where", H5P_DEFAULT) > 0)
-      where_ = H5Gopen(hnd_, "where", H5P_DEFAULT);
+      table_->where = handle{H5Gopen(hnd_, "where", H5P_DEFAULT)};
     if (H5Lexists(hnd_, "how", H5P_DEFAULT) > 0)
-      how_ = H5Gopen(hnd_, "how", H5P_DEFAULT);
+      table_->how = handle{H5Gopen(hnd_, "how", H5P_DEFAULT)};
 
     hsize_t n = 0;
     H5O_info_t info;
 
     // determine the number of attributes available and reserve space in the vector
-    if (what_ && H5Oget_info(what_, &info) >= 0)
+    if (table_->what && H5Oget_info(table_->what, &info) >= 0)
       n += info.num_attrs;
-    if (where_ && H5Oget_info(where_, &info) >= 0)
+    if (table_->where && H5Oget_info(table_->where, &info) >= 0)
       n += info.num_attrs;
-    if (how_ && H5Oget_info(how_, &info) >= 0)
+    if (table_->how && H5Oget_info(table_->how, &info) >= 0)
       n += info.num_attrs;
-    attrs_.reserve(n);
+    table_->attrs.reserve(n);
 
     // define operation needed to iterate through attribute
     struct op_data
     {
       attribute_store& store;
-      handle* hnd;
+      handle::id_t hnd;
+      std::exception_ptr err;
     };
-    op_data od{*this, nullptr};
+    op_data od{*this, -1, nullptr};
     auto op = [](hid_t loc, const char* name, const H5A_info_t* info, void* odata) -> herr_t
     {
       auto p = reinterpret_cast<op_data*>(odata);
-      p->store.attrs_.push_back({p->hnd, name, true});
+      auto& attr = p->store.insert(p->hnd, name, true);
+
+      // when caching read the value now, exceptions must not propagate through the HDF5 library
+      if (p->store.state_->options.cache_attributes)
+      {
+        try
+        {
+          attr.load();
+        }
+        catch (...)
+        {
+          p->err = std::current_exception();
+          return -1;
+        }
+      }
       return 0;
     };
 
     // iterate through each group to fetch the attribute names
-    n = 0; od.hnd = &what_;
-    if (what_ && H5Aiterate(what_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "what");
-    n = 0; od.hnd = &where_;
-    if (where_ && H5Aiterate(where_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "where");
-    n = 0; od.hnd = &how_;
-    if (how_ && H5Aiterate(how_, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
-      throw make_error(hnd_, "iterate attributes", "how");
+    auto iterate = [&](const handle& grp, const char* name)
+    {
+      n = 0; od.hnd = grp;
+      if (grp && H5Aiterate(grp, H5_INDEX_NAME, H5_ITER_NATIVE, &n, op, &od) < 0)
+      {
+        if (od.err)
+          std::rethrow_exception(od.err);
+        throw make_error(hnd_, "iterate attributes", name);
+      }
+    };
+    iterate(table_->what, "what");
+    iterate(table_->where, "where");
+    iterate(table_->how, "how");
   }
 }
 
@@ -661,181 +2073,229 @@ attribute_store::attribute_store(
       const handle& parent
     , const char* name
     , size_t index
-    , bool existing)
-  : attribute_store{group_checked_open_or_create(parent, name, index, existing), existing}
+    , bool existing
+    , const std::shared_ptr<file_state>& state)
+  : attribute_store{group_checked_open_or_create(parent, name, index, existing), existing, state}
 {
 
 }
 
-attribute_store::attribute_store(const attribute_store& rhs)
-  : hnd_{rhs.hnd_}
-  , what_{rhs.what_}
-  , where_{rhs.where_}
-  , how_{rhs.how_}
-  , attrs_(rhs.attrs_)
-{
-  fix_attribute_parents(rhs);
-}
-
 attribute_store::attribute_store(attribute_store&& rhs) noexcept
   : hnd_{std::move(rhs.hnd_)}
-  , what_{std::move(rhs.what_)}
-  , where_{std::move(rhs.where_)}
-  , how_{std::move(rhs.how_)}
-  , attrs_(std::move(rhs.attrs_))
+  , table_(std::move(rhs.table_))
+  , state_(rhs.state_)
 {
-  fix_attribute_parents(rhs);
+  // leave the moved from store empty rather than holding a null table
+  rhs.table_ = empty_table();
 }
 
-auto attribute_store::operator=(const attribute_store& rhs) -> attribute_store&
+auto attribute_store::operator=(attribute_store&& rhs) noexcept -> attribute_store&
 {
-  hnd_ = rhs.hnd_;
-  what_ = rhs.what_;
-  where_ = rhs.where_;
-  how_ = rhs.how_;
-  attrs_ = rhs.attrs_;
-  fix_attribute_parents(rhs);
+  // swap so that the moved from store keeps a consistent handle and table
+  hnd_ = std::move(rhs.hnd_);
+  table_.swap(rhs.table_);
+  state_ = rhs.state_;
   return *this;
 }
 
-auto attribute_store::operator=(attribute_store&& rhs) noexcept -> attribute_store&
+auto attribute_store::empty_table() noexcept -> const std::shared_ptr<table>&
 {
-  hnd_ = std::move(rhs.hnd_);
-  what_ = std::move(rhs.what_);
-  where_ = std::move(rhs.where_);
-  how_ = std::move(rhs.how_);
-  attrs_ = std::move(rhs.attrs_);
-  fix_attribute_parents(rhs);
-  return *this;
+  /* shared by every moved from store, it is never modified because inserting an attribute needs a valid
+   * object handle to create the parent group first */
+  static auto empty = new std::shared_ptr<table>{std::make_shared<table>()};
+  return *empty;
+}
+
+auto attribute_store::insert(handle::id_t parent, const char* name, bool existing) -> attribute&
+{
+  table_->attrs.push_back({parent, name, existing, state_->options.cache_attributes});
+
+  // only index the first occurrence of a name so that lookups match the store order
+  auto key = keys::lookup(name);
+  if (key != keys::id::none)
+  {
+    auto& slot = table_->slots[static_cast<size_t>(key)];
+    if (slot == 0)
+      slot = table_->attrs.size();
+  }
+  else
+  {
+    if (!table_->index)
+      table_->index.reset(new std::unordered_map<std::string, size_t>);
+    table_->index->emplace(name, table_->attrs.size() - 1);
+  }
+
+  return table_->attrs.back();
+}
+
+auto attribute_store::lookup(const char* name) const noexcept -> size_t
+{
+  auto key = keys::lookup(name);
+  if (key != keys::id::none)
+  {
+    auto slot = table_->slots[static_cast<size_t>(key)];
+    return slot != 0 ? slot - 1 : table_->attrs.size();
+  }
+  if (!table_->index)
+    return table_->attrs.size();
+  auto i = table_->index->find(name);
+  return i != table_->index->end() ? i->second : table_->attrs.size();
 }
 
-auto attribute_store::fix_attribute_parents(const attribute_store& old) -> void
+auto attribute_store::reindex() -> void
 {
-  // update the 'parent group' pointers for each attribute
-  for (auto& a : attrs_)
+  memset(table_->slots, 0, sizeof(table_->slots));
+  table_->index.reset();
+  for (size_t i = 0; i < table_->attrs.size(); ++i)
   {
-    if (a.parent_ == &old.what_)
-      a.parent_ = &what_;
-    else if (a.parent_ == &old.where_)
-      a.parent_ = &where_;
+    auto key = keys::lookup(table_->attrs[i].name().c_str());
+    if (key != keys::id::none)
+    {
+      auto& slot = table_->slots[static_cast<size_t>(key)];
+      if (slot == 0)
+        slot = i + 1;
+    }
     else
-      a.parent_ = &how_;
+    {
+      if (!table_->index)
+        table_->index.reset(new std::unordered_map<std::string, size_t>);
+      table_->index->emplace(table_->attrs[i].name(), i);
+    }
   }
 }
 
 auto attribute_store::find(const char* name) noexcept -> iterator
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  return table_->attrs.begin() + lookup(name);
 }
 
 auto attribute_store::find(const char* name) const noexcept -> const_iterator
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  return table_->attrs.begin() + lookup(name);
 }
 
 auto attribute_store::find(const std::string& name) noexcept -> iterator
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  return table_->attrs.begin() + lookup(name.c_str());
 }
 
 auto attribute_store::find(const std::string& name) const noexcept -> const_iterator
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-    if (i->name() == name)
-      return i;
-  return attrs_.end();
+  return table_->attrs.begin() + lookup(name.c_str());
+}
+
+auto attribute_store::find(keys::id key) noexcept -> iterator
+{
+  auto slot = table_->slots[static_cast<size_t>(key)];
+  return slot != 0 ? table_->attrs.begin() + (slot - 1) : table_->attrs.end();
+}
+
+auto attribute_store::find(keys::id key) const noexcept -> const_iterator
+{
+  auto slot = table_->slots[static_cast<size_t>(key)];
+  return slot != 0 ? table_->attrs.begin() + (slot - 1) : table_->attrs.end();
 }
 
 auto attribute_store::operator[](const char* name) -> attribute&
 {
-  for (auto& a : attrs_)
-    if (a.name() == name)
-      return a;
+  auto key = keys::lookup(name);
+  if (key != keys::id::none)
+    return operator[](key);
+
+  if (table_->index)
+  {
+    auto i = table_->index->find(name);
+    if (i != table_->index->end())
+      return table_->attrs[i->second];
+  }
 
   // okay, need to insert it
-  if (is_what_attribute(name))
+  hdf5_lock lock;
+  if (!table_->how)
   {
-    if (!what_)
-    {
-      what_ = handle{H5Gcreate(hnd_, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!what_)
-        throw make_error(hnd_, "create group", "what");
-    }
-    attrs_.push_back({&what_, name, false});
+    table_->how = handle{H5Gcreate(hnd_, "how", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+    if (!table_->how)
+      throw make_error(hnd_, "create group", "how");
   }
-  else if (is_where_attribute(name))
+  return insert(table_->how, name, false);
+}
+
+auto attribute_store::operator[](const char* name) const -> const attribute&
+{
+  auto i = lookup(name);
+  if (i == table_->attrs.size())
+    throw make_error(hnd_, "no such attribute", name);
+  return table_->attrs[i];
+}
+
+auto attribute_store::operator[](keys::id key) -> attribute&
+{
+  auto slot = table_->slots[static_cast<size_t>(key)];
+  if (slot != 0)
+    return table_->attrs[slot - 1];
+
+  // okay, need to insert it
+  hdf5_lock lock;
+  if (::catalogue[static_cast<size_t>(key)].group == key_group::what)
   {
-    if (!where_)
+    if (!table_->what)
     {
-      where_ = handle{H5Gcreate(hnd_, "where", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!where_)
-        throw make_error(hnd_, "create group", "where");
+      table_->what = handle{H5Gcreate(hnd_, "what", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!table_->what)
+        throw make_error(hnd_, "create group", "what");
     }
-    attrs_.push_back({&where_, name, false});
+    return insert(table_->what, keys::name(key), false);
   }
   else
   {
-    if (!how_)
+    if (!table_->where)
     {
-      how_ = handle{H5Gcreate(hnd_, "how", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
-      if (!how_)
-        throw make_error(hnd_, "create group", "how");
+      table_->where = handle{H5Gcreate(hnd_, "where", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT)};
+      if (!table_->where)
+        throw make_error(hnd_, "create group", "where");
     }
-    attrs_.push_back({&how_, name, false});
+    return insert(table_->where, keys::name(key), false);
   }
-  return attrs_.back();
 }
 
-auto attribute_store::operator[](const char* name) const -> const attribute&
+auto attribute_store::operator[](keys::id key) const -> const attribute&
 {
-  for (auto& a : attrs_)
-    if (a.name() == name)
-      return a;
-  throw make_error(hnd_, "no such attribute", name);
+  auto slot = table_->slots[static_cast<size_t>(key)];
+  if (slot == 0)
+    throw make_error(hnd_, "no such attribute", keys::name(key));
+  return table_->attrs[slot - 1];
 }
 
 auto attribute_store::erase(iterator i) -> void
 {
+  hdf5_lock lock;
   // remove the attribute from the file
   if (i->type_ != attribute::data_type::uninitialized)
   {
-    if (H5Adelete(*i->parent_, i->name().c_str()) < 0)
+    if (H5Adelete(i->parent_, i->name().c_str()) < 0)
       throw make_error(hnd_, "attribute delete", i->name().c_str());
   }
   
   // now remove it from the store
-  attrs_.erase(i);
+  table_->attrs.erase(i);
+  reindex();
 }
 
 auto attribute_store::erase(const std::string& name) -> void
 {
-  for (auto i = attrs_.begin(); i != attrs_.end(); ++i)
-  {
-    if (i->name() == name)
-    {
-      erase(i);
-      break;
-    }
-  }
+  auto i = find(name);
+  if (i != table_->attrs.end())
+    erase(i);
 }
 
-group::group(handle::id_t hnd, bool existing)
-  : attribute_store{hnd, existing}
+group::group(handle::id_t hnd, bool existing, const std::shared_ptr<file_state>& state)
+  : attribute_store{hnd, existing, state}
 {
 
 }
 
-group::group(const handle& parent, const char* name, size_t index, bool existing)
-  : attribute_store{parent, name, index, existing}
+group::group(const handle& parent, const char* name, size_t index, bool existing, const std::shared_ptr<file_state>& state)
+  : attribute_store{parent, name, index, existing, state}
 {
 
 }
@@ -850,89 +2310,334 @@ auto group::is_api_attribute(const std::string& name) const -> bool
   return false;
 }
 
-data::data(const handle& parent, bool quality, size_t index)
-  : group{parent, quality ? "quality%zu" : "data%zu", index, true}
-  , size_quality_{0}
-  , data_{H5Dopen(hnd_, "data", H5P_DEFAULT)}
+selection::selection(size_t rank)
+  : rank_{rank}
+  , size_{0}
 {
-  if (!data_)
-    throw make_error(hnd_, "open dataset", "data");
-
-  // determine the number of dataX and qualityX layers
-  H5G_info_t info;
-  if (H5Gget_info(hnd_, &info) < 0)
-    throw make_error(hnd_, "get group info");
-  if (what_) --info.nlinks;
-  if (where_) --info.nlinks;
-  if (how_) --info.nlinks;
-  for (size_t i = info.nlinks; i > 0; --i)
-  {
-    char name[32];
-    sprintf(name, "quality%zu", i);
-    htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-    if (ret < 0)
-      throw make_error(hnd_, "check group exists", name);
-    if (ret)
-    {
-      size_quality_ = i;
-      break;
-    }
-  }
+  if (rank_ > data::max_rank)
+    throw make_error({}, "create selection", nullptr, "rank too large");
 }
 
-data::data(
-      const handle& parent
-    , bool quality
-    , size_t index
-    , data_type type
-    , size_t rank
-    , const size_t* dims
-    , int compression)
-  : group{parent, quality ? "quality%zu" : "data%zu", index, false}
-  , size_quality_{0}
+selection::selection(size_t rank, const size_t* start, const size_t* count, const size_t* stride)
+  : selection{rank}
 {
-  // convert dimension array to hdf size type
-  hsize_t hdims[max_rank];
-  for (size_t i = 0; i < rank; ++i)
-    hdims[i] = dims[i];
-
-  // create the dataset
-  handle space{H5Screate_simple(rank, hdims, hdims)};
-  if (!space)
-    throw make_error(hnd_, "create dataset");
-  handle plist{H5Pcreate(H5P_DATASET_CREATE)};
-  if (!plist)
-    throw make_error(hnd_, "create dataset");
-  if (   H5Pset_chunk(plist, rank, hdims) < 0
-      || (   compression > 0
-          && H5Pset_deflate(plist, compression) < 0))
-    throw make_error(hnd_, "create dataset");
-  data_ = H5Dcreate(hnd_, "data", hdf_storage_type(type), space, H5P_DEFAULT, plist, H5P_DEFAULT);
-  if (!data_)
-    throw make_error(hnd_, "create dataset");
+  add(start, count, stride);
+}
 
-  // if 2d, add the image attributes (for sake of hdfview)
-  if (rank == 2)
+auto selection::add(const size_t* start, const size_t* count, const size_t* stride) -> void
+{
+  size_t n = 1;
+  for (size_t i = 0; i < rank_; ++i)
   {
-    attribute{&data_, "CLASS", false}.set("IMAGE");
-    attribute{&data_, "IMAGE_VERSION", false}.set("1.2");
+    if (stride && stride[i] == 0)
+      throw make_error({}, "add selection box", nullptr, "zero stride");
+    n *= count[i];
   }
-}
 
-auto data::quality_open(size_t i) const -> data
-{
-  return {hnd_, true, i};
-}
+  boxes_.insert(boxes_.end(), start, start + rank_);
+  boxes_.insert(boxes_.end(), count, count + rank_);
+  if (stride)
+    boxes_.insert(boxes_.end(), stride, stride + rank_);
+  else
+    boxes_.insert(boxes_.end(), rank_, 1);
+  size_ += n;
 
-auto data::quality_append(data_type type, size_t rank, const size_t* dims, int compression) -> data
-{
-  return {hnd_, true, size_quality_++, type, rank, dims, compression};
+  // invalidate any cached dataspaces
+  dims_.clear();
+  file_space_.close();
+  mem_space_.close();
 }
 
-auto data::type() const -> data_type
+auto selection::prepare(const handle& dset) const -> void
 {
-  handle id{H5Dget_type(data_)};
-  if (!id)
+  hdf5_lock lock;
+  handle space{H5Dget_space(dset)};
+  if (!space)
+    throw make_error(dset, "get dataset space");
+  hsize_t dims[H5S_MAX_RANK];
+  auto rank = H5Sget_simple_extent_dims(space, dims, nullptr);
+  if (rank < 0)
+    throw make_error(dset, "get dataset dims");
+  if (static_cast<size_t>(rank) != rank_)
+    throw make_error(dset, "read selection", nullptr, "selection rank mismatch");
+
+  // reuse the cached dataspaces if the dimensions match
+  if (file_space_ && std::equal(dims_.begin(), dims_.end(), dims))
+    return;
+
+  hsize_t start[H5S_MAX_RANK], count[H5S_MAX_RANK], stride[H5S_MAX_RANK];
+  for (size_t b = 0; b < box_count(); ++b)
+  {
+    for (size_t i = 0; i < rank_; ++i)
+    {
+      start[i] = this->start(b)[i];
+      count[i] = this->count(b)[i];
+      stride[i] = this->stride(b)[i];
+    }
+    if (H5Sselect_hyperslab(space, b == 0 ? H5S_SELECT_SET : H5S_SELECT_OR, start, stride, count, nullptr) < 0)
+      throw make_error(dset, "select hyperslab");
+  }
+  if (box_count() == 0 && H5Sselect_none(space) < 0)
+    throw make_error(dset, "select hyperslab");
+  if (H5Sselect_valid(space) <= 0)
+    throw make_error(dset, "read selection", nullptr, "selection out of bounds");
+
+  hsize_t npoints = size_;
+  handle mem_space{npoints > 0 ? H5Screate_simple(1, &npoints, nullptr) : H5Screate(H5S_NULL)};
+  if (!mem_space)
+    throw make_error(dset, "create memory space");
+
+  dims_.assign(dims, dims + rank);
+  file_space_ = std::move(space);
+  mem_space_ = std::move(mem_space);
+}
+
+chunk_layout::chunk_layout(access_pattern pattern)
+  : pattern_{pattern}
+{
+
+}
+
+chunk_layout::chunk_layout(size_t rank, const size_t* shape)
+  : pattern_{access_pattern::whole}
+  , shape_(shape, shape + rank)
+{
+  for (auto s : shape_)
+    if (s == 0)
+      throw make_error({}, "create chunk layout", nullptr, "zero chunk dimension");
+}
+
+auto chunk_layout::resolve(size_t rank, const size_t* dims, size_t element_size, size_t* chunk) const -> void
+{
+  // size of an automatically selected chunk - HDF5 recommends between 10KiB and 1MiB
+  constexpr size_t target_bytes = 64 * 1024;
+
+  if (!shape_.empty())
+  {
+    if (shape_.size() != rank)
+      throw make_error({}, "resolve chunk layout", nullptr, "chunk rank mismatch");
+    for (size_t i = 0; i < rank; ++i)
+      chunk[i] = std::max<size_t>(std::min(shape_[i], dims[i]), 1);
+    return;
+  }
+
+  for (size_t i = 0; i < rank; ++i)
+    chunk[i] = std::max<size_t>(dims[i], 1);
+  if (rank == 0 || pattern_ == access_pattern::whole || pattern_ == access_pattern::contiguous)
+    return;
+
+  const size_t target = std::max<size_t>(target_bytes / std::max<size_t>(element_size, 1), 1);
+  if (pattern_ == access_pattern::ray_major || rank == 1)
+  {
+    // whole rows, with as many rows in each chunk as fit in the target size
+    size_t row = 1;
+    for (size_t i = 1; i < rank; ++i)
+      row *= chunk[i];
+    chunk[0] = std::min(chunk[0], std::max<size_t>(target / row, 1));
+  }
+  else
+  {
+    // square tiles over the two innermost dimensions, one element deep in any outer dimensions
+    for (size_t i = 0; i < rank - 2; ++i)
+      chunk[i] = 1;
+    auto& y = chunk[rank - 2];
+    auto& x = chunk[rank - 1];
+    size_t side = 1;
+    while ((side * 2) * (side * 2) <= target)
+      side *= 2;
+    if (y <= side)
+      x = std::min(x, std::max<size_t>(target / y, 1));
+    else if (x <= side)
+      y = std::min(y, std::max<size_t>(target / x, 1));
+    else
+      x = y = side;
+  }
+}
+
+compression_policy::compression_policy(int level)
+  : defaults_{level > 0 ? codec::deflate : codec::none, level, false}
+{
+
+}
+
+compression_policy::compression_policy(codec type, int level, bool shuffle)
+  : defaults_{type, level, shuffle}
+{
+  if (type == codec::other)
+    throw make_error({}, "create compression policy", nullptr, "unsupported compression codec");
+}
+
+auto compression_policy::set_override(const std::string& quantity, codec type, int level, bool shuffle) -> void
+{
+  if (type == codec::other)
+    throw make_error({}, "set compression override", quantity.c_str(), "unsupported compression codec");
+  for (auto& o : overrides_)
+  {
+    if (o.first == quantity)
+    {
+      o.second = settings{type, level, shuffle};
+      return;
+    }
+  }
+  overrides_.emplace_back(quantity, settings{type, level, shuffle});
+}
+
+auto compression_policy::erase_override(const std::string& quantity) -> void
+{
+  for (auto i = overrides_.begin(); i != overrides_.end(); ++i)
+  {
+    if (i->first == quantity)
+    {
+      overrides_.erase(i);
+      return;
+    }
+  }
+}
+
+auto compression_policy::lookup(const std::string& quantity) const noexcept -> const settings&
+{
+  for (auto& o : overrides_)
+    if (o.first == quantity)
+      return o.second;
+  return defaults_;
+}
+
+data::data(const handle& parent, bool quality, size_t index, const std::shared_ptr<file_state>& state)
+  : group{parent, quality ? "quality%zu" : "data%zu", index, true, state}
+  , size_quality_{0}
+  , data_{dataset_open_data(hnd_, state->options.metadata_only)}
+{
+  hdf5_lock lock;
+  if (!data_ && !state->options.metadata_only)
+    throw make_error(hnd_, "open dataset", "data");
+
+  // use the counts gathered when the file was indexed
+  if (state_->structure)
+  {
+    if (auto node = state_->structure->counts(object_path(hnd_)))
+      size_quality_ = node->quality_count;
+    return;
+  }
+
+  // determine the number of dataX and qualityX layers
+  H5G_info_t info;
+  if (H5Gget_info(hnd_, &info) < 0)
+    throw make_error(hnd_, "get group info");
+  if (table_->what) --info.nlinks;
+  if (table_->where) --info.nlinks;
+  if (table_->how) --info.nlinks;
+  for (size_t i = info.nlinks; i > 0; --i)
+  {
+    char name[32];
+    sprintf(name, "quality%zu", i);
+    htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
+    if (ret < 0)
+      throw make_error(hnd_, "check group exists", name);
+    if (ret)
+    {
+      size_quality_ = i;
+      break;
+    }
+  }
+}
+
+data::data(
+      const handle& parent
+    , bool quality
+    , size_t index
+    , const std::shared_ptr<file_state>& state
+    , data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy::settings& compression
+    , const chunk_layout& layout)
+  : group{parent, quality ? "quality%zu" : "data%zu", index, false, state}
+  , size_quality_{0}
+{
+  hdf5_lock lock;
+
+  // convert dimension array to hdf size type and determine the chunk shape
+  hsize_t hdims[max_rank], hchunk[max_rank];
+  size_t chunk[max_rank];
+  layout.resolve(rank, dims, H5Tget_size(hdf_storage_type(type)), chunk);
+  for (size_t i = 0; i < rank; ++i)
+  {
+    hdims[i] = dims[i];
+    hchunk[i] = chunk[i];
+  }
+
+  // create the dataset
+  handle space{H5Screate_simple(rank, hdims, hdims)};
+  if (!space)
+    throw make_error(hnd_, "create dataset");
+  handle plist{H5Pcreate(H5P_DATASET_CREATE)};
+  if (!plist)
+    throw make_error(hnd_, "create dataset");
+  if (!layout.is_explicit() && layout.pattern() == chunk_layout::access_pattern::contiguous)
+  {
+    // allocate storage up front so that the layer can always be mapped
+    if (H5Pset_layout(plist, H5D_CONTIGUOUS) < 0 || H5Pset_alloc_time(plist, H5D_ALLOC_TIME_EARLY) < 0)
+      throw make_error(hnd_, "create dataset");
+  }
+  else
+  {
+    if (H5Pset_chunk(plist, rank, hchunk) < 0)
+      throw make_error(hnd_, "create dataset");
+    set_compression_filters(hnd_, plist, compression);
+  }
+  data_ = handle{H5Dcreate(hnd_, "data", hdf_storage_type(type), space, H5P_DEFAULT, plist, H5P_DEFAULT)};
+  if (!data_)
+    throw make_error(hnd_, "create dataset");
+
+  // if 2d, add the image attributes (for sake of hdfview)
+  if (rank == 2)
+  {
+    attribute{data_, "CLASS", false}.set("IMAGE");
+    attribute{data_, "IMAGE_VERSION", false}.set("1.2");
+  }
+}
+
+auto data::quality_open(size_t i) const -> data
+{
+  hdf5_lock lock;
+  if (state_->cache)
+    return state_->cache->open<data>(hnd_, object_cache::kind::quality, i, state_, [&]() -> data { return {hnd_, true, i, state_}; });
+  return {hnd_, true, i, state_};
+}
+
+auto data::quality_append(
+      data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  check_layer_settings(hnd_, compression.defaults(), layout);
+  return {hnd_, true, size_quality_++, state_, type, rank, dims, compression.defaults(), layout};
+}
+
+auto data::quality_append(
+      const std::string& quantity
+    , data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  auto& comp = compression.lookup(quantity);
+  check_layer_settings(hnd_, comp, layout);
+  data ret{hnd_, true, size_quality_++, state_, type, rank, dims, comp, layout};
+  ret.set_quantity(quantity);
+  return ret;
+}
+
+auto data::type() const -> data_type
+{
+  hdf5_lock lock;
+  handle id{H5Dget_type(data_)};
+  if (!id)
     throw make_error(hnd_, "get dataset type");
 
   auto type = H5Tget_class(id);
@@ -969,6 +2674,7 @@ auto data::type() const -> data_type
 
 auto data::rank() const -> size_t
 {
+  hdf5_lock lock;
   handle space{H5Dget_space(data_)};
   if (!space)
     throw make_error(hnd_, "get dataset rank");
@@ -980,6 +2686,7 @@ auto data::rank() const -> size_t
 
 auto data::dims(size_t* val) const -> size_t
 {
+  hdf5_lock lock;
   handle space{H5Dget_space(data_)};
   if (!space)
     throw make_error(hnd_, "get dataset dims");
@@ -994,6 +2701,7 @@ auto data::dims(size_t* val) const -> size_t
 
 auto data::size() const -> size_t
 {
+  hdf5_lock lock;
   handle space{H5Dget_space(data_)};
   if (!space)
     throw make_error(hnd_, "get dataset size");
@@ -1003,54 +2711,97 @@ auto data::size() const -> size_t
   return ret;
 }
 
+auto data::compression() const -> compression_policy::settings
+{
+  hdf5_lock lock;
+  handle plist{H5Dget_create_plist(data_)};
+  if (!plist)
+    throw make_error(hnd_, "get dataset creation properties");
+
+  compression_policy::settings ret{compression_policy::codec::none, 0, false};
+  auto n = H5Pget_nfilters(plist);
+  if (n < 0)
+    throw make_error(hnd_, "get dataset filters");
+  for (int i = 0; i < n; ++i)
+  {
+    unsigned int flags, cd_values[8];
+    size_t cd_nelmts = 8;
+    auto id = H5Pget_filter2(plist, i, &flags, &cd_nelmts, cd_values, 0, nullptr, nullptr);
+    switch (id)
+    {
+    case H5Z_FILTER_SHUFFLE:
+      ret.shuffle = true;
+      break;
+    case H5Z_FILTER_DEFLATE:
+      ret.type = compression_policy::codec::deflate;
+      ret.level = cd_nelmts > 0 ? cd_values[0] : 0;
+      break;
+    case filter_lz4:
+      ret.type = compression_policy::codec::lz4;
+      ret.level = 0;
+      break;
+    case filter_zstd:
+      ret.type = compression_policy::codec::zstd;
+      ret.level = cd_nelmts > 0 ? cd_values[0] : 0;
+      break;
+    case H5Z_FILTER_FLETCHER32:
+      break;
+    default:
+      ret.type = compression_policy::codec::other;
+      ret.level = 0;
+    }
+  }
+  return ret;
+}
+
 auto data::quantity() const -> std::string
 {
-  return attributes()["quantity"].get_string();
+  return attributes()[keys::id::quantity].get_string();
 }
 
 auto data::set_quantity(const std::string& val) -> void
 {
-  attributes()["quantity"].set(val);
+  attributes()[keys::id::quantity].set(val);
 }
 
 auto data::gain() const -> double
 {
-  return attributes()["gain"].get_real();
+  return attributes()[keys::id::gain].get_real();
 }
 
 auto data::set_gain(double val) -> void
 {
-  attributes()["gain"].set(val);
+  attributes()[keys::id::gain].set(val);
 }
 
 auto data::offset() const -> double
 {
-  return attributes()["offset"].get_real();
+  return attributes()[keys::id::offset].get_real();
 }
 
 auto data::set_offset(double val) -> void
 {
-  attributes()["offset"].set(val);
+  attributes()[keys::id::offset].set(val);
 }
 
 auto data::nodata() const -> double
 {
-  return attributes()["nodata"].get_real();
+  return attributes()[keys::id::nodata].get_real();
 }
 
 auto data::set_nodata(double val) -> void
 {
-  attributes()["nodata"].set(val);
+  attributes()[keys::id::nodata].set(val);
 }
 
 auto data::undetect() const -> double
 {
-  return attributes()["undetect"].get_real();
+  return attributes()[keys::id::undetect].get_real();
 }
 
 auto data::set_undetect(double val) -> void
 {
-  attributes()["undetect"].set(val);
+  attributes()[keys::id::undetect].set(val);
 }
 
 auto data::is_api_attribute(const std::string& name) const -> bool
@@ -1067,9 +2818,13 @@ auto data::is_api_attribute(const std::string& name) const -> bool
 template <typename T>
 auto data::read(T* data) const -> void
 {
+  hdf5_lock lock;
   auto err = H5Dread(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
   if (err < 0)
+  {
+    check_filters_available(data_);
     throw make_error(hnd_, "read dataset", "data", err);
+  }
 }
 
 template auto data::read<char>(char* data) const -> void;
@@ -1087,9 +2842,40 @@ template auto data::read<float>(float* data) const -> void;
 template auto data::read<double>(double* data) const -> void;
 template auto data::read<long double>(long double* data) const -> void;
 
+template <typename T>
+auto data::read(T* data, const selection& sel) const -> void
+{
+  hdf5_lock lock;
+  sel.prepare(data_);
+  if (sel.size() == 0)
+    return;
+  auto err = H5Dread(data_, hdf_native_type<T>(), sel.mem_space_, sel.file_space_, H5P_DEFAULT, data);
+  if (err < 0)
+  {
+    check_filters_available(data_);
+    throw make_error(hnd_, "read dataset", "data", err);
+  }
+}
+
+template auto data::read<char>(char* data, const selection& sel) const -> void;
+template auto data::read<signed char>(signed char* data, const selection& sel) const -> void;
+template auto data::read<unsigned char>(unsigned char* data, const selection& sel) const -> void;
+template auto data::read<short>(short* data, const selection& sel) const -> void;
+template auto data::read<unsigned short>(unsigned short* data, const selection& sel) const -> void;
+template auto data::read<int>(int* data, const selection& sel) const -> void;
+template auto data::read<unsigned int>(unsigned int* data, const selection& sel) const -> void;
+template auto data::read<long>(long* data, const selection& sel) const -> void;
+template auto data::read<unsigned long>(unsigned long* data, const selection& sel) const -> void;
+template auto data::read<long long>(long long* data, const selection& sel) const -> void;
+template auto data::read<unsigned long long>(unsigned long long* data, const selection& sel) const -> void;
+template auto data::read<float>(float* data, const selection& sel) const -> void;
+template auto data::read<double>(double* data, const selection& sel) const -> void;
+template auto data::read<long double>(long double* data, const selection& sel) const -> void;
+
 template <typename T>
 auto data::write(const T* data) -> void
 {
+  hdf5_lock lock;
   auto err = H5Dwrite(data_, hdf_native_type<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
   if (err < 0)
     throw make_error(hnd_, "write dataset", "data", err);
@@ -1110,100 +2896,1715 @@ template auto data::write<float>(const float* data) -> void;
 template auto data::write<double>(const double* data) -> void;
 template auto data::write<long double>(const long double* data) -> void;
 
-dataset::dataset(const handle& parent, size_t index, bool existing)
-  : group{parent, "dataset%zu", index, existing}
-  , size_data_{0}
-  , size_quality_{0}
+/* Decode tables:
+ * For 8 and 16 bit storage every possible packed value can be decoded ahead of time.  Tables are built
+ * using the arithmetic kernel so that both strategies are guaranteed to give identical results.  Since
+ * most layers of a given moment share the same packing, tables are cached globally and keyed on the
+ * packing and output parameters.  Tables are built outside the lock and the least recently used table
+ * is evicted once the cache is full. */
+static constexpr size_t max_decode_tables = 64;
+
+namespace
 {
-  if (existing)
+  struct decode_table_entry
   {
-    // determine the number of dataX and qualityX layers
-    H5G_info_t info;
-    if (H5Gget_info(hnd_, &info) < 0)
-      throw make_error(hnd_, "get group info");
-    if (what_) --info.nlinks;
-    if (where_) --info.nlinks;
-    if (how_) --info.nlinks;
-    for (size_t i = info.nlinks; i > 0; --i)
-    {
-      char name[32];
-      sprintf(name, "data%zu", i);
-      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-      if (ret < 0)
-        throw make_error(hnd_, "check group exists", name);
-      if (ret)
-      {
-        size_data_ = i;
-        break;
-      }
-    }
-    info.nlinks -= size_data_;
-    for (size_t i = info.nlinks; i > 0; --i)
+    std::string                 key;
+    std::shared_ptr<const void> table;
+  };
+}
+
+static std::mutex decode_tables_mutex_;
+static std::list<decode_table_entry> decode_tables_;
+static std::map<std::string, std::list<decode_table_entry>::iterator> decode_tables_lookup_;
+
+// integers are keyed on their bytes, which never include padding
+template <typename V>
+static auto append_key(std::string& key, V val) -> typename std::enable_if<std::is_integral<V>::value>::type
+{
+  key.append(reinterpret_cast<const char*>(&val), sizeof(V));
+}
+
+// floating point values are keyed on their exact hexadecimal form, which skips the padding of long double
+template <typename V>
+static auto append_key(std::string& key, V val) -> typename std::enable_if<std::is_floating_point<V>::value>::type
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%La:", static_cast<long double>(val));
+  key.append(buf);
+}
+
+template <typename S, typename T>
+static auto decode_table(double a, double b, S ud, S nd, T undetect, T nodata) -> std::shared_ptr<const T>
+{
+  std::string key{typeid(S).name()};
+  key.push_back(':');
+  key.append(typeid(T).name());
+  key.push_back(':');
+  append_key(key, a);
+  append_key(key, b);
+  append_key(key, ud);
+  append_key(key, nd);
+  append_key(key, undetect);
+  append_key(key, nodata);
+
+  {
+    std::lock_guard<std::mutex> lock{decode_tables_mutex_};
+    auto i = decode_tables_lookup_.find(key);
+    if (i != decode_tables_lookup_.end())
     {
-      char name[32];
-      sprintf(name, "quality%zu", i);
-      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
-      if (ret < 0)
-        throw make_error(hnd_, "check group exists", name);
-      if (ret)
-      {
-        size_quality_ = i;
-        break;
-      }
+      decode_tables_.splice(decode_tables_.begin(), decode_tables_, i->second);
+      return std::static_pointer_cast<const T>(i->second->table);
     }
   }
+
+  using U = typename std::make_unsigned<S>::type;
+  constexpr size_t entries = size_t(std::numeric_limits<U>::max()) + 1;
+  std::unique_ptr<S[]> codes{new S[entries]};
+  for (size_t i = 0; i < entries; ++i)
+    codes[i] = static_cast<S>(static_cast<U>(i));
+  std::shared_ptr<T> table{new T[entries], std::default_delete<T[]>()};
+  unpack_kernel(static_cast<const S*>(codes.get()), table.get(), entries, a, b, ud, nd, undetect, nodata);
+
+  std::lock_guard<std::mutex> lock{decode_tables_mutex_};
+
+  // another thread may have built the same table while we were
+  auto i = decode_tables_lookup_.find(key);
+  if (i != decode_tables_lookup_.end())
+  {
+    decode_tables_.splice(decode_tables_.begin(), decode_tables_, i->second);
+    return std::static_pointer_cast<const T>(i->second->table);
+  }
+
+  decode_tables_.push_front(decode_table_entry{key, table});
+  decode_tables_lookup_[std::move(key)] = decode_tables_.begin();
+  while (decode_tables_.size() > max_decode_tables)
+  {
+    decode_tables_lookup_.erase(decode_tables_.back().key);
+    decode_tables_.pop_back();
+  }
+  return table;
 }
 
-auto dataset::data_open(size_t i) const -> data
+auto data::clear_decode_tables() -> void
 {
-  return {hnd_, false, i};
+  std::lock_guard<std::mutex> lock{decode_tables_mutex_};
+  decode_tables_lookup_.clear();
+  decode_tables_.clear();
 }
 
-auto dataset::data_append(data::data_type type, size_t rank, const size_t* dims, int compression) -> data
+template <typename S, typename T>
+static auto lookup_kernel(const S* in, T* out, size_t size, const T* table) -> void
 {
-  return {hnd_, false, size_data_++, type, rank, dims, compression};
+  using U = typename std::make_unsigned<S>::type;
+  for (size_t i = 0; i < size; ++i)
+    out[i] = table[static_cast<U>(in[i])];
 }
 
-auto dataset::quality_open(size_t i) const -> data
+// unpack using the requested strategy where lookup is available for the storage type
+template <typename S, typename T>
+static auto unpack_values(
+      const S* in
+    , T* out
+    , size_t size
+    , double a
+    , double b
+    , S ud
+    , S nd
+    , T undetect
+    , T nodata
+    , data::decode_strategy strategy
+    ) -> typename std::enable_if<std::is_integral<S>::value && sizeof(S) <= 2>::type
 {
-  return {hnd_, true, i};
+  if (   strategy == data::decode_strategy::lookup
+      || (strategy == data::decode_strategy::automatic && !std::is_floating_point<T>::value))
+  {
+    auto table = decode_table(a, b, ud, nd, undetect, nodata);
+    lookup_kernel(in, out, size, table.get());
+  }
+  else
+    unpack_kernel(in, out, size, a, b, ud, nd, undetect, nodata);
+}
+
+template <typename S, typename T>
+static auto unpack_values(
+      const S* in
+    , T* out
+    , size_t size
+    , double a
+    , double b
+    , S ud
+    , S nd
+    , T undetect
+    , T nodata
+    , data::decode_strategy strategy
+    ) -> typename std::enable_if<!std::is_integral<S>::value || (sizeof(S) > 2)>::type
+{
+  unpack_kernel(in, out, size, a, b, ud, nd, undetect, nodata);
+}
+
+// check whether the nodata and undetect codes can be represented exactly in the storage type
+template <typename S>
+static auto codes_representable(double nd, double ud) -> bool
+{
+  return
+       nd >= std::numeric_limits<S>::lowest() && nd <= std::numeric_limits<S>::max() && static_cast<S>(nd) == nd
+    && ud >= std::numeric_limits<S>::lowest() && ud <= std::numeric_limits<S>::max() && static_cast<S>(ud) == ud;
+}
+
+// read a data layer in its storage type and unpack into the output buffer in a single pass
+template <typename S, typename T>
+static auto read_unpack_stored(
+      const handle& loc
+    , const handle& dset
+    , T* data
+    , size_t size
+    , hid_t mem_space
+    , hid_t file_space
+    , double a
+    , double b
+    , double nd
+    , double ud
+    , T undetect
+    , T nodata
+    , data::decode_strategy strategy
+    ) -> bool
+{
+  // if the nodata or undetect codes can't be represented in the storage type then fall back to the
+  // generic path rather than risk a false match on a truncated code
+  if (!codes_representable<S>(nd, ud))
+    return false;
+
+  // when the storage and output types match we can unpack in place
+  auto in = std::is_same<S, T>::value ? reinterpret_cast<S*>(data) : static_cast<S*>(scratch_buffer(size * sizeof(S)));
+  herr_t err;
+  {
+    hdf5_lock lock;
+    err = H5Dread(dset, hdf_native_type<S>(), mem_space, file_space, H5P_DEFAULT, in);
+  }
+  if (err < 0)
+  {
+    check_filters_available(dset);
+    throw make_error(loc, "read dataset", "data", err);
+  }
+  unpack_values(static_cast<const S*>(in), data, size, a, b, static_cast<S>(ud), static_cast<S>(nd), undetect, nodata, strategy);
+  return true;
 }
 
-auto dataset::quality_append(data::data_type type, size_t rank, const size_t* dims, int compression) -> data
+template <typename T>
+auto data::read_unpack(T* data, T undetect, T nodata, decode_strategy strategy) const -> void
 {
-  return {hnd_, true, size_quality_++, type, rank, dims, compression};
+  read_unpack(data, undetect, nodata, size(), H5S_ALL, H5S_ALL, strategy);
 }
 
-static inline auto file_checked_open_or_create(
-      const char* path
-    , file::io_mode mode
-    ) -> handle::id_t
+template <typename T>
+auto data::read_unpack(T* data, T undetect, T nodata, const selection& sel, decode_strategy strategy) const -> void
 {
-  auto ret = mode == file::io_mode::create
-   ? H5Fcreate(path, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)
-   : H5Fopen(path, mode == file::io_mode::read_only ? H5F_ACC_RDONLY : H5F_ACC_RDWR, H5P_DEFAULT);
-  if (ret < 0)
-    throw make_error({}, "file open", path);
-  return ret;
+  {
+    hdf5_lock lock;
+    sel.prepare(data_);
+  }
+  if (sel.size() > 0)
+    read_unpack(data, undetect, nodata, sel.size(), sel.mem_space_, sel.file_space_, strategy);
 }
 
-file::file(const std::string& path, io_mode mode)
-  : group{file_checked_open_or_create(path.c_str(), mode), mode != io_mode::create}
-  , mode_{mode}
-  , type_{object_type::unknown}
-  , size_{0}
-{
-  if (mode != io_mode::create)
+template <typename T>
+auto data::read_unpack(
+      T* data
+    , T undetect
+    , T nodata
+    , size_t size
+    , handle::id_t mem_space
+    , handle::id_t file_space
+    , decode_strategy strategy
+    ) const -> void
+{
+  const auto a = gain();
+  const auto b = offset();
+  const auto nd = this->nodata();
+  const auto ud = this->undetect();
+
+  bool done = false;
+  switch (type())
   {
-    // determine the number of datasetX groups
-    H5G_info_t info;
-    if (H5Gget_info(hnd_, &info) < 0)
-      throw make_error(hnd_, "get group info");
-    if (what_) --info.nlinks;
-    if (where_) --info.nlinks;
-    if (how_) --info.nlinks;
-    for (size_t i = info.nlinks; i > 0; --i)
-    {
+  case data_type::i8:
+    done = read_unpack_stored<int8_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::u8:
+    done = read_unpack_stored<uint8_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::i16:
+    done = read_unpack_stored<int16_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::u16:
+    done = read_unpack_stored<uint16_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::i32:
+    done = read_unpack_stored<int32_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::u32:
+    done = read_unpack_stored<uint32_t>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::f32:
+    done = read_unpack_stored<float>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  case data_type::f64:
+    done = read_unpack_stored<double>(hnd_, data_, data, size, mem_space, file_space, a, b, nd, ud, undetect, nodata, strategy);
+    break;
+  default:
+    break;
+  }
+  if (done)
+    return;
+
+  // fall back to letting HDF5 convert to the output type and unpacking in place
+  herr_t err;
+  {
+    hdf5_lock lock;
+    err = H5Dread(data_, hdf_native_type<T>(), mem_space, file_space, H5P_DEFAULT, data);
+  }
+  if (err < 0)
+  {
+    check_filters_available(data_);
+    throw make_error(hnd_, "read dataset", "data", err);
+  }
+  unpack_kernel(static_cast<const T*>(data), data, size, a, b, static_cast<T>(ud), static_cast<T>(nd), undetect, nodata);
+}
+
+template auto data::read_unpack<char>(char* data, char undetect, char nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<signed char>(signed char* data, signed char undetect, signed char nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<short>(short* data, short undetect, short nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<int>(int* data, int undetect, int nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long>(long* data, long undetect, long nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long long>(long long* data, long long undetect, long long nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<float>(float* data, float undetect, float nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<double>(double* data, double undetect, double nodata, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long double>(long double* data, long double undetect, long double nodata, decode_strategy strategy) const -> void;
+
+template auto data::read_unpack<char>(char* data, char undetect, char nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<signed char>(signed char* data, signed char undetect, signed char nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<short>(short* data, short undetect, short nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<int>(int* data, int undetect, int nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long>(long* data, long undetect, long nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long long>(long long* data, long long undetect, long long nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<float>(float* data, float undetect, float nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<double>(double* data, double undetect, double nodata, const selection& sel, decode_strategy strategy) const -> void;
+template auto data::read_unpack<long double>(long double* data, long double undetect, long double nodata, const selection& sel, decode_strategy strategy) const -> void;
+
+/* Parallel chunk decompression:
+ * HDF5 runs its filter pipeline while holding the global library lock, so decompression of a large
+ * layer is limited to a single core.  For layers that use only the filters we can decode ourselves
+ * (deflate and shuffle) the raw chunks are read by the calling thread using H5Dread_chunk and handed
+ * to a pool of worker threads which decompress and unpack each chunk and copy it into the output.
+ * The workers never call into HDF5. */
+// buffers reused by each worker thread between chunks
+struct chunk_buffers
+{
+  std::vector<unsigned char> filtered[2];
+  std::vector<unsigned char> decoded;
+};
+
+// details of a chunked layer which we are able to compress and decompress ourselves
+struct chunk_plan
+{
+  size_t        rank;
+  hsize_t       dims[data::max_rank];
+  hsize_t       chunk[data::max_rank];
+  size_t        chunk_size;                 // elements in a chunk
+  size_t        element_size;               // bytes per element
+  bool          contiguous;                 // chunks span all but the outermost dimension
+  int           nfilters;
+  H5Z_filter_t  filters[H5Z_MAX_NFILTERS];  // pipeline order
+  int           deflate_level;
+  unsigned char fill[sizeof(double)];       // fill value for unallocated chunks
+};
+
+static auto plan_chunk_io(const handle& dset, hid_t storage_type, chunk_plan& plan) -> bool
+{
+  hdf5_lock lock;
+#ifdef ODIM_H5_DIRECT_CHUNK_IO
+  if (storage_type < 0)
+    return false;
+
+  // chunks must contain values which are already in the native format
+  handle dtype{H5Dget_type(dset)};
+  if (!dtype || H5Tequal(dtype, storage_type) <= 0)
+    return false;
+  plan.element_size = H5Tget_size(storage_type);
+
+  handle dcpl{H5Dget_create_plist(dset)};
+  if (!dcpl || H5Pget_layout(dcpl) != H5D_CHUNKED)
+    return false;
+
+  handle space{H5Dget_space(dset)};
+  auto rank = H5Sget_simple_extent_ndims(space);
+  if (rank <= 0 || static_cast<size_t>(rank) > data::max_rank)
+    return false;
+  plan.rank = rank;
+  if (   H5Sget_simple_extent_dims(space, plan.dims, nullptr) != rank
+      || H5Pget_chunk(dcpl, rank, plan.chunk) != rank)
+    return false;
+  plan.chunk_size = 1;
+  plan.contiguous = true;
+  for (size_t i = 0; i < plan.rank; ++i)
+  {
+    plan.chunk_size *= plan.chunk[i];
+    if (i > 0 && plan.chunk[i] != plan.dims[i])
+      plan.contiguous = false;
+  }
+
+  // without any filters there is nothing to gain from handling the chunks ourselves
+  plan.nfilters = H5Pget_nfilters(dcpl);
+  if (plan.nfilters <= 0 || plan.nfilters > H5Z_MAX_NFILTERS)
+    return false;
+  plan.deflate_level = Z_DEFAULT_COMPRESSION;
+  for (int i = 0; i < plan.nfilters; ++i)
+  {
+    unsigned int flags;
+    unsigned int cd_values[8];
+    size_t cd_nelmts = 8;
+    plan.filters[i] = H5Pget_filter2(dcpl, i, &flags, &cd_nelmts, cd_values, 0, nullptr, nullptr);
+    if (plan.filters[i] == H5Z_FILTER_DEFLATE)
+    {
+      if (cd_nelmts > 0)
+        plan.deflate_level = cd_values[0];
+    }
+    else if (plan.filters[i] != H5Z_FILTER_SHUFFLE)
+      return false;
+  }
+
+  memset(plan.fill, 0, sizeof(plan.fill));
+  if (H5Pget_fill_value(dcpl, storage_type, plan.fill) < 0)
+    return false;
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef ODIM_H5_DIRECT_CHUNK_IO
+namespace
+{
+  class thread_pool
+  {
+  public:
+    // threads are started by the first task
+    thread_pool(size_t threads)
+      : size_{threads}
+    { }
+
+    thread_pool(const thread_pool&) = delete;
+    auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+    ~thread_pool()
+    {
+      release();
+    }
+
+    auto size() const -> size_t
+    {
+      return size_;
+    }
+
+    auto running() -> size_t
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      return threads_.size();
+    }
+
+    auto submit(std::function<void()> task) -> void
+    {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (threads_.empty())
+          for (size_t i = 0; i < size_; ++i)
+            threads_.emplace_back([this]{ run(); });
+        tasks_.push_back(std::move(task));
+      }
+      cv_.notify_one();
+    }
+
+    // run any queued tasks and join the threads
+    auto release() -> void
+    {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (threads_.empty())
+          return;
+        stop_ = true;
+      }
+      cv_.notify_all();
+      for (auto& t : threads_)
+        t.join();
+      std::lock_guard<std::mutex> lock{mutex_};
+      threads_.clear();
+      stop_ = false;
+    }
+
+  private:
+    auto run() -> void
+    {
+      while (true)
+      {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock{mutex_};
+          cv_.wait(lock, [this]{ return stop_ || !tasks_.empty(); });
+          if (tasks_.empty())
+            return;
+          task = std::move(tasks_.front());
+          tasks_.pop_front();
+        }
+        task();
+      }
+    }
+
+  private:
+    std::mutex                        mutex_;
+    std::condition_variable           cv_;
+    std::deque<std::function<void()>> tasks_;
+    size_t                            size_;
+    std::vector<std::thread>          threads_;
+    bool                              stop_ = false;
+  };
+
+  // set of tasks run on the pool with a limit on the number outstanding at any time
+  class task_group
+  {
+  public:
+    task_group(thread_pool& pool, size_t limit)
+      : pool_(pool), limit_(limit > 0 ? limit : 1)
+    { }
+
+    task_group(const task_group&) = delete;
+    auto operator=(const task_group&) -> task_group& = delete;
+
+    // tasks may reference state owned by the caller so we must always wait for them
+    ~task_group()
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      cv_.wait(lock, [this]{ return pending_ == 0; });
+    }
+
+    // submit a task, blocking while the limit is reached and throwing if an earlier task failed
+    auto run(std::function<void()> task) -> void
+    {
+      {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this]{ return pending_ < limit_ || error_; });
+        if (error_)
+          std::rethrow_exception(error_);
+        ++pending_;
+      }
+      pool_.submit([this, task]
+      {
+        std::exception_ptr err;
+        try
+        {
+          task();
+        }
+        catch (...)
+        {
+          err = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (err && !error_)
+          error_ = err;
+        --pending_;
+        cv_.notify_all();
+      });
+    }
+
+    // wait for all tasks to complete and rethrow the first failure
+    auto wait() -> void
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      cv_.wait(lock, [this]{ return pending_ == 0; });
+      if (error_)
+        std::rethrow_exception(error_);
+    }
+
+  private:
+    thread_pool&            pool_;
+    size_t                  limit_;
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    size_t                  pending_ = 0;
+    std::exception_ptr      error_;
+  };
+}
+
+static auto worker_pool() -> thread_pool&
+{
+  static thread_pool pool{std::max<size_t>(std::thread::hardware_concurrency(), 1)};
+  return pool;
+}
+
+auto odim_h5::release_threads() -> void
+{
+  worker_pool().release();
+  io_executor::instance().release();
+}
+
+static auto worker_buffers() -> chunk_buffers&
+{
+  static thread_local chunk_buffers bufs;
+  return bufs;
+}
+
+// reverse the byte shuffle filter, the element size is a template parameter so the loop can be unrolled
+template <size_t N>
+static auto unshuffle(const unsigned char* src, unsigned char* dst, size_t count) -> void
+{
+  for (size_t j = 0; j < count; ++j)
+    for (size_t b = 0; b < N; ++b)
+      dst[j * N + b] = src[b * count + j];
+}
+
+// reverse the filter pipeline for a single chunk, returns a pointer to the raw chunk data
+static auto decode_chunk(
+      const chunk_plan& plan
+    , const std::vector<unsigned char>& raw
+    , unsigned int filter_mask
+    , chunk_buffers& bufs
+    ) -> const unsigned char*
+{
+  const auto bytes = plan.chunk_size * plan.element_size;
+  const unsigned char* src = raw.data();
+  size_t src_size = raw.size();
+  int next = 0;
+  for (int i = plan.nfilters - 1; i >= 0; --i)
+  {
+    // filters which were skipped for this chunk are flagged in the mask
+    if (filter_mask & (1u << i))
+      continue;
+
+    auto& dst = bufs.filtered[next];
+    dst.resize(bytes);
+    if (plan.filters[i] == H5Z_FILTER_DEFLATE)
+    {
+      uLongf dst_size = bytes;
+      if (uncompress(dst.data(), &dst_size, src, src_size) != Z_OK || dst_size != bytes)
+        throw make_error({}, "read dataset", "data", "failed to decompress chunk");
+    }
+    else
+    {
+      if (src_size != bytes)
+        throw make_error({}, "read dataset", "data", "unexpected shuffled chunk size");
+      switch (plan.element_size)
+      {
+      case 1:
+        memcpy(dst.data(), src, bytes);
+        break;
+      case 2:
+        unshuffle<2>(src, dst.data(), plan.chunk_size);
+        break;
+      case 4:
+        unshuffle<4>(src, dst.data(), plan.chunk_size);
+        break;
+      case 8:
+        unshuffle<8>(src, dst.data(), plan.chunk_size);
+        break;
+      default:
+        throw make_error({}, "read dataset", "data", "unsupported shuffle element size");
+      }
+    }
+    src = dst.data();
+    src_size = bytes;
+    next = 1 - next;
+  }
+  if (src_size != bytes)
+    throw make_error({}, "read dataset", "data", "unexpected chunk size");
+  return src;
+}
+
+// call a function for each row of a chunk which lies within the dataset, passing the element offsets of
+// the row within the chunk and within the dataset along with the number of elements in the row
+template <class Func>
+static auto for_each_chunk_row(const chunk_plan& plan, const hsize_t* offset, Func func) -> void
+{
+  const auto rank = plan.rank;
+  size_t extent[data::max_rank];
+  for (size_t i = 0; i < rank; ++i)
+    extent[i] = std::min<hsize_t>(plan.chunk[i], plan.dims[i] - offset[i]);
+
+  size_t index[data::max_rank] = {};
+  while (true)
+  {
+    size_t chunk_off = 0, dset_off = 0;
+    for (size_t i = 0; i < rank; ++i)
+    {
+      chunk_off = chunk_off * plan.chunk[i] + index[i];
+      dset_off = dset_off * plan.dims[i] + offset[i] + index[i];
+    }
+    func(chunk_off, dset_off, extent[rank - 1]);
+
+    // advance to the next row, the innermost dimension is handled by the function
+    size_t d = rank - 1;
+    while (d > 0 && ++index[d - 1] == extent[d - 1])
+      index[--d] = 0;
+    if (d == 0)
+      break;
+  }
+}
+
+// copy the part of a decoded chunk which lies within the dataset into the output
+static auto scatter_chunk(
+      const chunk_plan& plan
+    , const hsize_t* offset
+    , const unsigned char* src
+    , unsigned char* dst
+    , size_t element_size
+    ) -> void
+{
+  for_each_chunk_row(plan, offset, [&](size_t chunk_off, size_t dset_off, size_t count)
+  {
+    memcpy(dst + dset_off * element_size, src + chunk_off * element_size, count * element_size);
+  });
+}
+
+// copy the part of the dataset covered by a chunk into a chunk buffer, padding edge chunks with zeros
+static auto gather_chunk(
+      const chunk_plan& plan
+    , const hsize_t* offset
+    , const unsigned char* src
+    , unsigned char* dst
+    ) -> void
+{
+  const auto es = plan.element_size;
+  if (plan.contiguous)
+  {
+    const auto inner = plan.chunk_size / plan.chunk[0];
+    const auto bytes = std::min<hsize_t>(plan.chunk[0], plan.dims[0] - offset[0]) * inner * es;
+    memcpy(dst, src + offset[0] * inner * es, bytes);
+    memset(dst + bytes, 0, plan.chunk_size * es - bytes);
+    return;
+  }
+
+  bool edge = false;
+  for (size_t i = 0; i < plan.rank; ++i)
+    edge = edge || offset[i] + plan.chunk[i] > plan.dims[i];
+  if (edge)
+    memset(dst, 0, plan.chunk_size * es);
+  for_each_chunk_row(plan, offset, [&](size_t chunk_off, size_t dset_off, size_t count)
+  {
+    memcpy(dst + chunk_off * es, src + dset_off * es, count * es);
+  });
+}
+
+// apply the filter pipeline to a single chunk
+template <size_t N>
+static auto shuffle(const unsigned char* src, unsigned char* dst, size_t count) -> void
+{
+  for (size_t j = 0; j < count; ++j)
+    for (size_t b = 0; b < N; ++b)
+      dst[b * count + j] = src[j * N + b];
+}
+
+static auto encode_chunk(const chunk_plan& plan, chunk_buffers& bufs, std::vector<unsigned char>& out) -> void
+{
+  const auto bytes = plan.chunk_size * plan.element_size;
+  auto src = &bufs.decoded;
+  auto tmp = &bufs.filtered[0];
+  for (int i = 0; i < plan.nfilters; ++i)
+  {
+    if (plan.filters[i] == H5Z_FILTER_DEFLATE)
+    {
+      auto size = compressBound(bytes);
+      tmp->resize(size);
+      if (compress2(tmp->data(), &size, src->data(), bytes, plan.deflate_level) != Z_OK)
+        throw make_error({}, "write dataset", "data", "failed to compress chunk");
+      tmp->resize(size);
+    }
+    else
+    {
+      tmp->resize(bytes);
+      switch (plan.element_size)
+      {
+      case 1:
+        memcpy(tmp->data(), src->data(), bytes);
+        break;
+      case 2:
+        shuffle<2>(src->data(), tmp->data(), plan.chunk_size);
+        break;
+      case 4:
+        shuffle<4>(src->data(), tmp->data(), plan.chunk_size);
+        break;
+      case 8:
+        shuffle<8>(src->data(), tmp->data(), plan.chunk_size);
+        break;
+      default:
+        throw make_error({}, "write dataset", "data", "unsupported shuffle element size");
+      }
+    }
+    std::swap(src, tmp);
+    tmp = src == &bufs.filtered[0] ? &bufs.filtered[1] : &bufs.filtered[0];
+  }
+  out.assign(src->begin(), src->end());
+}
+
+// advance a chunk offset to the next chunk in the dataset, returns false after the last chunk
+static auto next_chunk(const chunk_plan& plan, hsize_t* offset) -> bool
+{
+  size_t d = plan.rank;
+  while (d > 0 && (offset[d - 1] += plan.chunk[d - 1]) >= plan.dims[d - 1])
+    offset[--d] = 0;
+  return d > 0;
+}
+#endif
+
+/* Read every chunk of a layer, decoding each on the worker pool.  The decode functor converts a number of
+ * storage values into output values of the given size. */
+static auto read_chunks_parallel(
+      const handle& loc
+    , const handle& dset
+    , const chunk_plan& plan
+    , size_t threads
+    , void* out
+    , size_t out_element_size
+    , std::function<void(const unsigned char* in, unsigned char* out, size_t count)> decode
+    ) -> void
+{
+#ifdef ODIM_H5_DIRECT_CHUNK_IO
+  auto& pool = worker_pool();
+  task_group tasks{pool, threads > 0 ? threads : pool.size()};
+
+  hsize_t offset[data::max_rank] = {};
+  while (true)
+  {
+    // read the raw chunk on this thread since it requires the HDF5 library
+    auto raw = std::make_shared<std::vector<unsigned char>>();
+    unsigned int filter_mask = 0;
+    hsize_t nbytes = 0;
+    {
+      hdf5_lock lock;
+      if (H5Dget_chunk_storage_size(dset, offset, &nbytes) < 0)
+        throw make_error(loc, "read dataset", "data", "failed to get chunk size");
+      if (nbytes > 0)
+      {
+        raw->resize(nbytes);
+        if (H5Dread_chunk(dset, H5P_DEFAULT, offset, &filter_mask, raw->data()) < 0)
+          throw make_error(loc, "read dataset", "data", "failed to read chunk");
+      }
+    }
+
+    std::vector<hsize_t> chunk_offset(offset, offset + plan.rank);
+    tasks.run([&plan, &decode, out, out_element_size, raw, filter_mask, chunk_offset]
+    {
+      auto& bufs = worker_buffers();
+
+      // unallocated chunks are filled with the fill value
+      const unsigned char* values;
+      if (raw->empty())
+      {
+        auto& fill = bufs.filtered[0];
+        fill.resize(plan.chunk_size * plan.element_size);
+        if (std::all_of(plan.fill, plan.fill + plan.element_size, [](unsigned char c){ return c == 0; }))
+          memset(fill.data(), 0, fill.size());
+        else
+          for (size_t i = 0; i < plan.chunk_size; ++i)
+            memcpy(fill.data() + i * plan.element_size, plan.fill, plan.element_size);
+        values = fill.data();
+      }
+      else
+        values = decode_chunk(plan, *raw, filter_mask, bufs);
+
+      // chunks which span the inner dimensions are contiguous in the output so can be decoded in place
+      if (plan.contiguous)
+      {
+        const auto inner = plan.chunk_size / plan.chunk[0];
+        const auto rows = std::min<hsize_t>(plan.chunk[0], plan.dims[0] - chunk_offset[0]);
+        decode(values, static_cast<unsigned char*>(out) + chunk_offset[0] * inner * out_element_size, rows * inner);
+      }
+      else
+      {
+        bufs.decoded.resize(plan.chunk_size * out_element_size);
+        decode(values, bufs.decoded.data(), plan.chunk_size);
+        scatter_chunk(plan, chunk_offset.data(), bufs.decoded.data(), static_cast<unsigned char*>(out), out_element_size);
+      }
+    });
+
+    if (!next_chunk(plan, offset))
+      break;
+  }
+
+  tasks.wait();
+#endif
+}
+
+template <typename T>
+auto data::read_parallel(T* data, size_t threads) const -> void
+{
+  chunk_plan plan;
+  auto storage = hdf_native_storage_type(type());
+  if (   storage < 0
+      || !types_equal(storage, hdf_native_type<T>())
+      || !plan_chunk_io(data_, storage, plan))
+  {
+    read(data);
+    return;
+  }
+
+  read_chunks_parallel(hnd_, data_, plan, threads, data, sizeof(T), [](const unsigned char* in, unsigned char* out, size_t count)
+  {
+    memcpy(out, in, count * sizeof(T));
+  });
+}
+
+template auto data::read_parallel<char>(char* data, size_t threads) const -> void;
+template auto data::read_parallel<signed char>(signed char* data, size_t threads) const -> void;
+template auto data::read_parallel<unsigned char>(unsigned char* data, size_t threads) const -> void;
+template auto data::read_parallel<short>(short* data, size_t threads) const -> void;
+template auto data::read_parallel<unsigned short>(unsigned short* data, size_t threads) const -> void;
+template auto data::read_parallel<int>(int* data, size_t threads) const -> void;
+template auto data::read_parallel<unsigned int>(unsigned int* data, size_t threads) const -> void;
+template auto data::read_parallel<long>(long* data, size_t threads) const -> void;
+template auto data::read_parallel<unsigned long>(unsigned long* data, size_t threads) const -> void;
+template auto data::read_parallel<long long>(long long* data, size_t threads) const -> void;
+template auto data::read_parallel<unsigned long long>(unsigned long long* data, size_t threads) const -> void;
+template auto data::read_parallel<float>(float* data, size_t threads) const -> void;
+template auto data::read_parallel<double>(double* data, size_t threads) const -> void;
+template auto data::read_parallel<long double>(long double* data, size_t threads) const -> void;
+
+template <typename S, typename T>
+static auto read_unpack_chunks(
+      const handle& loc
+    , const handle& dset
+    , const chunk_plan& plan
+    , size_t threads
+    , T* data
+    , double a
+    , double b
+    , double nd
+    , double ud
+    , T undetect
+    , T nodata
+    , data::decode_strategy strategy
+    ) -> bool
+{
+  if (!codes_representable<S>(nd, ud))
+    return false;
+
+  const auto snd = static_cast<S>(nd), sud = static_cast<S>(ud);
+  read_chunks_parallel(loc, dset, plan, threads, data, sizeof(T), [&](const unsigned char* in, unsigned char* out, size_t count)
+  {
+    unpack_values(reinterpret_cast<const S*>(in), reinterpret_cast<T*>(out), count, a, b, sud, snd, undetect, nodata, strategy);
+  });
+  return true;
+}
+
+template <typename T>
+auto data::read_unpack_parallel(T* data, T undetect, T nodata, size_t threads, decode_strategy strategy) const -> void
+{
+  chunk_plan plan;
+  if (plan_chunk_io(data_, hdf_native_storage_type(type()), plan))
+  {
+    const auto a = gain();
+    const auto b = offset();
+    const auto nd = this->nodata();
+    const auto ud = this->undetect();
+
+    bool done = false;
+    switch (type())
+    {
+    case data_type::i8:
+      done = read_unpack_chunks<int8_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::u8:
+      done = read_unpack_chunks<uint8_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::i16:
+      done = read_unpack_chunks<int16_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::u16:
+      done = read_unpack_chunks<uint16_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::i32:
+      done = read_unpack_chunks<int32_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::u32:
+      done = read_unpack_chunks<uint32_t>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::f32:
+      done = read_unpack_chunks<float>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    case data_type::f64:
+      done = read_unpack_chunks<double>(hnd_, data_, plan, threads, data, a, b, nd, ud, undetect, nodata, strategy);
+      break;
+    default:
+      break;
+    }
+    if (done)
+      return;
+  }
+
+  read_unpack(data, undetect, nodata, size(), H5S_ALL, H5S_ALL, strategy);
+}
+
+template auto data::read_unpack_parallel<char>(char* data, char undetect, char nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<signed char>(signed char* data, signed char undetect, signed char nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<short>(short* data, short undetect, short nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<int>(int* data, int undetect, int nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<long>(long* data, long undetect, long nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<long long>(long long* data, long long undetect, long long nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<float>(float* data, float undetect, float nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<double>(double* data, double undetect, double nodata, size_t threads, decode_strategy strategy) const -> void;
+template auto data::read_unpack_parallel<long double>(long double* data, long double undetect, long double nodata, size_t threads, decode_strategy strategy) const -> void;
+
+template <typename T>
+auto data::read_async(T* data) const -> io_future<void>
+{
+  auto layer = *this;
+  return io_executor::instance().submit([layer, data]{ layer.read(data); });
+}
+
+template auto data::read_async<char>(char* data) const -> io_future<void>;
+template auto data::read_async<signed char>(signed char* data) const -> io_future<void>;
+template auto data::read_async<unsigned char>(unsigned char* data) const -> io_future<void>;
+template auto data::read_async<short>(short* data) const -> io_future<void>;
+template auto data::read_async<unsigned short>(unsigned short* data) const -> io_future<void>;
+template auto data::read_async<int>(int* data) const -> io_future<void>;
+template auto data::read_async<unsigned int>(unsigned int* data) const -> io_future<void>;
+template auto data::read_async<long>(long* data) const -> io_future<void>;
+template auto data::read_async<unsigned long>(unsigned long* data) const -> io_future<void>;
+template auto data::read_async<long long>(long long* data) const -> io_future<void>;
+template auto data::read_async<unsigned long long>(unsigned long long* data) const -> io_future<void>;
+template auto data::read_async<float>(float* data) const -> io_future<void>;
+template auto data::read_async<double>(double* data) const -> io_future<void>;
+template auto data::read_async<long double>(long double* data) const -> io_future<void>;
+
+template <typename T>
+auto data::read_unpack_async(T* data, T undetect, T nodata) const -> io_future<void>
+{
+  auto layer = *this;
+  return io_executor::instance().submit([layer, data, undetect, nodata]{ layer.read_unpack(data, undetect, nodata); });
+}
+
+template auto data::read_unpack_async<char>(char* data, char undetect, char nodata) const -> io_future<void>;
+template auto data::read_unpack_async<signed char>(signed char* data, signed char undetect, signed char nodata) const -> io_future<void>;
+template auto data::read_unpack_async<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata) const -> io_future<void>;
+template auto data::read_unpack_async<short>(short* data, short undetect, short nodata) const -> io_future<void>;
+template auto data::read_unpack_async<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata) const -> io_future<void>;
+template auto data::read_unpack_async<int>(int* data, int undetect, int nodata) const -> io_future<void>;
+template auto data::read_unpack_async<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata) const -> io_future<void>;
+template auto data::read_unpack_async<long>(long* data, long undetect, long nodata) const -> io_future<void>;
+template auto data::read_unpack_async<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata) const -> io_future<void>;
+template auto data::read_unpack_async<long long>(long long* data, long long undetect, long long nodata) const -> io_future<void>;
+template auto data::read_unpack_async<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata) const -> io_future<void>;
+template auto data::read_unpack_async<float>(float* data, float undetect, float nodata) const -> io_future<void>;
+template auto data::read_unpack_async<double>(double* data, double undetect, double nodata) const -> io_future<void>;
+template auto data::read_unpack_async<long double>(long double* data, long double undetect, long double nodata) const -> io_future<void>;
+
+template <typename T>
+auto data::read(memory_resource& mem) const -> buffer_view<T>
+{
+  const auto count = size();
+  buffer_view<T> buf{static_cast<T*>(mem.allocate(count * sizeof(T), simd_alignment)), count};
+  try
+  {
+    read(buf.data);
+  }
+  catch (...)
+  {
+    mem.deallocate(buf.data, count * sizeof(T), simd_alignment);
+    throw;
+  }
+  return buf;
+}
+
+template auto data::read<char>(memory_resource& mem) const -> buffer_view<char>;
+template auto data::read<signed char>(memory_resource& mem) const -> buffer_view<signed char>;
+template auto data::read<unsigned char>(memory_resource& mem) const -> buffer_view<unsigned char>;
+template auto data::read<short>(memory_resource& mem) const -> buffer_view<short>;
+template auto data::read<unsigned short>(memory_resource& mem) const -> buffer_view<unsigned short>;
+template auto data::read<int>(memory_resource& mem) const -> buffer_view<int>;
+template auto data::read<unsigned int>(memory_resource& mem) const -> buffer_view<unsigned int>;
+template auto data::read<long>(memory_resource& mem) const -> buffer_view<long>;
+template auto data::read<unsigned long>(memory_resource& mem) const -> buffer_view<unsigned long>;
+template auto data::read<long long>(memory_resource& mem) const -> buffer_view<long long>;
+template auto data::read<unsigned long long>(memory_resource& mem) const -> buffer_view<unsigned long long>;
+template auto data::read<float>(memory_resource& mem) const -> buffer_view<float>;
+template auto data::read<double>(memory_resource& mem) const -> buffer_view<double>;
+template auto data::read<long double>(memory_resource& mem) const -> buffer_view<long double>;
+
+template <typename T>
+auto data::read_unpack(memory_resource& mem, T undetect, T nodata, decode_strategy strategy) const -> buffer_view<T>
+{
+  const auto count = size();
+  buffer_view<T> buf{static_cast<T*>(mem.allocate(count * sizeof(T), simd_alignment)), count};
+  try
+  {
+    read_unpack(buf.data, undetect, nodata, strategy);
+  }
+  catch (...)
+  {
+    mem.deallocate(buf.data, count * sizeof(T), simd_alignment);
+    throw;
+  }
+  return buf;
+}
+
+template auto data::read_unpack<char>(memory_resource& mem, char undetect, char nodata, decode_strategy strategy) const -> buffer_view<char>;
+template auto data::read_unpack<signed char>(memory_resource& mem, signed char undetect, signed char nodata, decode_strategy strategy) const -> buffer_view<signed char>;
+template auto data::read_unpack<unsigned char>(memory_resource& mem, unsigned char undetect, unsigned char nodata, decode_strategy strategy) const -> buffer_view<unsigned char>;
+template auto data::read_unpack<short>(memory_resource& mem, short undetect, short nodata, decode_strategy strategy) const -> buffer_view<short>;
+template auto data::read_unpack<unsigned short>(memory_resource& mem, unsigned short undetect, unsigned short nodata, decode_strategy strategy) const -> buffer_view<unsigned short>;
+template auto data::read_unpack<int>(memory_resource& mem, int undetect, int nodata, decode_strategy strategy) const -> buffer_view<int>;
+template auto data::read_unpack<unsigned int>(memory_resource& mem, unsigned int undetect, unsigned int nodata, decode_strategy strategy) const -> buffer_view<unsigned int>;
+template auto data::read_unpack<long>(memory_resource& mem, long undetect, long nodata, decode_strategy strategy) const -> buffer_view<long>;
+template auto data::read_unpack<unsigned long>(memory_resource& mem, unsigned long undetect, unsigned long nodata, decode_strategy strategy) const -> buffer_view<unsigned long>;
+template auto data::read_unpack<long long>(memory_resource& mem, long long undetect, long long nodata, decode_strategy strategy) const -> buffer_view<long long>;
+template auto data::read_unpack<unsigned long long>(memory_resource& mem, unsigned long long undetect, unsigned long long nodata, decode_strategy strategy) const -> buffer_view<unsigned long long>;
+template auto data::read_unpack<float>(memory_resource& mem, float undetect, float nodata, decode_strategy strategy) const -> buffer_view<float>;
+template auto data::read_unpack<double>(memory_resource& mem, double undetect, double nodata, decode_strategy strategy) const -> buffer_view<double>;
+template auto data::read_unpack<long double>(memory_resource& mem, long double undetect, long double nodata, decode_strategy strategy) const -> buffer_view<long double>;
+
+constexpr size_t data::pack_block;
+
+auto data::packed_size() const -> size_t
+{
+  auto bytes = storage_size(type());
+  if (bytes == 0)
+    throw make_error(hnd_, "get packed size", nullptr, "unsupported storage type");
+  return size() * bytes;
+}
+
+auto data::write_packed(const void* data) -> void
+{
+  hdf5_lock lock;
+  auto type = hdf_native_storage_type(this->type());
+  if (type < 0)
+    throw make_error(hnd_, "write dataset", "data", "unsupported storage type");
+  auto err = H5Dwrite(data_, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
+  if (err < 0)
+    throw make_error(hnd_, "write dataset", "data", err);
+}
+
+template <typename T>
+auto data::write_parallel(const T* data, size_t threads) -> void
+{
+  auto storage = hdf_native_storage_type(type());
+  if (storage < 0 || !types_equal(storage, hdf_native_type<T>()))
+  {
+    write(data);
+    return;
+  }
+
+  packed_layer layer{this, data};
+  write_packed_parallel(&layer, 1, threads);
+}
+
+template auto data::write_parallel<char>(const char* data, size_t threads) -> void;
+template auto data::write_parallel<signed char>(const signed char* data, size_t threads) -> void;
+template auto data::write_parallel<unsigned char>(const unsigned char* data, size_t threads) -> void;
+template auto data::write_parallel<short>(const short* data, size_t threads) -> void;
+template auto data::write_parallel<unsigned short>(const unsigned short* data, size_t threads) -> void;
+template auto data::write_parallel<int>(const int* data, size_t threads) -> void;
+template auto data::write_parallel<unsigned int>(const unsigned int* data, size_t threads) -> void;
+template auto data::write_parallel<long>(const long* data, size_t threads) -> void;
+template auto data::write_parallel<unsigned long>(const unsigned long* data, size_t threads) -> void;
+template auto data::write_parallel<long long>(const long long* data, size_t threads) -> void;
+template auto data::write_parallel<unsigned long long>(const unsigned long long* data, size_t threads) -> void;
+template auto data::write_parallel<float>(const float* data, size_t threads) -> void;
+template auto data::write_parallel<double>(const double* data, size_t threads) -> void;
+template auto data::write_parallel<long double>(const long double* data, size_t threads) -> void;
+
+auto data::write_packed_parallel(const packed_layer* layers, size_t count, size_t threads) -> void
+{
+#ifdef ODIM_H5_DIRECT_CHUNK_IO
+  struct pending
+  {
+    const data*                             layer;
+    std::vector<hsize_t>                    offset;
+    std::future<std::vector<unsigned char>> chunk;
+  };
+
+  auto& pool = worker_pool();
+  const auto limit = threads > 0 ? threads : pool.size();
+  std::deque<pending> queue;
+
+  // commit the oldest chunk to the file, this must happen on the calling thread
+  auto commit = [&]
+  {
+    auto& p = queue.front();
+    auto chunk = p.chunk.get();
+    hdf5_lock lock;
+    if (H5Dwrite_chunk(p.layer->data_, H5P_DEFAULT, 0, p.offset.data(), chunk.size(), chunk.data()) < 0)
+      throw make_error(p.layer->hnd_, "write dataset", "data", "failed to write chunk");
+    queue.pop_front();
+  };
+
+  try
+  {
+    for (size_t l = 0; l < count; ++l)
+    {
+      auto& layer = *layers[l].layer;
+      auto plan = std::make_shared<chunk_plan>();
+      if (!plan_chunk_io(layer.data_, hdf_native_storage_type(layer.type()), *plan))
+      {
+        layer.write_packed(layers[l].values);
+        continue;
+      }
+
+      auto values = static_cast<const unsigned char*>(layers[l].values);
+      hsize_t offset[max_rank] = {};
+      do
+      {
+        if (queue.size() >= limit)
+          commit();
+
+        std::vector<hsize_t> chunk_offset(offset, offset + plan->rank);
+        auto task = std::make_shared<std::packaged_task<std::vector<unsigned char>()>>([plan, values, chunk_offset]
+        {
+          auto& bufs = worker_buffers();
+          bufs.decoded.resize(plan->chunk_size * plan->element_size);
+          gather_chunk(*plan, chunk_offset.data(), values, bufs.decoded.data());
+          std::vector<unsigned char> out;
+          encode_chunk(*plan, bufs, out);
+          return out;
+        });
+        queue.push_back({&layer, std::move(chunk_offset), task->get_future()});
+        pool.submit([task]{ (*task)(); });
+      } while (next_chunk(*plan, offset));
+    }
+
+    while (!queue.empty())
+      commit();
+  }
+  catch (...)
+  {
+    // outstanding tasks reference the caller's values so we must wait for them before unwinding
+    for (auto& p : queue)
+      if (p.chunk.valid())
+        p.chunk.wait();
+    throw;
+  }
+#else
+  for (size_t l = 0; l < count; ++l)
+    layers[l].layer->write_packed(layers[l].values);
+#endif
+}
+
+// check whether a layer can be mapped, returns the reason if not or nullptr with the file offset and descriptor
+static auto check_mappable(const handle& dset, data::data_type type, haddr_t& offset, int& fd) -> const char*
+{
+  hdf5_lock lock;
+#ifdef ODIM_H5_HAVE_MMAP
+  auto storage = hdf_native_storage_type(type);
+  handle dtype{H5Dget_type(dset)};
+  if (storage < 0 || !dtype || H5Tequal(dtype, storage) <= 0)
+    return "storage type is not native";
+
+  handle dcpl{H5Dget_create_plist(dset)};
+  if (!dcpl || H5Pget_layout(dcpl) != H5D_CONTIGUOUS)
+    return "layer is not stored contiguously";
+  if (H5Pget_nfilters(dcpl) != 0)
+    return "layer is filtered";
+
+  offset = H5Dget_offset(dset);
+  if (offset == HADDR_UNDEF)
+    return "layer storage is not allocated";
+
+  handle file{H5Iget_file_id(dset)};
+  handle fapl{file ? H5Fget_access_plist(file) : -1};
+  if (!fapl || H5Pget_driver(fapl) != H5FD_SEC2)
+    return "file is not opened from disk using the default driver";
+  void* vfd;
+  if (H5Fget_vfd_handle(file, fapl, &vfd) < 0)
+    return "unable to get file descriptor";
+  fd = *static_cast<int*>(vfd);
+  return nullptr;
+#else
+  return "memory mapping is not supported on this platform";
+#endif
+}
+
+auto data::is_mappable() const -> bool
+{
+  haddr_t offset;
+  int fd;
+  return check_mappable(data_, type(), offset, fd) == nullptr;
+}
+
+auto data::map() const -> mapped_data
+{
+#ifdef ODIM_H5_HAVE_MMAP
+  const auto type = this->type();
+  haddr_t offset;
+  int fd;
+  if (auto reason = check_mappable(data_, type, offset, fd))
+    throw make_error(hnd_, "map dataset", "data", reason);
+
+  std::vector<size_t> dims(rank());
+  this->dims(dims.data());
+  const auto bytes = size() * storage_size(type);
+  const auto gain = this->gain(), offs = this->offset(), nodata = this->nodata(), undetect = this->undetect();
+
+  // ensure anything we have written is visible through the mapping
+  {
+    hdf5_lock lock;
+    unsigned intent;
+    handle file{H5Iget_file_id(data_)};
+    if (!file || H5Fget_intent(file, &intent) < 0)
+      throw make_error(hnd_, "map dataset", "data");
+    if ((intent & H5F_ACC_RDWR) && H5Fflush(data_, H5F_SCOPE_LOCAL) < 0)
+      throw make_error(hnd_, "flush");
+  }
+
+  if (bytes == 0)
+    return {nullptr, 0, nullptr, type, std::move(dims), gain, offs, nodata, undetect};
+
+  // mappings must start on a page boundary
+  const auto page = static_cast<haddr_t>(sysconf(_SC_PAGESIZE));
+  const auto start = offset - offset % page;
+  const auto map_size = bytes + (offset - start);
+  auto map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, start);
+  if (map == MAP_FAILED)
+    throw make_error(hnd_, "map dataset", "data", "mmap failed");
+  return {map, map_size, static_cast<const char*>(map) + (offset - start), type, std::move(dims), gain, offs, nodata, undetect};
+#else
+  throw make_error(hnd_, "map dataset", "data", "memory mapping is not supported on this platform");
+#endif
+}
+
+mapped_data::mapped_data() noexcept
+  : map_{nullptr}
+  , map_size_{0}
+  , values_{nullptr}
+  , type_{data::data_type::unknown}
+  , size_{0}
+  , gain_{1.0}
+  , offset_{0.0}
+  , nodata_{0.0}
+  , undetect_{0.0}
+{
+
+}
+
+mapped_data::mapped_data(
+      void* map
+    , size_t map_size
+    , const void* values
+    , data::data_type type
+    , std::vector<size_t> dims
+    , double gain
+    , double offset
+    , double nodata
+    , double undetect)
+  : map_{map}
+  , map_size_{map_size}
+  , values_{values}
+  , type_{type}
+  , dims_(std::move(dims))
+  , size_{1}
+  , gain_{gain}
+  , offset_{offset}
+  , nodata_{nodata}
+  , undetect_{undetect}
+{
+  for (auto d : dims_)
+    size_ *= d;
+}
+
+mapped_data::mapped_data(mapped_data&& rhs) noexcept
+  : mapped_data{}
+{
+  *this = std::move(rhs);
+}
+
+auto mapped_data::operator=(mapped_data&& rhs) noexcept -> mapped_data&
+{
+  std::swap(map_, rhs.map_);
+  std::swap(map_size_, rhs.map_size_);
+  std::swap(values_, rhs.values_);
+  std::swap(type_, rhs.type_);
+  std::swap(dims_, rhs.dims_);
+  std::swap(size_, rhs.size_);
+  std::swap(gain_, rhs.gain_);
+  std::swap(offset_, rhs.offset_);
+  std::swap(nodata_, rhs.nodata_);
+  std::swap(undetect_, rhs.undetect_);
+  return *this;
+}
+
+mapped_data::~mapped_data()
+{
+#ifdef ODIM_H5_HAVE_MMAP
+  if (map_)
+    munmap(map_, map_size_);
+#endif
+}
+
+template <typename S, typename T>
+static auto unpack_mapped(const S* in, T* out, size_t count, double a, double b, double nd, double ud, T undetect, T nodata)
+  -> void
+{
+  if (codes_representable<S>(nd, ud))
+  {
+    unpack_values(in, out, count, a, b, static_cast<S>(ud), static_cast<S>(nd), undetect, nodata, data::decode_strategy::automatic);
+    return;
+  }
+
+  // no packed value can match a code which is not representable in the storage type
+  for (size_t i = 0; i < count; ++i)
+  {
+    const double v = in[i];
+    out[i] = v == ud ? undetect : v == nd ? nodata : static_cast<T>(a * v + b);
+  }
+}
+
+template <typename T>
+auto mapped_data::unpack(T* data, T undetect, T nodata, size_t offset, size_t count) const -> void
+{
+  if (offset > size_ || count > size_ - offset)
+    throw make_error({}, "unpack mapped data", nullptr, "range out of bounds");
+
+  switch (type_)
+  {
+  case data::data_type::i8:
+    unpack_mapped(static_cast<const int8_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::u8:
+    unpack_mapped(static_cast<const uint8_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::i16:
+    unpack_mapped(static_cast<const int16_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::u16:
+    unpack_mapped(static_cast<const uint16_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::i32:
+    unpack_mapped(static_cast<const int32_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::u32:
+    unpack_mapped(static_cast<const uint32_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::i64:
+    unpack_mapped(static_cast<const int64_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::u64:
+    unpack_mapped(static_cast<const uint64_t*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::f32:
+    unpack_mapped(static_cast<const float*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  case data::data_type::f64:
+    unpack_mapped(static_cast<const double*>(values_) + offset, data, count, gain_, offset_, nodata_, undetect_, undetect, nodata);
+    break;
+  default:
+    throw make_error({}, "unpack mapped data", nullptr, "unsupported storage type");
+  }
+}
+
+template auto mapped_data::unpack<char>(char* data, char undetect, char nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<signed char>(signed char* data, signed char undetect, signed char nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<unsigned char>(unsigned char* data, unsigned char undetect, unsigned char nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<short>(short* data, short undetect, short nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<unsigned short>(unsigned short* data, unsigned short undetect, unsigned short nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<int>(int* data, int undetect, int nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<unsigned int>(unsigned int* data, unsigned int undetect, unsigned int nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<long>(long* data, long undetect, long nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<unsigned long>(unsigned long* data, unsigned long undetect, unsigned long nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<long long>(long long* data, long long undetect, long long nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<unsigned long long>(unsigned long long* data, unsigned long long undetect, unsigned long long nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<float>(float* data, float undetect, float nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<double>(double* data, double undetect, double nodata, size_t offset, size_t count) const -> void;
+template auto mapped_data::unpack<long double>(long double* data, long double undetect, long double nodata, size_t offset, size_t count) const -> void;
+
+auto data::pack_params() const -> packing
+{
+  return { type(), size(), gain(), offset(), nodata(), undetect() };
+}
+
+template <typename T>
+auto data::pack(const packing& p, const T* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void
+{
+  static_assert(pack_undetect == 1 && pack_nodata == 2, "pack flags do not match kernels");
+  switch (p.type)
+  {
+  case data_type::i8:
+    pack_values(in, flags, static_cast<int8_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::u8:
+    pack_values(in, flags, static_cast<uint8_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::i16:
+    pack_values(in, flags, static_cast<int16_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::u16:
+    pack_values(in, flags, static_cast<uint16_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::i32:
+    pack_values(in, flags, static_cast<int32_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::u32:
+    pack_values(in, flags, static_cast<uint32_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::i64:
+    pack_values(in, flags, static_cast<int64_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::u64:
+    pack_values(in, flags, static_cast<uint64_t*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::f32:
+    pack_values(in, flags, static_cast<float*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  case data_type::f64:
+    pack_values(in, flags, static_cast<double*>(out) + offset, count, p.gain, p.offset, p.nodata, p.undetect);
+    break;
+  default:
+    throw make_error({}, "pack dataset", nullptr, "unsupported storage type");
+  }
+}
+
+template auto data::pack<char>(const packing& p, const char* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<signed char>(const packing& p, const signed char* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<unsigned char>(const packing& p, const unsigned char* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<short>(const packing& p, const short* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<unsigned short>(const packing& p, const unsigned short* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<int>(const packing& p, const int* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<unsigned int>(const packing& p, const unsigned int* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<long>(const packing& p, const long* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<unsigned long>(const packing& p, const unsigned long* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<long long>(const packing& p, const long long* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<unsigned long long>(const packing& p, const unsigned long long* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<float>(const packing& p, const float* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<double>(const packing& p, const double* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+template auto data::pack<long double>(const packing& p, const long double* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+
+auto data::pack_buffer(size_t bytes) -> void*
+{
+  return scratch_buffer(bytes);
+}
+
+dataset::dataset(const handle& parent, size_t index, bool existing, const std::shared_ptr<file_state>& state)
+  : group{parent, "dataset%zu", index, existing, state}
+  , size_data_{0}
+  , size_quality_{0}
+{
+  hdf5_lock lock;
+  if (existing && state_->structure)
+  {
+    // use the counts gathered when the file was indexed
+    if (auto node = state_->structure->counts(object_path(hnd_)))
+    {
+      size_data_ = node->data_count;
+      size_quality_ = node->quality_count;
+    }
+  }
+  else if (existing)
+  {
+    // determine the number of dataX and qualityX layers
+    H5G_info_t info;
+    if (H5Gget_info(hnd_, &info) < 0)
+      throw make_error(hnd_, "get group info");
+    if (table_->what) --info.nlinks;
+    if (table_->where) --info.nlinks;
+    if (table_->how) --info.nlinks;
+    for (size_t i = info.nlinks; i > 0; --i)
+    {
+      char name[32];
+      sprintf(name, "data%zu", i);
+      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
+      if (ret < 0)
+        throw make_error(hnd_, "check group exists", name);
+      if (ret)
+      {
+        size_data_ = i;
+        break;
+      }
+    }
+    info.nlinks -= size_data_;
+    for (size_t i = info.nlinks; i > 0; --i)
+    {
+      char name[32];
+      sprintf(name, "quality%zu", i);
+      htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
+      if (ret < 0)
+        throw make_error(hnd_, "check group exists", name);
+      if (ret)
+      {
+        size_quality_ = i;
+        break;
+      }
+    }
+  }
+}
+
+auto dataset::data_open(size_t i) const -> data
+{
+  hdf5_lock lock;
+  if (state_->cache)
+    return state_->cache->open<data>(hnd_, object_cache::kind::data, i, state_, [&]() -> data { return {hnd_, false, i, state_}; });
+  return {hnd_, false, i, state_};
+}
+
+auto dataset::data_append(
+      data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  check_layer_settings(hnd_, compression.defaults(), layout);
+  return {hnd_, false, size_data_++, state_, type, rank, dims, compression.defaults(), layout};
+}
+
+auto dataset::data_append(
+      const std::string& quantity
+    , data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  auto& comp = compression.lookup(quantity);
+  check_layer_settings(hnd_, comp, layout);
+  data ret{hnd_, false, size_data_++, state_, type, rank, dims, comp, layout};
+  ret.set_quantity(quantity);
+  return ret;
+}
+
+auto dataset::quality_open(size_t i) const -> data
+{
+  hdf5_lock lock;
+  if (state_->cache)
+    return state_->cache->open<data>(hnd_, object_cache::kind::quality, i, state_, [&]() -> data { return {hnd_, true, i, state_}; });
+  return {hnd_, true, i, state_};
+}
+
+auto dataset::quality_append(
+      data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  check_layer_settings(hnd_, compression.defaults(), layout);
+  return {hnd_, true, size_quality_++, state_, type, rank, dims, compression.defaults(), layout};
+}
+
+auto dataset::quality_append(
+      const std::string& quantity
+    , data::data_type type
+    , size_t rank
+    , const size_t* dims
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  auto& comp = compression.lookup(quantity);
+  check_layer_settings(hnd_, comp, layout);
+  data ret{hnd_, true, size_quality_++, state_, type, rank, dims, comp, layout};
+  ret.set_quantity(quantity);
+  return ret;
+}
+
+static inline auto file_checked_open_or_create(
+      const char* path
+    , file::io_mode mode
+    ) -> handle::id_t
+{
+  hdf5_lock lock;
+  auto ret = mode == file::io_mode::create
+   ? H5Fcreate(path, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT)
+   : H5Fopen(path, mode == file::io_mode::read_only ? H5F_ACC_RDONLY : H5F_ACC_RDWR, H5P_DEFAULT);
+  if (ret < 0)
+    throw make_error({}, "file open", path);
+  return ret;
+}
+
+static auto file_checked_open_or_create_image(
+      const void* image
+    , size_t size
+    , file::io_mode mode
+    ) -> handle::id_t
+{
+  hdf5_lock lock;
+  hid_t ret;
+  if (mode == file::io_mode::create)
+  {
+    // the core driver requires a name which is unique among open files
+    static std::atomic<unsigned long> count{0};
+    char name[64];
+    snprintf(name, sizeof(name), "odim_h5_image_%lu", count++);
+
+    handle fapl{H5Pcreate(H5P_FILE_ACCESS)};
+    if (!fapl || H5Pset_fapl_core(fapl, 1024 * 1024, false) < 0)
+      throw make_error({}, "file create", "image");
+    ret = H5Fcreate(name, H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+  }
+  else
+  {
+    // read only images can be used in place, writable images must be copied since HDF5 may resize them
+    unsigned flags = mode == file::io_mode::read_only
+      ? H5LT_FILE_IMAGE_DONT_COPY | H5LT_FILE_IMAGE_DONT_RELEASE
+      : H5LT_FILE_IMAGE_OPEN_RW;
+    ret = H5LTopen_file_image(const_cast<void*>(image), size, flags);
+  }
+  if (ret < 0)
+    throw make_error({}, "file open", "image");
+  return ret;
+}
+
+file::file(const std::string& path, io_mode mode, const open_options& options)
+  : file{file_checked_open_or_create(path.c_str(), mode), mode, options}
+{ }
+
+file::file(const void* image, size_t size, io_mode mode, const open_options& options)
+  : file{file_checked_open_or_create_image(image, size, mode), mode, options}
+{ }
+
+auto file::open_async(const std::string& path, io_mode mode, const open_options& options) -> io_future<file>
+{
+  return io_executor::instance().submit([path, mode, options]{ return file{path, mode, options}; });
+}
+
+file::file(handle::id_t hnd, io_mode mode, const open_options& options)
+  : group{hnd, mode != io_mode::create, std::make_shared<file_state>(options)}
+  , mode_{mode}
+  , type_{object_type::unknown}
+  , size_{0}
+{
+  hdf5_lock lock;
+  if (mode == io_mode::read_only)
+  {
+    // index the whole file once and share it with all child objects
+    state_->structure = std::shared_ptr<const structure_index>{new structure_index{hnd_, !state_->options.metadata_only}};
+    size_ = state_->structure->dataset_count();
+
+    if (options.object_cache_ids > 0)
+      state_->cache = std::make_shared<object_cache>(options.object_cache_ids);
+  }
+  else if (mode != io_mode::create)
+  {
+    // determine the number of datasetX groups
+    H5G_info_t info;
+    if (H5Gget_info(hnd_, &info) < 0)
+      throw make_error(hnd_, "get group info");
+    if (table_->what) --info.nlinks;
+    if (table_->where) --info.nlinks;
+    if (table_->how) --info.nlinks;
+    for (size_t i = info.nlinks; i > 0; --i)
+    {
       char name[32];
       sprintf(name, "dataset%zu", i);
       htri_t ret = H5Lexists(hnd_, name, H5P_DEFAULT);
@@ -1211,341 +4612,1277 @@ file::file(const std::string& path, io_mode mode)
         throw make_error(hnd_, "check group exists", name);
       if (ret)
       {
-        size_ = i;
+        size_ = i;
+        break;
+      }
+    }
+  }
+
+  if (mode != io_mode::create)
+  {
+
+    // determine the object type
+    auto str = attributes()[keys::id::object].get_string();
+    if (str == "PVOL")
+      type_ = object_type::polar_volume;
+    else if (str == "CVOL")
+      type_ = object_type::cartesian_volume;
+    else if (str == "SCAN")
+      type_ = object_type::polar_scan;
+    else if (str == "RAY")
+      type_ = object_type::polar_ray;
+    else if (str == "AZIM")
+      type_ = object_type::azimuthal_object;
+    else if (str == "IMAGE")
+      type_ = object_type::cartesian_image;
+    else if (str == "COMP")
+      type_ = object_type::composite_image;
+    else if (str == "XSEC")
+      type_ = object_type::vertical_cross_section;
+    else if (str == "VP")
+      type_ = object_type::vertical_profile;
+    else if (str == "PIC")
+      type_ = object_type::graphical_image;
+  }
+  else
+  {
+    // set the default conventions and version attributes
+    set_conventions(default_conventions);
+    set_version(default_version_major, default_version_minor);
+  }
+}
+
+auto file::flush() -> void
+{
+  hdf5_lock lock;
+  if (H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0) 
+    throw make_error(hnd_, "flush");
+}
+
+auto file::object_cache_statistics() const -> cache_statistics
+{
+  return state_->cache ? state_->cache->statistics() : cache_statistics{0, 0, 0, 0, 0};
+}
+
+auto file::structure() const -> std::shared_ptr<const structure_index>
+{
+  if (state_->structure)
+    return state_->structure;
+  return std::shared_ptr<const structure_index>{new structure_index{hnd_, !state_->options.metadata_only}};
+}
+
+auto file::image() const -> std::vector<unsigned char>
+{
+  hdf5_lock lock;
+  if (mode_ != io_mode::read_only && H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0)
+    throw make_error(hnd_, "flush");
+
+  auto size = H5Fget_file_image(hnd_, nullptr, 0);
+  if (size < 0)
+    throw make_error(hnd_, "get file image");
+  std::vector<unsigned char> buf(size);
+  if (H5Fget_file_image(hnd_, buf.data(), buf.size()) < 0)
+    throw make_error(hnd_, "get file image");
+  return buf;
+}
+
+template <class T>
+auto file::dset_open_as(size_t i) const -> T
+{
+  if (state_->cache)
+    return state_->cache->open<T>(hnd_, object_cache::kind::dataset, i, state_, [&]() -> T { return {hnd_, i, true, state_}; });
+  return {hnd_, i, true, state_};
+}
+
+template auto file::dset_open_as<dataset>(size_t i) const -> dataset;
+template auto file::dset_open_as<scan>(size_t i) const -> scan;
+template auto file::dset_open_as<profile>(size_t i) const -> profile;
+template auto file::dset_open_as<cartesian_dataset>(size_t i) const -> cartesian_dataset;
+
+template <class T>
+auto file::dset_make_as() -> T
+{
+  return {hnd_, size_++, false, state_};
+}
+
+template auto file::dset_make_as<scan>() -> scan;
+template auto file::dset_make_as<profile>() -> profile;
+template auto file::dset_make_as<cartesian_dataset>() -> cartesian_dataset;
+
+auto file::conventions() const -> std::string
+{
+  return attribute{hnd_, "Conventions", true}.get_string();
+}
+
+auto file::set_conventions(const std::string& val) -> void
+{
+  attribute{hnd_, "Conventions", false}.set(val);
+}
+
+auto file::set_object(object_type type) -> void
+{
+  const char* val;
+  switch (type)
+  {
+  case object_type::polar_volume:
+    val = "PVOL";
+    break;
+  case object_type::cartesian_volume:
+    val = "CVOL";
+    break;
+  case object_type::polar_scan:
+    val = "SCAN";
+    break;
+  case object_type::polar_ray:
+    val = "RAY";
+    break;
+  case object_type::azimuthal_object:
+    val = "AZIM";
+    break;
+  case object_type::cartesian_image:
+    val = "IMAGE";
+    break;
+  case object_type::composite_image:
+    val = "COMP";
+    break;
+  case object_type::vertical_cross_section:
+    val = "XSEC";
+    break;
+  case object_type::vertical_profile:
+    val = "VP";
+    break;
+  case object_type::graphical_image:
+    val = "PIC";
+    break;
+  default:
+    val = "UNKNOWN";
+    break;
+  }
+  attributes()[keys::id::object].set(val);
+}
+
+auto file::version() const -> std::pair<int, int>
+{
+  std::pair<int, int> ret;
+  auto str = attributes()[keys::id::version].get_string();
+  if (sscanf(str.c_str(), "H5rad %d.%d", &ret.first, &ret.second) != 2)
+    throw make_error(hnd_, "read attribute", "version", "syntax error");
+  return ret;
+}
+
+auto file::set_version(int major, int minor) -> void
+{
+  char buf[32];
+  sprintf(buf, "H5rad %d.%d", major, minor);
+  attributes()[keys::id::version].set(buf);
+}
+
+auto file::date() const -> std::string
+{
+  return attributes()[keys::id::date].get_string();
+}
+
+auto file::set_date(const std::string& val) -> void
+{
+  attributes()[keys::id::date].set(val);
+}
+
+auto file::time() const -> std::string
+{
+  return attributes()[keys::id::time].get_string();
+}
+
+auto file::set_time(const std::string& val) -> void
+{
+  attributes()[keys::id::time].set(val);
+}
+
+auto file::date_time() const -> time_t
+{
+  return strings_to_time(attributes()[keys::id::date].get_string(), attributes()[keys::id::time].get_string());
+}
+
+auto file::set_date_time(time_t val) -> void
+{
+  char date[9], time[7];
+  time_to_strings(val, date, time);
+  attributes()[keys::id::date].set(date);
+  attributes()[keys::id::time].set(time);
+}
+
+auto file::source() const -> std::string
+{
+  return attributes()[keys::id::source].get_string();
+}
+
+auto file::set_source(const std::string& val) -> void
+{
+  attributes()[keys::id::source].set(val);
+}
+
+auto file::is_api_attribute(const std::string& name) const -> bool
+{
+  return 
+       name == "object"
+    || name == "version"
+    || name == "date"
+    || name == "time"
+    || name == "source"
+    || group::is_api_attribute(name);
+}
+
+//------------------------------------------------------------------------------
+
+auto scan::elevation_angle() const -> double
+{
+  return attributes()[keys::id::elangle].get_real();
+}
+
+auto scan::set_elevation_angle(double val) -> void
+{
+  attributes()[keys::id::elangle].set(val);
+}
+
+auto scan::bin_count() const -> long
+{
+  return attributes()[keys::id::nbins].get_integer();
+}
+
+auto scan::set_bin_count(long val) -> void
+{
+  attributes()[keys::id::nbins].set(val);
+}
+
+auto scan::range_start() const -> double
+{
+  return attributes()[keys::id::rstart].get_real();
+}
+
+auto scan::set_range_start(double val) -> void
+{
+  attributes()[keys::id::rstart].set(val);
+}
+
+auto scan::range_scale() const -> double
+{
+  return attributes()[keys::id::rscale].get_real();
+}
+
+auto scan::set_range_scale(double val) -> void
+{
+  attributes()[keys::id::rscale].set(val);
+}
+
+auto scan::ray_count() const -> long
+{
+  return attributes()[keys::id::nrays].get_integer();
+}
+
+auto scan::set_ray_count(long val) -> void
+{
+  attributes()[keys::id::nrays].set(val);
+}
+
+auto scan::ray_start() const -> double
+{
+  // since astart is technically a 'how' attribute we must cope iwth its absence and return the default
+  auto i = attributes().find("astart");
+  if (i != attributes().end())
+    return i->get_real();
+  return 0.0;
+}
+
+auto scan::set_ray_start(double val) -> void
+{
+  attributes()["astart"].set(val);
+}
+
+auto scan::first_ray_radiated() const -> long
+{
+  return attributes()[keys::id::a1gate].get_integer();
+}
+
+auto scan::set_first_ray_radiated(long val) -> void
+{
+  attributes()[keys::id::a1gate].set(val);
+}
+
+auto scan::start_date() const -> std::string
+{
+  return attributes()[keys::id::startdate].get_string();
+}
+
+auto scan::set_start_date(const std::string& val) -> void
+{
+  attributes()[keys::id::startdate].set(val);
+}
+
+auto scan::start_time() const -> std::string
+{
+  return attributes()[keys::id::starttime].get_string();
+}
+
+auto scan::set_start_time(const std::string& val) -> void
+{
+  attributes()[keys::id::starttime].set(val);
+}
+
+auto scan::start_date_time() const -> time_t
+{
+  return strings_to_time(attributes()[keys::id::startdate].get_string(), attributes()[keys::id::starttime].get_string());
+}
+
+auto scan::set_start_date_time(time_t val) -> void
+{
+  char date[9], time[7];
+  time_to_strings(val, date, time);
+  attributes()[keys::id::startdate].set(date);
+  attributes()[keys::id::starttime].set(time);
+}
+
+auto scan::end_date() const -> std::string
+{
+  return attributes()[keys::id::enddate].get_string();
+}
+
+auto scan::set_end_date(const std::string& val) -> void
+{
+  attributes()[keys::id::enddate].set(val);
+}
+
+auto scan::end_time() const -> std::string
+{
+  return attributes()[keys::id::endtime].get_string();
+}
+
+auto scan::set_end_time(const std::string& val) -> void
+{
+  attributes()[keys::id::endtime].set(val);
+}
+
+auto scan::end_date_time() const -> time_t
+{
+  return strings_to_time(attributes()[keys::id::enddate].get_string(), attributes()[keys::id::endtime].get_string());
+}
+
+auto scan::set_end_date_time(time_t val) -> void
+{
+  char date[9], time[7];
+  time_to_strings(val, date, time);
+  attributes()[keys::id::enddate].set(date);
+  attributes()[keys::id::endtime].set(time);
+}
+
+auto scan::select(double az_min, double az_max, double range_min, double range_max) const -> selection
+{
+  const auto nrays = ray_count();
+  const auto nbins = bin_count();
+  if (nrays <= 0 || nbins <= 0)
+    throw make_error(hnd_, "select region", nullptr, "empty scan");
+
+  // determine the bins which overlap the range interval (rstart is in km, rscale in m)
+  const auto rstart = range_start() * 1000.0;
+  const auto rscale = range_scale();
+  auto bin_lo = static_cast<long>(std::floor((range_min - rstart) / rscale));
+  auto bin_hi = static_cast<long>(std::ceil((range_max - rstart) / rscale));
+  bin_lo = std::max(bin_lo, 0L);
+  bin_hi = std::min(bin_hi, nbins);
+  if (bin_lo >= bin_hi)
+    throw make_error(hnd_, "select region", nullptr, "range interval outside scan");
+
+  // determine the rays which overlap the azimuth interval, relative to the first ray
+  const auto width = 360.0 / nrays;
+  auto rel = std::fmod(az_min - ray_start(), 360.0);
+  if (rel < 0.0)
+    rel += 360.0;
+  auto span = std::fmod(az_max - az_min, 360.0);
+  if (span <= 0.0)
+    span += 360.0;
+  auto ray_lo = std::min(static_cast<long>(std::floor(rel / width)), nrays - 1);
+  auto ray_hi = std::max(static_cast<long>(std::ceil((rel + span) / width)), ray_lo + 1);
+
+  const size_t stride[2] = { 1, 1 };
+  size_t start[2] = { 0, static_cast<size_t>(bin_lo) };
+  size_t count[2] = { 0, static_cast<size_t>(bin_hi - bin_lo) };
+  selection sel{2};
+  if (ray_hi - ray_lo >= nrays)
+  {
+    count[0] = nrays;
+    sel.add(start, count, stride);
+  }
+  else if (ray_hi > nrays)
+  {
+    count[0] = ray_hi - nrays;
+    sel.add(start, count, stride);
+    start[0] = ray_lo;
+    count[0] = nrays - ray_lo;
+    sel.add(start, count, stride);
+  }
+  else
+  {
+    start[0] = ray_lo;
+    count[0] = ray_hi - ray_lo;
+    sel.add(start, count, stride);
+  }
+  return sel;
+}
+
+auto scan::is_api_attribute(const std::string& name) const -> bool
+{
+  return 
+       name == "elangle"
+    || name == "nbins"
+    || name == "rstart"
+    || name == "rscale"
+    || name == "nrays"
+    || name == "astart"
+    || name == "a1gate"
+    || name == "startdate"
+    || name == "starttime"
+    || name == "enddate"
+    || name == "endtime"
+    || dataset::is_api_attribute(name);
+}
+
+polar_volume::polar_volume(const std::string& path, io_mode mode, const open_options& options)
+  : file{path, mode, options}
+{
+  if (mode_ == io_mode::create)
+    set_object(object_type::polar_volume);
+  else if (type_ != object_type::polar_volume)
+    throw make_error(hnd_, "unexpected object type", "polar_volume");
+}
+
+polar_volume::polar_volume(const void* image, size_t size, io_mode mode, const open_options& options)
+  : polar_volume{file{image, size, mode, options}}
+{ }
+
+polar_volume::polar_volume(file f)
+  : file{std::move(f)}
+{
+  if (mode_ == io_mode::create)
+    set_object(object_type::polar_volume);
+  else if (type_ != object_type::polar_volume)
+    throw make_error(hnd_, "unexpected object type", "polar_volume");
+}
+
+auto polar_volume::open_async(const std::string& path, io_mode mode, const open_options& options) -> io_future<polar_volume>
+{
+  return io_executor::instance().submit([path, mode, options]{ return polar_volume{path, mode, options}; });
+}
+
+auto polar_volume::metadata_async() const -> io_future<polar_volume_metadata>
+{
+  auto volume = *this;
+  return io_executor::instance().submit([volume]{ return volume.metadata(); });
+}
+
+// append the dataX layers of a dataset to a columnar snapshot
+static auto snapshot_layers(const dataset& dset, size_t index, const structure_index* structure, layer_columns& cols) -> void
+{
+  for (size_t j = 0; j < dset.data_count(); ++j)
+  {
+    auto layer = dset.data_open(j);
+    auto& attrs = layer.attributes();
+    cols.dataset.push_back(index);
+    cols.layer.push_back(j);
+    cols.quantity.push_back(optional_string(attrs, keys::id::quantity));
+    cols.gain.push_back(optional_real(attrs, keys::id::gain));
+    cols.offset.push_back(optional_real(attrs, keys::id::offset));
+    cols.nodata.push_back(optional_real(attrs, keys::id::nodata));
+    cols.undetect.push_back(optional_real(attrs, keys::id::undetect));
+
+    // prefer the dimensions recorded by the structure index to querying the dataset
+    size_t rows = 0, columns = 0;
+    auto l = structure ? structure->find(index, j) : nullptr;
+    if (l && !l->dims.empty())
+    {
+      rows = l->dims[0];
+      columns = l->dims.size() > 1 ? l->dims[1] : 1;
+    }
+    else if (!dset.options().metadata_only)
+    {
+      size_t dims[data::max_rank];
+      auto rank = layer.dims(dims);
+      rows = rank > 0 ? dims[0] : 0;
+      columns = rank > 1 ? dims[1] : 1;
+    }
+    cols.rows.push_back(rows);
+    cols.cols.push_back(columns);
+  }
+}
+
+auto polar_volume::metadata() const -> polar_volume_metadata
+{
+  polar_volume_metadata ret;
+  auto count = scan_count();
+  ret.elevation_angle.reserve(count);
+  ret.bin_count.reserve(count);
+  ret.ray_count.reserve(count);
+  ret.range_scale.reserve(count);
+  ret.range_start.reserve(count);
+  ret.first_ray_radiated.reserve(count);
+  ret.start_date_time.reserve(count);
+  ret.end_date_time.reserve(count);
+  ret.first_layer.reserve(count + 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    auto s = scan_open(i);
+    auto& attrs = s.attributes();
+    ret.elevation_angle.push_back(optional_real(attrs, keys::id::elangle));
+    ret.bin_count.push_back(optional_integer(attrs, keys::id::nbins));
+    ret.ray_count.push_back(optional_integer(attrs, keys::id::nrays));
+    ret.range_scale.push_back(optional_real(attrs, keys::id::rscale));
+    ret.range_start.push_back(optional_real(attrs, keys::id::rstart));
+    ret.first_ray_radiated.push_back(optional_integer(attrs, keys::id::a1gate));
+    ret.start_date_time.push_back(optional_time(attrs, keys::id::startdate, keys::id::starttime));
+    ret.end_date_time.push_back(optional_time(attrs, keys::id::enddate, keys::id::endtime));
+    ret.first_layer.push_back(ret.layers.size());
+    snapshot_layers(s, i, state_->structure.get(), ret.layers);
+  }
+  ret.first_layer.push_back(ret.layers.size());
+  return ret;
+}
+
+auto polar_volume::longitude() const -> double
+{
+  return attributes()[keys::id::lon].get_real();
+}
+
+auto polar_volume::set_longitude(double val) -> void
+{
+  attributes()[keys::id::lon].set(val);
+}
+
+auto polar_volume::latitude() const -> double
+{
+  return attributes()[keys::id::lat].get_real();
+}
+
+auto polar_volume::set_latitude(double val) -> void
+{
+  attributes()[keys::id::lat].set(val);
+}
+
+auto polar_volume::height() const -> double
+{
+  return attributes()[keys::id::height].get_real();
+}
+
+auto polar_volume::set_height(double val) -> void
+{
+  attributes()[keys::id::height].set(val);
+}
+
+auto polar_volume::is_api_attribute(const std::string& name) const -> bool
+{
+  return 
+       name == "lon"
+    || name == "lat"
+    || name == "height"
+    || file::is_api_attribute(name);
+}
+
+struct sweep_reader::state
+{
+  state(const polar_volume& volume, settings config)
+    : volume(volume)
+    , config(std::move(config))
+    , bytes{0}
+    , done{false}
+    , cancelled{false}
+  { }
+
+  polar_volume            volume;
+  settings                config;
+  std::mutex              mutex;
+  std::condition_variable cv;         // signalled whenever any of the below change
+  std::deque<sweep>       ready;      // decoded scans waiting for the caller
+  std::vector<sweep>      spare;      // scans returned by the caller for reuse of their buffers
+  size_t                  bytes;      // bytes of values held in ready
+  bool                    done;       // background thread has finished
+  std::atomic<bool>       cancelled;
+  std::exception_ptr      err;
+  std::thread             thread;
+};
+
+static auto sweep_bytes(const sweep_reader::sweep& sw) -> size_t
+{
+  size_t ret = 0;
+  for (auto& l : sw.layers)
+    ret += l.values.size() * sizeof(float);
+  return ret;
+}
+
+sweep_reader::sweep_reader(const polar_volume& volume)
+  : sweep_reader{volume, settings{}}
+{ }
+
+sweep_reader::sweep_reader(const polar_volume& volume, settings config)
+{
+  if (!thread_safe())
+    throw make_error({}, "sweep reader", nullptr, "thread safe mode must be enabled");
+  if (config.lookahead == 0)
+    config.lookahead = 1;
+  state_ = std::make_shared<state>(volume, std::move(config));
+  state_->thread = std::thread{run, state_};
+}
+
+auto sweep_reader::operator=(sweep_reader&& rhs) noexcept -> sweep_reader&
+{
+  if (this != &rhs)
+  {
+    stop();
+    state_ = std::move(rhs.state_);
+  }
+  return *this;
+}
+
+sweep_reader::~sweep_reader()
+{
+  stop();
+}
+
+auto sweep_reader::next(sweep& out) -> bool
+{
+  auto& st = *state_;
+  std::unique_lock<std::mutex> lock{st.mutex};
+  st.cv.wait(lock, [&]{ return !st.ready.empty() || st.done || st.cancelled; });
+  if (st.ready.empty())
+  {
+    // errors are only reported once every scan decoded before the failure has been returned
+    if (st.err && !st.cancelled)
+    {
+      auto err = st.err;
+      st.err = nullptr;
+      std::rethrow_exception(err);
+    }
+    return false;
+  }
+
+  auto old = std::move(out);
+  out = std::move(st.ready.front());
+  st.ready.pop_front();
+  st.bytes -= sweep_bytes(out);
+  if (st.spare.size() < st.config.lookahead)
+    st.spare.push_back(std::move(old));
+  st.cv.notify_all();
+  return true;
+}
+
+auto sweep_reader::cancel() -> void
+{
+  auto& st = *state_;
+  std::lock_guard<std::mutex> lock{st.mutex};
+  st.cancelled = true;
+  st.ready.clear();
+  st.bytes = 0;
+  st.cv.notify_all();
+}
+
+auto sweep_reader::stop() noexcept -> void
+{
+  if (!state_)
+    return;
+  cancel();
+  if (state_->thread.joinable())
+    state_->thread.join();
+  state_.reset();
+}
+
+auto sweep_reader::run(const std::shared_ptr<state>& stp) -> void
+{
+  auto& st = *stp;
+  try
+  {
+    std::vector<data> layers;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < st.volume.scan_count() && !st.cancelled; ++i)
+    {
+      // open the selected layers first so that their size is known before we commit to decoding them
+      auto scan = st.volume.scan_open(i);
+      size_t bytes = 0;
+      layers.clear();
+      indices.clear();
+      for (size_t j = 0; j < scan.data_count(); ++j)
+      {
+        auto layer = scan.data_open(j);
+        if (   !st.config.quantities.empty()
+            && std::find(st.config.quantities.begin(), st.config.quantities.end(), layer.quantity()) == st.config.quantities.end())
+          continue;
+        bytes += layer.size() * sizeof(float);
+        layers.push_back(std::move(layer));
+        indices.push_back(j);
+      }
+
+      // wait until decoding this scan would not exceed our bounds, but always allow one scan to be queued
+      sweep sw;
+      {
+        std::unique_lock<std::mutex> lock{st.mutex};
+        st.cv.wait(lock, [&]
+        {
+          return st.cancelled
+            || (   st.ready.size() < st.config.lookahead
+                && (st.ready.empty() || st.bytes + bytes <= st.config.max_bytes));
+        });
+        if (st.cancelled)
+          break;
+        if (!st.spare.empty())
+        {
+          sw = std::move(st.spare.back());
+          st.spare.pop_back();
+        }
+      }
+
+      sw.index = i;
+      sw.elevation = optional_real(scan.attributes(), keys::id::elangle);
+      sw.layers.resize(layers.size());
+      for (size_t l = 0; l < layers.size() && !st.cancelled; ++l)
+      {
+        auto& out = sw.layers[l];
+        size_t dims[data::max_rank];
+        auto rank = layers[l].dims(dims);
+        out.index = indices[l];
+        out.quantity = layers[l].quantity();
+        out.rows = rank > 0 ? dims[0] : 0;
+        out.cols = rank > 1 ? dims[1] : 1;
+        out.values.resize(layers[l].size());
+        layers[l].read_unpack(out.values.data(), st.config.undetect, st.config.nodata);
+      }
+
+      std::lock_guard<std::mutex> lock{st.mutex};
+      if (st.cancelled)
         break;
+      st.bytes += sweep_bytes(sw);
+      st.ready.push_back(std::move(sw));
+      st.cv.notify_all();
+    }
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock{st.mutex};
+    st.err = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> lock{st.mutex};
+  st.done = true;
+  st.cv.notify_all();
+}
+
+struct volume_writer::state
+{
+  state(std::string path, settings config)
+    : path(std::move(path))
+    , config(std::move(config))
+    , bytes{0}
+    , busy{false}
+    , closed{false}
+  { }
+
+  // an operation and the bytes of values it captured
+  typedef std::pair<size_t, std::function<void(state&)>> item;
+
+  std::string                             path;
+  settings                                config;
+  std::vector<std::vector<size_t>>        sizes;    // element count of each layer, used by the caller
+
+  std::mutex                              mutex;
+  std::condition_variable                 cv;       // signalled whenever any of the below change
+  std::deque<item>                        queue;
+  size_t                                  bytes;    // bytes captured by queued or running operations
+  bool                                    busy;     // background thread is running an operation
+  bool                                    closed;
+  std::exception_ptr                      err;
+  std::thread                             thread;
+
+  // owned by the background thread
+  std::unique_ptr<polar_volume>           volume;
+  std::vector<scan>                       scans;
+  std::vector<std::vector<data>>          layers;
+};
+
+// queue an operation, blocking while too many captured bytes are waiting to be written
+auto volume_writer::enqueue(state& st, size_t bytes, std::function<void(state&)> op) -> void
+{
+  std::unique_lock<std::mutex> lock{st.mutex};
+  if (bytes > 0)
+    st.cv.wait(lock, [&]{ return st.err || st.bytes == 0 || st.bytes + bytes <= st.config.max_bytes; });
+  if (st.err)
+    std::rethrow_exception(st.err);
+  if (st.closed)
+    throw make_error({}, "volume writer", st.path.c_str(), "writer is closed");
+  st.queue.emplace_back(bytes, std::move(op));
+  st.bytes += bytes;
+  st.cv.notify_all();
+}
+
+// run queued operations until the writer is closed, discarding any after a failure
+auto volume_writer::run(state& st) -> void
+{
+  std::unique_lock<std::mutex> lock{st.mutex};
+  while (true)
+  {
+    st.cv.wait(lock, [&]{ return !st.queue.empty() || st.closed; });
+    if (st.queue.empty())
+      break;
+    auto item = std::move(st.queue.front());
+    st.queue.pop_front();
+    st.busy = true;
+    auto failed = static_cast<bool>(st.err);
+    lock.unlock();
+
+    std::exception_ptr err;
+    if (!failed)
+    {
+      try
+      {
+        item.second(st);
+      }
+      catch (...)
+      {
+        err = std::current_exception();
       }
     }
+    // release captured buffers before reporting progress so the memory limit is honoured
+    item.second = nullptr;
+
+    lock.lock();
+    if (err && !st.err)
+      st.err = err;
+    st.bytes -= item.first;
+    st.busy = false;
+    st.cv.notify_all();
+  }
+  lock.unlock();
 
-    // determine the object type
-    auto str = attributes()["object"].get_string();
-    if (str == "PVOL")
-      type_ = object_type::polar_volume;
-    else if (str == "CVOL")
-      type_ = object_type::cartesian_volume;
-    else if (str == "SCAN")
-      type_ = object_type::polar_scan;
-    else if (str == "RAY")
-      type_ = object_type::polar_ray;
-    else if (str == "AZIM")
-      type_ = object_type::azimuthal_object;
-    else if (str == "IMAGE")
-      type_ = object_type::cartesian_image;
-    else if (str == "COMP")
-      type_ = object_type::composite_image;
-    else if (str == "XSEC")
-      type_ = object_type::vertical_cross_section;
-    else if (str == "VP")
-      type_ = object_type::vertical_profile;
-    else if (str == "PIC")
-      type_ = object_type::graphical_image;
+  try
+  {
+    st.layers.clear();
+    st.scans.clear();
+    st.volume.reset();
   }
-  else
+  catch (...)
   {
-    // set the default conventions and version attributes
-    set_conventions(default_conventions);
-    set_version(default_version_major, default_version_minor);
+    lock.lock();
+    if (!st.err)
+      st.err = std::current_exception();
+  }
+}
+
+volume_writer::volume_writer(const std::string& path)
+  : volume_writer{path, settings{}}
+{ }
+
+volume_writer::volume_writer(const std::string& path, settings config)
+  : state_{new state{path, std::move(config)}}
+{
+  state_->queue.emplace_back(0, [](state& st)
+  {
+    st.volume.reset(new polar_volume{st.path, file::io_mode::create});
+  });
+  auto st = state_.get();
+  state_->thread = std::thread{[st]{ run(*st); }};
+}
+
+volume_writer::~volume_writer()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  { }
+}
+
+auto volume_writer::scan_append() -> size_t
+{
+  auto index = state_->sizes.size();
+  enqueue(*state_, 0, [](state& st)
+  {
+    st.scans.push_back(st.volume->scan_append());
+    st.layers.emplace_back();
+  });
+  state_->sizes.emplace_back();
+  return index;
+}
+
+auto volume_writer::data_append(size_t scan, const std::string& quantity, data::data_type type, size_t rank, const size_t* dims) -> size_t
+{
+  if (scan >= state_->sizes.size())
+    throw make_error({}, "volume writer", "data append", "invalid scan index");
+  if (rank > data::max_rank)
+    throw make_error({}, "volume writer", "data append", "invalid rank");
+
+  std::vector<size_t> shape(dims, dims + rank);
+  size_t count = 1;
+  for (auto d : shape)
+    count *= d;
+
+  auto index = state_->sizes[scan].size();
+  enqueue(*state_, 0, [scan, quantity, type, shape](state& st)
+  {
+    st.layers[scan].push_back(st.scans[scan].data_append(quantity, type, shape.size(), shape.data(), st.config.compression, st.config.layout));
+  });
+  state_->sizes[scan].push_back(count);
+  return index;
+}
+
+auto volume_writer::set_attribute(size_t scan, size_t layer, const std::string& name, const char* val) -> void
+{
+  set_attribute(scan, layer, name, std::string{val});
+}
+
+auto volume_writer::defer(std::function<void(polar_volume&)> op) -> void
+{
+  enqueue(*state_, 0, [op](state& st) { op(*st.volume); });
+}
+
+auto volume_writer::flush() -> void
+{
+  auto& st = *state_;
+  enqueue(st, 0, [](state& st) { st.volume->flush(); });
+
+  std::unique_lock<std::mutex> lock{st.mutex};
+  st.cv.wait(lock, [&]{ return st.queue.empty() && !st.busy; });
+  if (st.err)
+    std::rethrow_exception(st.err);
+}
+
+auto volume_writer::close() -> void
+{
+  auto& st = *state_;
+  {
+    std::lock_guard<std::mutex> lock{st.mutex};
+    st.closed = true;
+    st.cv.notify_all();
   }
+  if (st.thread.joinable())
+    st.thread.join();
+  if (st.err)
+    std::rethrow_exception(st.err);
+}
+
+auto volume_writer::layer_size(size_t scan, size_t layer) const -> size_t
+{
+  if (scan >= state_->sizes.size() || layer >= state_->sizes[scan].size())
+    throw make_error({}, "volume writer", "write", "invalid scan or layer index");
+  return state_->sizes[scan][layer];
+}
+
+auto volume_writer::enqueue_attribute(size_t scan, size_t layer, const std::string& name, std::function<void(attribute&)> op) -> void
+{
+  if (scan != npos && (scan >= state_->sizes.size() || (layer != npos && layer >= state_->sizes[scan].size())))
+    throw make_error({}, "volume writer", name.c_str(), "invalid scan or layer index");
+
+  enqueue(*state_, 0, [scan, layer, name, op](state& st)
+  {
+    auto& attrs = scan == npos
+      ? st.volume->attributes()
+      : layer == npos ? st.scans[scan].attributes() : st.layers[scan][layer].attributes();
+    op(attrs[name.c_str()]);
+  });
+}
+
+auto volume_writer::enqueue_layer(size_t scan, size_t layer, size_t count, size_t element_size, std::function<void(data&)> op) -> void
+{
+  if (count != layer_size(scan, layer))
+    throw make_error({}, "volume writer", "write", "value count does not match layer size");
+
+  enqueue(*state_, count * element_size, [scan, layer, op](state& st) { op(st.layers[scan][layer]); });
+}
+
+vertical_profile::vertical_profile(const std::string& path, io_mode mode, const open_options& options)
+  : file{path, mode, options}
+{
+  if (mode_ == io_mode::create)
+    set_object(object_type::vertical_profile);
+  else if (type_ != object_type::vertical_profile)
+    throw make_error(hnd_, "unexpected object type", "vertical_profile");
+}
+
+vertical_profile::vertical_profile(const void* image, size_t size, io_mode mode, const open_options& options)
+  : vertical_profile{file{image, size, mode, options}}
+{ }
+
+vertical_profile::vertical_profile(file f)
+  : file{std::move(f)}
+{
+  if (mode_ == io_mode::create)
+    set_object(object_type::vertical_profile);
+  else if (type_ != object_type::vertical_profile)
+    throw make_error(hnd_, "unexpected object type", "vertical_profile");
+}
+
+auto vertical_profile::open_async(const std::string& path, io_mode mode, const open_options& options) -> io_future<vertical_profile>
+{
+  return io_executor::instance().submit([path, mode, options]{ return vertical_profile{path, mode, options}; });
 }
 
-auto file::flush() -> void
+auto vertical_profile::metadata_async() const -> io_future<vertical_profile_metadata>
 {
-  if (H5Fflush(hnd_, H5F_SCOPE_LOCAL) < 0) 
-    throw make_error(hnd_, "flush");
+  auto profile = *this;
+  return io_executor::instance().submit([profile]{ return profile.metadata(); });
 }
 
-template <class T>
-auto file::dset_open_as(size_t i) const -> T
+auto vertical_profile::metadata() const -> vertical_profile_metadata
 {
-  return {hnd_, i, true};
+  vertical_profile_metadata ret;
+  auto count = profile_count();
+  ret.start_date_time.reserve(count);
+  ret.end_date_time.reserve(count);
+  ret.first_layer.reserve(count + 1);
+  for (size_t i = 0; i < count; ++i)
+  {
+    auto p = profile_open(i);
+    auto& attrs = p.attributes();
+    ret.start_date_time.push_back(optional_time(attrs, keys::id::startdate, keys::id::starttime));
+    ret.end_date_time.push_back(optional_time(attrs, keys::id::enddate, keys::id::endtime));
+    ret.first_layer.push_back(ret.layers.size());
+    snapshot_layers(p, i, state_->structure.get(), ret.layers);
+  }
+  ret.first_layer.push_back(ret.layers.size());
+  return ret;
 }
 
-template auto file::dset_open_as<dataset>(size_t i) const -> dataset;
-template auto file::dset_open_as<scan>(size_t i) const -> scan;
-template auto file::dset_open_as<profile>(size_t i) const -> profile;
-
-template <class T>
-auto file::dset_make_as() -> T
+auto vertical_profile::longitude() const -> double
 {
-  return {hnd_, size_++, false};
+  return attributes()[keys::id::lon].get_real();
 }
 
-template auto file::dset_make_as<scan>() -> scan;
-template auto file::dset_make_as<profile>() -> profile;
-
-auto file::conventions() const -> std::string
+auto vertical_profile::set_longitude(double val) -> void
 {
-  return attribute{&hnd_, "Conventions", true}.get_string();
+  attributes()[keys::id::lon].set(val);
 }
 
-auto file::set_conventions(const std::string& val) -> void
+auto vertical_profile::latitude() const -> double
 {
-  attribute{&hnd_, "Conventions", false}.set(val);
+  return attributes()[keys::id::lat].get_real();
 }
 
-auto file::set_object(object_type type) -> void
+auto vertical_profile::set_latitude(double val) -> void
 {
-  const char* val;
-  switch (type)
-  {
-  case object_type::polar_volume:
-    val = "PVOL";
-    break;
-  case object_type::cartesian_volume:
-    val = "CVOL";
-    break;
-  case object_type::polar_scan:
-    val = "SCAN";
-    break;
-  case object_type::polar_ray:
-    val = "RAY";
-    break;
-  case object_type::azimuthal_object:
-    val = "AZIM";
-    break;
-  case object_type::cartesian_image:
-    val = "IMAGE";
-    break;
-  case object_type::composite_image:
-    val = "COMP";
-    break;
-  case object_type::vertical_cross_section:
-    val = "XSEC";
-    break;
-  case object_type::vertical_profile:
-    val = "VP";
-    break;
-  case object_type::graphical_image:
-    val = "PIC";
-    break;
-  default:
-    val = "UNKNOWN";
-    break;
-  }
-  attributes()["object"].set(val);
+  attributes()[keys::id::lat].set(val);
 }
 
-auto file::version() const -> std::pair<int, int>
+auto vertical_profile::height() const -> double
 {
-  std::pair<int, int> ret;
-  auto str = attributes()["version"].get_string();
-  if (sscanf(str.c_str(), "H5rad %d.%d", &ret.first, &ret.second) != 2)
-    throw make_error(hnd_, "read attribute", "version", "syntax error");
-  return ret;
+  return attributes()[keys::id::height].get_real();
 }
 
-auto file::set_version(int major, int minor) -> void
+auto vertical_profile::set_height(double val) -> void
 {
-  char buf[32];
-  sprintf(buf, "H5rad %d.%d", major, minor);
-  attributes()["version"].set(buf);
+  attributes()[keys::id::height].set(val);
 }
 
-auto file::date() const -> std::string
+auto vertical_profile::level_count() const -> long
 {
-  return attributes()["date"].get_string();
+  return attributes()[keys::id::levels].get_integer();
 }
 
-auto file::set_date(const std::string& val) -> void
+auto vertical_profile::set_level_count(long val) -> void
 {
-  attributes()["date"].set(val);
+  attributes()[keys::id::levels].set(val);
 }
 
-auto file::time() const -> std::string
+auto vertical_profile::interval() const -> double
 {
-  return attributes()["time"].get_string();
+  return attributes()[keys::id::interval].get_real();
 }
 
-auto file::set_time(const std::string& val) -> void
+auto vertical_profile::set_interval(double val) -> void
 {
-  attributes()["time"].set(val);
+  attributes()[keys::id::interval].set(val);
 }
 
-auto file::date_time() const -> time_t
+auto vertical_profile::min_height() const -> double
 {
-  return strings_to_time(attributes()["date"].get_string(), attributes()["time"].get_string());
+  return attributes()[keys::id::minheight].get_real();
 }
 
-auto file::set_date_time(time_t val) -> void
+auto vertical_profile::set_min_height(double val) -> void
 {
-  char date[9], time[7];
-  time_to_strings(val, date, time);
-  attributes()["date"].set(date);
-  attributes()["time"].set(time);
+  attributes()[keys::id::minheight].set(val);
 }
 
-auto file::source() const -> std::string
+auto vertical_profile::max_height() const -> double
 {
-  return attributes()["source"].get_string();
+  return attributes()[keys::id::maxheight].get_real();
 }
 
-auto file::set_source(const std::string& val) -> void
+auto vertical_profile::set_max_height(double val) -> void
 {
-  attributes()["source"].set(val);
+  attributes()[keys::id::maxheight].set(val);
 }
 
-auto file::is_api_attribute(const std::string& name) const -> bool
+auto vertical_profile::is_api_attribute(const std::string& name) const -> bool
 {
   return 
-       name == "object"
-    || name == "version"
-    || name == "date"
-    || name == "time"
-    || name == "source"
-    || group::is_api_attribute(name);
+       name == "lon"
+    || name == "lat"
+    || name == "height"
+    || name == "levels"
+    || name == "interval"
+    || name == "minheight"
+    || name == "maxheight"
+    || file::is_api_attribute(name);
 }
 
-//------------------------------------------------------------------------------
+auto profile::start_date() const -> std::string
+{
+  return attributes()[keys::id::startdate].get_string();
+}
 
-auto scan::elevation_angle() const -> double
+auto profile::set_start_date(const std::string& val) -> void
 {
-  return attributes()["elangle"].get_real();
+  attributes()[keys::id::startdate].set(val);
 }
 
-auto scan::set_elevation_angle(double val) -> void
+auto profile::start_time() const -> std::string
 {
-  attributes()["elangle"].set(val);
+  return attributes()[keys::id::starttime].get_string();
 }
 
-auto scan::bin_count() const -> long
+auto profile::set_start_time(const std::string& val) -> void
 {
-  return attributes()["nbins"].get_integer();
+  attributes()[keys::id::starttime].set(val);
 }
 
-auto scan::set_bin_count(long val) -> void
+auto profile::start_date_time() const -> time_t
 {
-  attributes()["nbins"].set(val);
+  return strings_to_time(attributes()[keys::id::startdate].get_string(), attributes()[keys::id::starttime].get_string());
 }
 
-auto scan::range_start() const -> double
+auto profile::set_start_date_time(time_t val) -> void
 {
-  return attributes()["rstart"].get_real();
+  char date[9], time[7];
+  time_to_strings(val, date, time);
+  attributes()[keys::id::startdate].set(date);
+  attributes()[keys::id::starttime].set(time);
 }
 
-auto scan::set_range_start(double val) -> void
+auto profile::end_date() const -> std::string
 {
-  attributes()["rstart"].set(val);
+  return attributes()[keys::id::enddate].get_string();
 }
 
-auto scan::range_scale() const -> double
+auto profile::set_end_date(const std::string& val) -> void
 {
-  return attributes()["rscale"].get_real();
+  attributes()[keys::id::enddate].set(val);
 }
 
-auto scan::set_range_scale(double val) -> void
+auto profile::end_time() const -> std::string
 {
-  attributes()["rscale"].set(val);
+  return attributes()[keys::id::endtime].get_string();
 }
 
-auto scan::ray_count() const -> long
+auto profile::set_end_time(const std::string& val) -> void
 {
-  return attributes()["nrays"].get_integer();
+  attributes()[keys::id::endtime].set(val);
 }
 
-auto scan::set_ray_count(long val) -> void
+auto profile::end_date_time() const -> time_t
 {
-  attributes()["nrays"].set(val);
+  return strings_to_time(attributes()[keys::id::enddate].get_string(), attributes()[keys::id::endtime].get_string());
 }
 
-auto scan::ray_start() const -> double
+auto profile::set_end_date_time(time_t val) -> void
 {
-  // since astart is technically a 'how' attribute we must cope iwth its absence and return the default
-  auto i = attributes().find("astart");
-  if (i != attributes().end())
-    return i->get_real();
-  return 0.0;
+  char date[9], time[7];
+  time_to_strings(val, date, time);
+  attributes()[keys::id::enddate].set(date);
+  attributes()[keys::id::endtime].set(time);
 }
 
-auto scan::set_ray_start(double val) -> void
+auto profile::is_api_attribute(const std::string& name) const -> bool
 {
-  attributes()["astart"].set(val);
+  return 
+       name == "startdate"
+    || name == "starttime"
+    || name == "enddate"
+    || name == "endtime"
+    || dataset::is_api_attribute(name);
 }
 
-auto scan::first_ray_radiated() const -> long
+auto cartesian_dataset::product() const -> std::string
 {
-  return attributes()["a1gate"].get_integer();
+  return attributes()[keys::id::product].get_string();
 }
 
-auto scan::set_first_ray_radiated(long val) -> void
+auto cartesian_dataset::set_product(const std::string& val) -> void
 {
-  attributes()["a1gate"].set(val);
+  attributes()[keys::id::product].set(val);
 }
 
-auto scan::start_date() const -> std::string
+auto cartesian_dataset::start_date() const -> std::string
 {
-  return attributes()["startdate"].get_string();
+  return attributes()[keys::id::startdate].get_string();
 }
 
-auto scan::set_start_date(const std::string& val) -> void
+auto cartesian_dataset::set_start_date(const std::string& val) -> void
 {
-  attributes()["startdate"].set(val);
+  attributes()[keys::id::startdate].set(val);
 }
 
-auto scan::start_time() const -> std::string
+auto cartesian_dataset::start_time() const -> std::string
 {
-  return attributes()["starttime"].get_string();
+  return attributes()[keys::id::starttime].get_string();
 }
 
-auto scan::set_start_time(const std::string& val) -> void
+auto cartesian_dataset::set_start_time(const std::string& val) -> void
 {
-  attributes()["starttime"].set(val);
+  attributes()[keys::id::starttime].set(val);
 }
 
-auto scan::start_date_time() const -> time_t
+auto cartesian_dataset::start_date_time() const -> time_t
 {
-  return strings_to_time(attributes()["startdate"].get_string(), attributes()["starttime"].get_string());
+  return strings_to_time(attributes()[keys::id::startdate].get_string(), attributes()[keys::id::starttime].get_string());
 }
 
-auto scan::set_start_date_time(time_t val) -> void
+auto cartesian_dataset::set_start_date_time(time_t val) -> void
 {
   char date[9], time[7];
   time_to_strings(val, date, time);
-  attributes()["startdate"].set(date);
-  attributes()["starttime"].set(time);
+  attributes()[keys::id::startdate].set(date);
+  attributes()[keys::id::starttime].set(time);
 }
 
-auto scan::end_date() const -> std::string
+auto cartesian_dataset::end_date() const -> std::string
 {
-  return attributes()["enddate"].get_string();
+  return attributes()[keys::id::enddate].get_string();
 }
 
-auto scan::set_end_date(const std::string& val) -> void
+auto cartesian_dataset::set_end_date(const std::string& val) -> void
 {
-  attributes()["enddate"].set(val);
+  attributes()[keys::id::enddate].set(val);
 }
 
-auto scan::end_time() const -> std::string
+auto cartesian_dataset::end_time() const -> std::string
 {
-  return attributes()["endtime"].get_string();
+  return attributes()[keys::id::endtime].get_string();
 }
 
-auto scan::set_end_time(const std::string& val) -> void
+auto cartesian_dataset::set_end_time(const std::string& val) -> void
 {
-  attributes()["endtime"].set(val);
+  attributes()[keys::id::endtime].set(val);
 }
 
-auto scan::end_date_time() const -> time_t
+auto cartesian_dataset::end_date_time() const -> time_t
 {
-  return strings_to_time(attributes()["enddate"].get_string(), attributes()["endtime"].get_string());
+  return strings_to_time(attributes()[keys::id::enddate].get_string(), attributes()[keys::id::endtime].get_string());
 }
 
-auto scan::set_end_date_time(time_t val) -> void
+auto cartesian_dataset::set_end_date_time(time_t val) -> void
 {
   char date[9], time[7];
   time_to_strings(val, date, time);
-  attributes()["enddate"].set(date);
-  attributes()["endtime"].set(time);
+  attributes()[keys::id::enddate].set(date);
+  attributes()[keys::id::endtime].set(time);
 }
 
-auto scan::is_api_attribute(const std::string& name) const -> bool
+auto cartesian_dataset::is_api_attribute(const std::string& name) const -> bool
 {
   return 
-       name == "elangle"
-    || name == "nbins"
-    || name == "rstart"
-    || name == "rscale"
-    || name == "nrays"
-    || name == "astart"
-    || name == "a1gate"
+       name == "product"
     || name == "startdate"
     || name == "starttime"
     || name == "enddate"
@@ -1553,237 +5890,1302 @@ auto scan::is_api_attribute(const std::string& name) const -> bool
     || dataset::is_api_attribute(name);
 }
 
-polar_volume::polar_volume(const std::string& path, io_mode mode)
-  : file{path, mode}
+cartesian_image::cartesian_image(const std::string& path, io_mode mode, const open_options& options)
+  : cartesian_image{file{path, mode, options}, object_type::cartesian_image}
+{ }
+
+cartesian_image::cartesian_image(const void* image, size_t size, io_mode mode, const open_options& options)
+  : cartesian_image{file{image, size, mode, options}, object_type::cartesian_image}
+{ }
+
+cartesian_image::cartesian_image(file f)
+  : cartesian_image{std::move(f), object_type::cartesian_image}
+{ }
+
+cartesian_image::cartesian_image(file f, object_type type)
+  : file{std::move(f)}
 {
   if (mode_ == io_mode::create)
-    set_object(object_type::polar_volume);
-  else if (type_ != object_type::polar_volume)
-    throw make_error(hnd_, "unexpected object type", "polar_volume");
+    set_object(type);
+  else if (type_ != type)
+    throw make_error(hnd_, "unexpected object type", type == object_type::composite_image ? "composite" : "cartesian_image");
 }
 
-polar_volume::polar_volume(file f)
-  : file{std::move(f)}
+auto cartesian_image::open_async(const std::string& path, io_mode mode, const open_options& options) -> io_future<cartesian_image>
 {
-  if (mode_ == io_mode::create)
-    set_object(object_type::polar_volume);
-  else if (type_ != object_type::polar_volume)
-    throw make_error(hnd_, "unexpected object type", "polar_volume");
+  return io_executor::instance().submit([path, mode, options]{ return cartesian_image{path, mode, options}; });
+}
+
+auto cartesian_image::layer_append(
+      cartesian_dataset& image
+    , const std::string& quantity
+    , data::data_type type
+    , const compression_policy& compression
+    , const chunk_layout& layout
+    ) -> data
+{
+  const auto rows = y_size();
+  const auto cols = x_size();
+  if (rows <= 0 || cols <= 0)
+    throw make_error(hnd_, "append layer", quantity.c_str(), "invalid grid size");
+  const size_t dims[2] = { static_cast<size_t>(rows), static_cast<size_t>(cols) };
+  return image.data_append(quantity, type, 2, dims, compression, layout);
+}
+
+auto cartesian_image::projection() const -> std::string
+{
+  return attributes()[keys::id::projdef].get_string();
+}
+
+auto cartesian_image::set_projection(const std::string& val) -> void
+{
+  attributes()[keys::id::projdef].set(val);
+}
+
+auto cartesian_image::x_size() const -> long
+{
+  return attributes()[keys::id::xsize].get_integer();
+}
+
+auto cartesian_image::set_x_size(long val) -> void
+{
+  attributes()[keys::id::xsize].set(val);
+}
+
+auto cartesian_image::y_size() const -> long
+{
+  return attributes()[keys::id::ysize].get_integer();
+}
+
+auto cartesian_image::set_y_size(long val) -> void
+{
+  attributes()[keys::id::ysize].set(val);
+}
+
+auto cartesian_image::x_scale() const -> double
+{
+  return attributes()[keys::id::xscale].get_real();
+}
+
+auto cartesian_image::set_x_scale(double val) -> void
+{
+  attributes()[keys::id::xscale].set(val);
+}
+
+auto cartesian_image::y_scale() const -> double
+{
+  return attributes()[keys::id::yscale].get_real();
+}
+
+auto cartesian_image::set_y_scale(double val) -> void
+{
+  attributes()[keys::id::yscale].set(val);
+}
+
+auto cartesian_image::lower_left_longitude() const -> double
+{
+  return attributes()[keys::id::LL_lon].get_real();
+}
+
+auto cartesian_image::set_lower_left_longitude(double val) -> void
+{
+  attributes()[keys::id::LL_lon].set(val);
+}
+
+auto cartesian_image::lower_left_latitude() const -> double
+{
+  return attributes()[keys::id::LL_lat].get_real();
+}
+
+auto cartesian_image::set_lower_left_latitude(double val) -> void
+{
+  attributes()[keys::id::LL_lat].set(val);
+}
+
+auto cartesian_image::upper_left_longitude() const -> double
+{
+  return attributes()[keys::id::UL_lon].get_real();
+}
+
+auto cartesian_image::set_upper_left_longitude(double val) -> void
+{
+  attributes()[keys::id::UL_lon].set(val);
+}
+
+auto cartesian_image::upper_left_latitude() const -> double
+{
+  return attributes()[keys::id::UL_lat].get_real();
+}
+
+auto cartesian_image::set_upper_left_latitude(double val) -> void
+{
+  attributes()[keys::id::UL_lat].set(val);
+}
+
+auto cartesian_image::upper_right_longitude() const -> double
+{
+  return attributes()[keys::id::UR_lon].get_real();
+}
+
+auto cartesian_image::set_upper_right_longitude(double val) -> void
+{
+  attributes()[keys::id::UR_lon].set(val);
+}
+
+auto cartesian_image::upper_right_latitude() const -> double
+{
+  return attributes()[keys::id::UR_lat].get_real();
+}
+
+auto cartesian_image::set_upper_right_latitude(double val) -> void
+{
+  attributes()[keys::id::UR_lat].set(val);
+}
+
+auto cartesian_image::lower_right_longitude() const -> double
+{
+  return attributes()[keys::id::LR_lon].get_real();
 }
 
-auto polar_volume::longitude() const -> double
+auto cartesian_image::set_lower_right_longitude(double val) -> void
 {
-  return attributes()["lon"].get_real();
+  attributes()[keys::id::LR_lon].set(val);
 }
 
-auto polar_volume::set_longitude(double val) -> void
+auto cartesian_image::lower_right_latitude() const -> double
 {
-  attributes()["lon"].set(val);
+  return attributes()[keys::id::LR_lat].get_real();
 }
 
-auto polar_volume::latitude() const -> double
+auto cartesian_image::set_lower_right_latitude(double val) -> void
 {
-  return attributes()["lat"].get_real();
+  attributes()[keys::id::LR_lat].set(val);
 }
 
-auto polar_volume::set_latitude(double val) -> void
+auto cartesian_image::select(size_t x_min, size_t y_min, size_t x_max, size_t y_max) const -> selection
 {
-  attributes()["lat"].set(val);
+  const auto cols = static_cast<size_t>(std::max(x_size(), 0L));
+  const auto rows = static_cast<size_t>(std::max(y_size(), 0L));
+  x_max = std::min(x_max, cols);
+  y_max = std::min(y_max, rows);
+  if (x_min >= x_max || y_min >= y_max)
+    throw make_error(hnd_, "select region", nullptr, "region outside image");
+
+  const size_t start[2] = { y_min, x_min };
+  const size_t count[2] = { y_max - y_min, x_max - x_min };
+  return selection{2, start, count};
 }
 
-auto polar_volume::height() const -> double
+auto cartesian_image::is_api_attribute(const std::string& name) const -> bool
 {
-  return attributes()["height"].get_real();
+  return 
+       name == "projdef"
+    || name == "xsize"
+    || name == "ysize"
+    || name == "xscale"
+    || name == "yscale"
+    || name == "LL_lon"
+    || name == "LL_lat"
+    || name == "UL_lon"
+    || name == "UL_lat"
+    || name == "UR_lon"
+    || name == "UR_lat"
+    || name == "LR_lon"
+    || name == "LR_lat"
+    || file::is_api_attribute(name);
 }
 
-auto polar_volume::set_height(double val) -> void
+composite::composite(const std::string& path, io_mode mode, const open_options& options)
+  : cartesian_image{file{path, mode, options}, object_type::composite_image}
+{ }
+
+composite::composite(const void* image, size_t size, io_mode mode, const open_options& options)
+  : cartesian_image{file{image, size, mode, options}, object_type::composite_image}
+{ }
+
+composite::composite(file f)
+  : cartesian_image{std::move(f), object_type::composite_image}
+{ }
+
+auto composite::open_async(const std::string& path, io_mode mode, const open_options& options) -> io_future<composite>
 {
-  attributes()["height"].set(val);
+  return io_executor::instance().submit([path, mode, options]{ return composite{path, mode, options}; });
 }
 
-auto polar_volume::is_api_attribute(const std::string& name) const -> bool
+
+namespace
 {
-  return 
-       name == "lon"
-    || name == "lat"
-    || name == "height"
-    || file::is_api_attribute(name);
+  // on disk layout of a catalogue index, all integers are native byte order and each table is 8 byte aligned
+  constexpr uint32_t catalogue_version = 1;
+  constexpr uint32_t catalogue_byte_order = 0x01020304;
+  constexpr char catalogue_magic[8] = { 'O', 'D', 'I', 'M', 'C', 'A', 'T', '\0' };
+
+  struct catalogue_header
+  {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  byte_order;
+    uint64_t  files;
+    uint64_t  sources;
+    uint64_t  sweeps;
+    uint64_t  quantities;
+    uint64_t  strings;
+    uint64_t  off_files;
+    uint64_t  off_sources;
+    uint64_t  off_sweeps;
+    uint64_t  off_quantities;
+    uint64_t  off_time_order;
+    uint64_t  off_strings;
+  };
+
+  struct catalogue_file
+  {
+    int64_t   date_time;
+    int64_t   modified;
+    uint64_t  size;
+    double    latitude;
+    double    longitude;
+    double    height;
+    uint32_t  path;           // offsets into the string table
+    uint32_t  object;
+    uint32_t  source;
+    uint32_t  first_sweep;
+    uint32_t  sweep_count;
+    uint32_t  reserved;
+  };
+
+  // files are sorted by source, so each distinct source is a contiguous block of files
+  struct catalogue_source
+  {
+    uint32_t  name;
+    uint32_t  first_file;
+    uint32_t  file_count;
+    uint32_t  reserved;
+  };
+
+  struct catalogue_sweep
+  {
+    int64_t   start_time;
+    int64_t   end_time;
+    double    elevation_angle;
+    int64_t   bin_count;
+    int64_t   ray_count;
+    uint32_t  first_quantity;
+    uint32_t  quantity_count;
+  };
+
+  // deduplicating string table used while writing an index
+  class string_table
+  {
+  public:
+    auto add(const std::string& str) -> uint32_t
+    {
+      auto i = offsets_.find(str);
+      if (i != offsets_.end())
+        return i->second;
+      if (data_.size() + str.size() + 1 > std::numeric_limits<uint32_t>::max())
+        throw make_error({}, "catalogue write", nullptr, "string table overflow");
+      auto off = static_cast<uint32_t>(data_.size());
+      data_.insert(data_.end(), str.c_str(), str.c_str() + str.size() + 1);
+      offsets_.emplace(str, off);
+      return off;
+    }
+
+    auto data() const -> const std::vector<char>&
+    {
+      return data_;
+    }
+
+  private:
+    std::vector<char>                         data_;
+    std::unordered_map<std::string, uint32_t> offsets_;
+  };
 }
 
-vertical_profile::vertical_profile(const std::string& path, io_mode mode)
-  : file{path, mode}
+static auto catalogue_align(size_t off) -> size_t
 {
-  if (mode_ == io_mode::create)
-    set_object(object_type::vertical_profile);
-  else if (type_ != object_type::vertical_profile)
-    throw make_error(hnd_, "unexpected object type", "vertical_profile");
+  return (off + 7) & ~size_t(7);
 }
 
-vertical_profile::vertical_profile(file f)
-  : file{std::move(f)}
+static auto catalogue_stat(const std::string& path, int64_t& modified, uint64_t& size) -> bool
 {
-  if (mode_ == io_mode::create)
-    set_object(object_type::vertical_profile);
-  else if (type_ != object_type::vertical_profile)
-    throw make_error(hnd_, "unexpected object type", "vertical_profile");
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return false;
+  modified = st.st_mtime;
+  size = st.st_size;
+  return true;
 }
 
-auto vertical_profile::longitude() const -> double
+auto catalogue::record::contains(const std::string& quantity, double elevation_angle, double tolerance) const -> bool
 {
-  return attributes()["lon"].get_real();
+  for (auto& s : datasets)
+    if (std::abs(s.elevation_angle - elevation_angle) <= tolerance)
+      for (auto& q : s.quantities)
+        if (q == quantity)
+          return true;
+  return false;
 }
 
-auto vertical_profile::set_longitude(double val) -> void
+auto catalogue::scan(const std::string& path) -> record
 {
-  attributes()["lon"].set(val);
+  record ret;
+  if (!catalogue_stat(path, ret.modified, ret.size))
+    throw make_error({}, "catalogue scan", path.c_str(), "file not found");
+
+  open_options options;
+  options.cache_attributes = true;
+  options.metadata_only = true;
+  file f{path, file::io_mode::read_only, options};
+
+  auto& attrs = f.attributes();
+  ret.path = path;
+  ret.object = optional_string(attrs, keys::id::object);
+  ret.source = optional_string(attrs, keys::id::source);
+  ret.date_time = optional_time(attrs, keys::id::date, keys::id::time);
+  ret.latitude = optional_real(attrs, keys::id::lat);
+  ret.longitude = optional_real(attrs, keys::id::lon);
+  ret.height = optional_real(attrs, keys::id::height);
+
+  // quantities come from the structure index so that no layer needs to be opened
+  auto structure = f.structure();
+  ret.datasets.resize(f.dataset_count());
+  for (size_t i = 0; i < ret.datasets.size(); ++i)
+  {
+    auto dset = f.dataset_open(i);
+    auto& dattrs = dset.attributes();
+    auto& s = ret.datasets[i];
+    s.start_time = optional_time(dattrs, keys::id::startdate, keys::id::starttime);
+    s.end_time = optional_time(dattrs, keys::id::enddate, keys::id::endtime);
+    s.elevation_angle = optional_real(dattrs, keys::id::elangle);
+    s.bin_count = std::max(optional_integer(dattrs, keys::id::nbins), 0L);
+    s.ray_count = std::max(optional_integer(dattrs, keys::id::nrays), 0L);
+  }
+  for (auto& l : structure->layers())
+    if (l.quality == structure_index::npos && l.data != structure_index::npos && !l.quantity.empty() && l.dataset < ret.datasets.size())
+      ret.datasets[l.dataset].quantities.push_back(l.quantity);
+
+  return ret;
 }
 
-auto vertical_profile::latitude() const -> double
+auto catalogue::update(const std::string& index_path, const std::vector<std::string>& paths, std::vector<std::string>* failed) -> void
 {
-  return attributes()["lat"].get_real();
+  // load any existing entries
+  std::vector<record> records;
+  std::unordered_map<std::string, size_t> existing;
+  {
+    struct stat st;
+    if (stat(index_path.c_str(), &st) == 0)
+    {
+      catalogue old{index_path};
+      records.reserve(old.size() + paths.size());
+      for (size_t i = 0; i < old.size(); ++i)
+      {
+        records.push_back(old.entry(i));
+        existing.emplace(records.back().path, i);
+      }
+    }
+  }
+
+  // scan new and modified files
+  std::vector<bool> removed(records.size(), false);
+  for (auto& path : paths)
+  {
+    auto i = existing.find(path);
+    int64_t modified;
+    uint64_t size;
+    if (!catalogue_stat(path, modified, size))
+    {
+      if (i != existing.end())
+        removed[i->second] = true;
+      else if (failed)
+        failed->push_back(path);
+      continue;
+    }
+    if (i != existing.end() && records[i->second].modified == modified && records[i->second].size == size)
+      continue;
+
+    try
+    {
+      auto rec = scan(path);
+      if (i != existing.end())
+        records[i->second] = std::move(rec);
+      else
+      {
+        existing.emplace(path, records.size());
+        records.push_back(std::move(rec));
+        removed.push_back(false);
+      }
+    }
+    catch (std::exception&)
+    {
+      if (i != existing.end())
+        removed[i->second] = true;
+      if (failed)
+        failed->push_back(path);
+    }
+  }
+
+  // order the files by source and then time
+  std::vector<size_t> order;
+  order.reserve(records.size());
+  for (size_t i = 0; i < records.size(); ++i)
+    if (!removed[i])
+      order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs)
+  {
+    auto& l = records[lhs];
+    auto& r = records[rhs];
+    if (l.source != r.source)
+      return l.source < r.source;
+    if (l.date_time != r.date_time)
+      return l.date_time < r.date_time;
+    return l.path < r.path;
+  });
+  if (order.size() > std::numeric_limits<uint32_t>::max())
+    throw make_error({}, "catalogue write", index_path.c_str(), "too many files");
+
+  // build the tables
+  string_table strings;
+  std::vector<catalogue_file> files;
+  std::vector<catalogue_source> sources;
+  std::vector<catalogue_sweep> sweeps;
+  std::vector<uint32_t> quantities;
+  std::vector<uint32_t> time_order(order.size());
+  files.reserve(order.size());
+  for (auto idx : order)
+  {
+    auto& rec = records[idx];
+    catalogue_file f;
+    memset(&f, 0, sizeof(f));
+    f.date_time = rec.date_time;
+    f.modified = rec.modified;
+    f.size = rec.size;
+    f.latitude = rec.latitude;
+    f.longitude = rec.longitude;
+    f.height = rec.height;
+    f.path = strings.add(rec.path);
+    f.object = strings.add(rec.object);
+    f.source = strings.add(rec.source);
+    f.first_sweep = sweeps.size();
+    f.sweep_count = rec.datasets.size();
+    for (auto& s : rec.datasets)
+    {
+      catalogue_sweep cs;
+      memset(&cs, 0, sizeof(cs));
+      cs.start_time = s.start_time;
+      cs.end_time = s.end_time;
+      cs.elevation_angle = s.elevation_angle;
+      cs.bin_count = s.bin_count;
+      cs.ray_count = s.ray_count;
+      cs.first_quantity = quantities.size();
+      cs.quantity_count = s.quantities.size();
+      for (auto& q : s.quantities)
+        quantities.push_back(strings.add(q));
+      sweeps.push_back(cs);
+    }
+
+    if (sources.empty() || sources.back().name != f.source)
+      sources.push_back(catalogue_source{f.source, static_cast<uint32_t>(files.size()), 0, 0});
+    ++sources.back().file_count;
+    files.push_back(f);
+  }
+  for (size_t i = 0; i < time_order.size(); ++i)
+    time_order[i] = i;
+  std::stable_sort(time_order.begin(), time_order.end(), [&](uint32_t lhs, uint32_t rhs)
+  {
+    return files[lhs].date_time < files[rhs].date_time;
+  });
+
+  // determine the layout
+  catalogue_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, catalogue_magic, sizeof(hdr.magic));
+  hdr.version = catalogue_version;
+  hdr.byte_order = catalogue_byte_order;
+  hdr.files = files.size();
+  hdr.sources = sources.size();
+  hdr.sweeps = sweeps.size();
+  hdr.quantities = quantities.size();
+  hdr.strings = strings.data().size();
+  hdr.off_files = catalogue_align(sizeof(hdr));
+  hdr.off_sources = catalogue_align(hdr.off_files + files.size() * sizeof(catalogue_file));
+  hdr.off_sweeps = catalogue_align(hdr.off_sources + sources.size() * sizeof(catalogue_source));
+  hdr.off_quantities = catalogue_align(hdr.off_sweeps + sweeps.size() * sizeof(catalogue_sweep));
+  hdr.off_time_order = catalogue_align(hdr.off_quantities + quantities.size() * sizeof(uint32_t));
+  hdr.off_strings = catalogue_align(hdr.off_time_order + time_order.size() * sizeof(uint32_t));
+
+  // write to a uniquely named temporary file in the same directory and atomically replace the index
+#ifdef ODIM_H5_HAVE_MMAP
+  auto tmp = index_path + ".XXXXXX";
+  auto fd = mkstemp(&tmp[0]);
+  if (fd == -1)
+    throw make_error({}, "catalogue write", tmp.c_str(), strerror(errno));
+  // mkstemp creates the file readable by its owner only
+  auto fp = fchmod(fd, 0644) == 0 ? fdopen(fd, "wb") : nullptr;
+  if (!fp)
+  {
+    auto err = errno;
+    close(fd);
+    remove(tmp.c_str());
+    throw make_error({}, "catalogue write", tmp.c_str(), strerror(err));
+  }
+#else
+  auto tmp = index_path + ".tmp";
+  auto fp = fopen(tmp.c_str(), "wb");
+  if (!fp)
+    throw make_error({}, "catalogue write", tmp.c_str(), strerror(errno));
+#endif
+  size_t pos = 0;
+  bool ok = true;
+  auto write = [&](uint64_t off, const void* data, size_t bytes)
+  {
+    static const char zeros[8] = { 0 };
+    ok = ok && fwrite(zeros, 1, off - pos, fp) == off - pos;
+    ok = ok && (bytes == 0 || fwrite(data, 1, bytes, fp) == bytes);
+    pos = off + bytes;
+  };
+  write(0, &hdr, sizeof(hdr));
+  write(hdr.off_files, files.data(), files.size() * sizeof(catalogue_file));
+  write(hdr.off_sources, sources.data(), sources.size() * sizeof(catalogue_source));
+  write(hdr.off_sweeps, sweeps.data(), sweeps.size() * sizeof(catalogue_sweep));
+  write(hdr.off_quantities, quantities.data(), quantities.size() * sizeof(uint32_t));
+  write(hdr.off_time_order, time_order.data(), time_order.size() * sizeof(uint32_t));
+  write(hdr.off_strings, strings.data().data(), strings.data().size());
+  ok = fclose(fp) == 0 && ok;
+  if (!ok)
+  {
+    remove(tmp.c_str());
+    throw make_error({}, "catalogue write", tmp.c_str(), "write failed");
+  }
+  if (rename(tmp.c_str(), index_path.c_str()) != 0)
+  {
+    remove(tmp.c_str());
+    throw make_error({}, "catalogue write", index_path.c_str(), strerror(errno));
+  }
 }
 
-auto vertical_profile::set_latitude(double val) -> void
+catalogue::catalogue() noexcept
+  : base_{nullptr}
+  , size_{0}
+  , mapped_{false}
+{ }
+
+catalogue::catalogue(const std::string& index_path)
+  : catalogue{}
+{
+#ifdef ODIM_H5_HAVE_MMAP
+  auto fd = open(index_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw make_error({}, "catalogue open", index_path.c_str(), strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(catalogue_header)))
+  {
+    close(fd);
+    throw make_error({}, "catalogue open", index_path.c_str(), "not a catalogue");
+  }
+  auto map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    throw make_error({}, "catalogue open", index_path.c_str(), strerror(errno));
+  base_ = static_cast<const unsigned char*>(map);
+  size_ = st.st_size;
+  mapped_ = true;
+#else
+  auto fp = fopen(index_path.c_str(), "rb");
+  if (!fp)
+    throw make_error({}, "catalogue open", index_path.c_str(), strerror(errno));
+  fseek(fp, 0, SEEK_END);
+  auto bytes = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  auto buf = bytes > 0 ? new unsigned char[bytes] : nullptr;
+  if (!buf || fread(buf, 1, bytes, fp) != static_cast<size_t>(bytes))
+  {
+    delete[] buf;
+    fclose(fp);
+    throw make_error({}, "catalogue open", index_path.c_str(), "read failed");
+  }
+  fclose(fp);
+  base_ = buf;
+  size_ = bytes;
+#endif
+
+  // validate the layout so that later accesses need no checks
+  auto& hdr = *reinterpret_cast<const catalogue_header*>(base_);
+  auto fits = [&](uint64_t off, uint64_t count, size_t size)
+  {
+    return off % 8 == 0 && off <= size_ && count <= (size_ - off) / size;
+  };
+  const char* err = nullptr;
+  if (size_ < sizeof(catalogue_header) || memcmp(hdr.magic, catalogue_magic, sizeof(hdr.magic)) != 0)
+    err = "not a catalogue";
+  else if (hdr.version != catalogue_version || hdr.byte_order != catalogue_byte_order)
+    err = "unsupported version or byte order";
+  else if (   !fits(hdr.off_files, hdr.files, sizeof(catalogue_file))
+           || !fits(hdr.off_sources, hdr.sources, sizeof(catalogue_source))
+           || !fits(hdr.off_sweeps, hdr.sweeps, sizeof(catalogue_sweep))
+           || !fits(hdr.off_quantities, hdr.quantities, sizeof(uint32_t))
+           || !fits(hdr.off_time_order, hdr.files, sizeof(uint32_t))
+           || !fits(hdr.off_strings, hdr.strings, 1)
+           || (hdr.strings > 0 && base_[hdr.off_strings + hdr.strings - 1] != '\0'))
+    err = "index is truncated or corrupt";
+  if (err)
+  {
+    release();
+    throw make_error({}, "catalogue open", index_path.c_str(), err);
+  }
+}
+
+catalogue::catalogue(catalogue&& rhs) noexcept
+  : base_{rhs.base_}
+  , size_{rhs.size_}
+  , mapped_{rhs.mapped_}
 {
-  attributes()["lat"].set(val);
+  rhs.base_ = nullptr;
+  rhs.size_ = 0;
 }
 
-auto vertical_profile::height() const -> double
+auto catalogue::operator=(catalogue&& rhs) noexcept -> catalogue&
 {
-  return attributes()["height"].get_real();
+  std::swap(base_, rhs.base_);
+  std::swap(size_, rhs.size_);
+  std::swap(mapped_, rhs.mapped_);
+  return *this;
 }
 
-auto vertical_profile::set_height(double val) -> void
+catalogue::~catalogue()
 {
-  attributes()["height"].set(val);
+  release();
 }
 
-auto vertical_profile::level_count() const -> long
+auto catalogue::release() noexcept -> void
 {
-  return attributes()["levels"].get_integer();
+#ifdef ODIM_H5_HAVE_MMAP
+  if (base_ && mapped_)
+    munmap(const_cast<unsigned char*>(base_), size_);
+#endif
+  if (base_ && !mapped_)
+    delete[] base_;
+  base_ = nullptr;
+  size_ = 0;
 }
 
-auto vertical_profile::set_level_count(long val) -> void
+// helpers to access the tables of an index (only valid after validation)
+static auto catalogue_hdr(const unsigned char* base) -> const catalogue_header&
 {
-  attributes()["levels"].set(val);
+  return *reinterpret_cast<const catalogue_header*>(base);
 }
 
-auto vertical_profile::interval() const -> double
+static auto catalogue_files(const unsigned char* base) -> const catalogue_file*
 {
-  return attributes()["interval"].get_real();
+  return reinterpret_cast<const catalogue_file*>(base + catalogue_hdr(base).off_files);
 }
 
-auto vertical_profile::set_interval(double val) -> void
+static auto catalogue_str(const unsigned char* base, uint32_t off) -> const char*
 {
-  attributes()["interval"].set(val);
+  auto& hdr = catalogue_hdr(base);
+  return off < hdr.strings ? reinterpret_cast<const char*>(base + hdr.off_strings + off) : "";
 }
 
-auto vertical_profile::min_height() const -> double
+auto catalogue::size() const noexcept -> size_t
 {
-  return attributes()["minheight"].get_real();
+  return base_ ? catalogue_hdr(base_).files : 0;
 }
 
-auto vertical_profile::set_min_height(double val) -> void
+auto catalogue::entry(size_t i) const -> record
 {
-  attributes()["minheight"].set(val);
+  if (i >= size())
+    throw std::out_of_range("catalogue entry");
+  auto& hdr = catalogue_hdr(base_);
+  auto& f = catalogue_files(base_)[i];
+  auto sweeps = reinterpret_cast<const catalogue_sweep*>(base_ + hdr.off_sweeps);
+  auto quantities = reinterpret_cast<const uint32_t*>(base_ + hdr.off_quantities);
+
+  record ret;
+  ret.path = catalogue_str(base_, f.path);
+  ret.modified = f.modified;
+  ret.size = f.size;
+  ret.object = catalogue_str(base_, f.object);
+  ret.source = catalogue_str(base_, f.source);
+  ret.date_time = f.date_time;
+  ret.latitude = f.latitude;
+  ret.longitude = f.longitude;
+  ret.height = f.height;
+  if (f.first_sweep <= hdr.sweeps && f.sweep_count <= hdr.sweeps - f.first_sweep)
+  {
+    ret.datasets.resize(f.sweep_count);
+    for (size_t j = 0; j < f.sweep_count; ++j)
+    {
+      auto& cs = sweeps[f.first_sweep + j];
+      auto& s = ret.datasets[j];
+      s.start_time = cs.start_time;
+      s.end_time = cs.end_time;
+      s.elevation_angle = cs.elevation_angle;
+      s.bin_count = cs.bin_count;
+      s.ray_count = cs.ray_count;
+      if (cs.first_quantity <= hdr.quantities && cs.quantity_count <= hdr.quantities - cs.first_quantity)
+        for (size_t k = 0; k < cs.quantity_count; ++k)
+          s.quantities.push_back(catalogue_str(base_, quantities[cs.first_quantity + k]));
+    }
+  }
+  return ret;
 }
 
-auto vertical_profile::max_height() const -> double
+auto catalogue::path(size_t i) const -> const char*
 {
-  return attributes()["maxheight"].get_real();
+  if (i >= size())
+    throw std::out_of_range("catalogue entry");
+  return catalogue_str(base_, catalogue_files(base_)[i].path);
 }
 
-auto vertical_profile::set_max_height(double val) -> void
+auto catalogue::source(size_t i) const -> const char*
 {
-  attributes()["maxheight"].set(val);
+  if (i >= size())
+    throw std::out_of_range("catalogue entry");
+  return catalogue_str(base_, catalogue_files(base_)[i].source);
 }
 
-auto vertical_profile::is_api_attribute(const std::string& name) const -> bool
+auto catalogue::date_time(size_t i) const -> time_t
 {
-  return 
-       name == "lon"
-    || name == "lat"
-    || name == "height"
-    || name == "levels"
-    || name == "interval"
-    || name == "minheight"
-    || name == "maxheight"
-    || file::is_api_attribute(name);
+  if (i >= size())
+    throw std::out_of_range("catalogue entry");
+  return catalogue_files(base_)[i].date_time;
 }
 
-auto profile::start_date() const -> std::string
+auto catalogue::find(time_t from, time_t till) const -> std::vector<size_t>
 {
-  return attributes()["startdate"].get_string();
+  std::vector<size_t> ret;
+  if (!base_)
+    return ret;
+  auto files = catalogue_files(base_);
+  auto order = reinterpret_cast<const uint32_t*>(base_ + catalogue_hdr(base_).off_time_order);
+  auto end = order + size();
+  auto lo = std::lower_bound(order, end, from, [&](uint32_t i, time_t t) { return i < size() && files[i].date_time < t; });
+  for (auto i = lo; i != end && *i < size() && files[*i].date_time < till; ++i)
+    ret.push_back(*i);
+  return ret;
 }
 
-auto profile::set_start_date(const std::string& val) -> void
+// determine whether a source attribute matches either in full or by one of its comma separated identifiers
+static auto source_matches(const char* source, const std::string& query) -> bool
 {
-  attributes()["startdate"].set(val);
+  if (query == source)
+    return true;
+  for (auto beg = source; *beg != '\0'; )
+  {
+    auto end = strchr(beg, ',');
+    auto len = end ? static_cast<size_t>(end - beg) : strlen(beg);
+    if (len == query.size() && strncmp(beg, query.c_str(), len) == 0)
+      return true;
+    if (!end)
+      break;
+    beg = end + 1;
+  }
+  return false;
 }
 
-auto profile::start_time() const -> std::string
+auto catalogue::find(const std::string& source) const -> std::vector<size_t>
 {
-  return attributes()["starttime"].get_string();
+  return find(source, std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max());
 }
 
-auto profile::set_start_time(const std::string& val) -> void
+auto catalogue::find(const std::string& source, time_t from, time_t till) const -> std::vector<size_t>
 {
-  attributes()["starttime"].set(val);
+  std::vector<size_t> ret;
+  if (!base_)
+    return ret;
+  auto& hdr = catalogue_hdr(base_);
+  auto files = catalogue_files(base_);
+  auto sources = reinterpret_cast<const catalogue_source*>(base_ + hdr.off_sources);
+  size_t blocks = 0;
+  for (size_t s = 0; s < hdr.sources; ++s)
+  {
+    auto& src = sources[s];
+    if (src.first_file > hdr.files || src.file_count > hdr.files - src.first_file)
+      continue;
+    if (!source_matches(catalogue_str(base_, src.name), source))
+      continue;
+
+    // files within a source block are ordered by time
+    auto beg = files + src.first_file, end = beg + src.file_count;
+    auto lo = std::lower_bound(beg, end, from, [](const catalogue_file& f, time_t t) { return f.date_time < t; });
+    for (auto i = lo; i != end && i->date_time < till; ++i)
+      ret.push_back(i - files);
+    ++blocks;
+  }
+
+  // merge results from sources which matched by identifier
+  if (blocks > 1)
+    std::stable_sort(ret.begin(), ret.end(), [&](size_t lhs, size_t rhs) { return files[lhs].date_time < files[rhs].date_time; });
+  return ret;
 }
 
-auto profile::start_date_time() const -> time_t
+process_loader::process_loader()
+  : process_loader(settings{})
+{ }
+
+process_loader::process_loader(settings config)
+  : config_(std::move(config))
 {
-  return strings_to_time(attributes()["startdate"].get_string(), attributes()["starttime"].get_string());
+  if (config_.workers == 0)
+    config_.workers = std::max(1u, std::thread::hardware_concurrency());
+  if (config_.slots == 0)
+    config_.slots = 2 * config_.workers;
 }
 
-auto profile::set_start_date_time(time_t val) -> void
+#ifdef ODIM_H5_HAVE_PROCESS_LOADER
+namespace
 {
-  char date[9], time[7];
-  time_to_strings(val, date, time);
-  attributes()["startdate"].set(date);
-  attributes()["starttime"].set(time);
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "process loader requires lock free atomics");
+
+  constexpr size_t loader_max_layers = 256;
+  constexpr size_t loader_npos = static_cast<size_t>(-1);
+
+  // slot states other than these hold the index of the owning worker plus one
+  constexpr int loader_slot_free = 0;
+  constexpr int loader_slot_ready = -1;
+
+  // worker phases, a worker which terminates abnormally owns whatever slot state holds its index
+  enum loader_phase : int
+  {
+      loader_idle     // finished, or between files
+    , loader_waiting  // looking for a free slot
+    , loader_decoding // holding a slot
+  };
+
+  /* The slot states are the only record of which slots are free.  The free slot semaphore merely wakes
+   * workers when a slot may have become free, and they wait on it with a timeout, so a count lost with a
+   * terminated worker can never leave the others blocked. */
+  constexpr long loader_poll_nsec = 50000000;
+
+  struct loader_control
+  {
+    sem_t                 free_slots;
+    sem_t                 ready;
+    std::atomic<uint64_t> next;
+  };
+
+  struct loader_worker
+  {
+    std::atomic<int>      phase;
+    std::atomic<uint64_t> file;
+  };
+
+  struct loader_layer
+  {
+    uint32_t  dataset;
+    uint32_t  index;
+    char      quantity[32];
+    uint64_t  rows;
+    uint64_t  cols;
+    uint64_t  offset;   // byte offset of values from the start of the slot
+  };
+
+  struct loader_slot
+  {
+    uint64_t      file;
+    uint32_t      layers;
+    uint32_t      failed;
+    char          error[256];
+    loader_layer  layer[loader_max_layers];
+  };
+
+  // the complete shared memory region used by a load
+  class loader_region
+  {
+  public:
+    loader_region(size_t workers, size_t slots, size_t slot_bytes)
+      : workers_{workers}
+      , slots_{slots}
+    {
+      auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      slot_bytes_ = (std::max(slot_bytes, sizeof(loader_slot) + 64) + page - 1) / page * page;
+      auto header = sizeof(loader_control) + workers * sizeof(loader_worker) + slots * sizeof(std::atomic<int>);
+      header_bytes_ = (header + page - 1) / page * page;
+      size_ = header_bytes_ + slots * slot_bytes_;
+      auto map = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if (map == MAP_FAILED)
+        throw make_error({}, "process loader", "shared memory", strerror(errno));
+      base_ = static_cast<unsigned char*>(map);
+
+      // mapping is zero filled so the atomics begin as zero (i.e. free and idle)
+      if (   sem_init(&control().free_slots, 1, slots) != 0
+          || sem_init(&control().ready, 1, 0) != 0)
+      {
+        munmap(base_, size_);
+        throw make_error({}, "process loader", "semaphore", strerror(errno));
+      }
+    }
+
+    loader_region(const loader_region&) = delete;
+    auto operator=(const loader_region&) -> loader_region& = delete;
+
+    ~loader_region()
+    {
+      sem_destroy(&control().free_slots);
+      sem_destroy(&control().ready);
+      munmap(base_, size_);
+    }
+
+    auto control() -> loader_control&
+    {
+      return *reinterpret_cast<loader_control*>(base_);
+    }
+
+    auto worker(size_t i) -> loader_worker&
+    {
+      return reinterpret_cast<loader_worker*>(base_ + sizeof(loader_control))[i];
+    }
+
+    auto state(size_t i) -> std::atomic<int>&
+    {
+      return reinterpret_cast<std::atomic<int>*>(base_ + sizeof(loader_control) + workers_ * sizeof(loader_worker))[i];
+    }
+
+    auto slot(size_t i) -> loader_slot&
+    {
+      return *reinterpret_cast<loader_slot*>(base_ + header_bytes_ + i * slot_bytes_);
+    }
+
+    auto slot_data(size_t i) -> unsigned char*
+    {
+      return base_ + header_bytes_ + i * slot_bytes_;
+    }
+
+    auto workers() const -> size_t    { return workers_; }
+    auto slots() const -> size_t      { return slots_; }
+    auto slot_bytes() const -> size_t { return slot_bytes_; }
+
+  private:
+    unsigned char*  base_;
+    size_t          size_;
+    size_t          header_bytes_;
+    size_t          workers_;
+    size_t          slots_;
+    size_t          slot_bytes_;
+  };
 }
 
-auto profile::end_date() const -> std::string
+static auto loader_fail(loader_slot& slot, const char* what) -> void
 {
-  return attributes()["enddate"].get_string();
+  slot.layers = 0;
+  slot.failed = 1;
+  strncpy(slot.error, what, sizeof(slot.error) - 1);
+  slot.error[sizeof(slot.error) - 1] = '\0';
 }
 
-auto profile::set_end_date(const std::string& val) -> void
+// decode every selected layer of a file into a slot
+static auto loader_decode(
+      loader_region& region
+    , size_t s
+    , const std::string& path
+    , const process_loader::settings& config
+    ) -> void
 {
-  attributes()["enddate"].set(val);
+  auto& slot = region.slot(s);
+  auto data = region.slot_data(s);
+  size_t offset = (sizeof(loader_slot) + 63) & ~size_t(63);
+  slot.layers = 0;
+  slot.failed = 0;
+
+  file f{path, file::io_mode::read_only};
+  for (size_t i = 0; i < f.dataset_count(); ++i)
+  {
+    auto dset = f.dataset_open(i);
+    for (size_t j = 0; j < dset.data_count(); ++j)
+    {
+      auto layer = dset.data_open(j);
+      auto quantity = optional_string(layer.attributes(), keys::id::quantity);
+      if (   !config.quantities.empty()
+          && std::find(config.quantities.begin(), config.quantities.end(), quantity) == config.quantities.end())
+        continue;
+
+      if (slot.layers == loader_max_layers)
+        throw make_error({}, "process loader", path.c_str(), "too many layers for result slot");
+      size_t dims[data::max_rank];
+      auto rank = layer.dims(dims);
+      auto count = layer.size();
+      if (offset + count * sizeof(float) > region.slot_bytes())
+        throw make_error({}, "process loader", path.c_str(), "decoded file exceeds slot size");
+
+      layer.read_unpack(reinterpret_cast<float*>(data + offset), config.undetect, config.nodata);
+
+      auto& desc = slot.layer[slot.layers++];
+      desc.dataset = i;
+      desc.index = j;
+      strncpy(desc.quantity, quantity.c_str(), sizeof(desc.quantity) - 1);
+      desc.quantity[sizeof(desc.quantity) - 1] = '\0';
+      desc.rows = rank > 0 ? dims[0] : 0;
+      desc.cols = rank > 1 ? dims[1] : 1;
+      desc.offset = offset;
+      offset = (offset + count * sizeof(float) + 63) & ~size_t(63);
+    }
+  }
 }
 
-auto profile::end_time() const -> std::string
+// wait on a semaphore for at most the given time
+static auto loader_timed_wait(sem_t* sem, long nsec) -> void
 {
-  return attributes()["endtime"].get_string();
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += nsec;
+  if (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_sec += 1;
+    ts.tv_nsec -= 1000000000;
+  }
+  sem_timedwait(sem, &ts);
 }
 
-auto profile::set_end_time(const std::string& val) -> void
+// claim any free slot for a worker
+static auto loader_claim(loader_region& region, size_t w, size_t& slot) -> bool
 {
-  attributes()["endtime"].set(val);
+  for (size_t s = 0; s < region.slots(); ++s)
+  {
+    int expected = loader_slot_free;
+    if (region.state(s).compare_exchange_strong(expected, static_cast<int>(w + 1)))
+    {
+      slot = s;
+      return true;
+    }
+  }
+  return false;
 }
 
-auto profile::end_date_time() const -> time_t
+// main loop of a worker process
+static auto loader_work(
+      loader_region& region
+    , size_t w
+    , const std::vector<std::string>& paths
+    , const process_loader::settings& config
+    ) -> void
 {
-  return strings_to_time(attributes()["enddate"].get_string(), attributes()["endtime"].get_string());
+  auto& ctl = region.control();
+  auto& status = region.worker(w);
+  while (true)
+  {
+    // take a slot before the file so that a claimed file is always recoverable through the slot
+    status.phase = loader_waiting;
+    size_t s;
+    while (!loader_claim(region, w, s))
+      loader_timed_wait(&ctl.free_slots, loader_poll_nsec);
+
+    auto file = ctl.next.fetch_add(1);
+    if (file >= paths.size())
+    {
+      region.state(s) = loader_slot_free;
+      status.phase = loader_idle;
+      sem_post(&ctl.free_slots);
+      return;
+    }
+    status.file = file;
+    status.phase = loader_decoding;
+
+    auto& slot = region.slot(s);
+    slot.file = file;
+    try
+    {
+      loader_decode(region, s, paths[file], config);
+    }
+    catch (std::exception& err)
+    {
+      loader_fail(slot, err.what());
+    }
+    catch (...)
+    {
+      loader_fail(slot, "unknown error");
+    }
+
+    region.state(s) = loader_slot_ready;
+    status.phase = loader_idle;
+    status.file = loader_npos;
+    sem_post(&ctl.ready);
+  }
 }
 
-auto profile::set_end_date_time(time_t val) -> void
+// count the threads of the calling process (or return 0 if they can't be determined)
+static auto loader_thread_count() -> size_t
 {
-  char date[9], time[7];
-  time_to_strings(val, date, time);
-  attributes()["enddate"].set(date);
-  attributes()["endtime"].set(time);
+  auto dir = opendir("/proc/self/task");
+  if (!dir)
+    return 0;
+  size_t count = 0;
+  while (auto ent = readdir(dir))
+    if (ent->d_name[0] != '.')
+      ++count;
+  closedir(dir);
+  return count;
 }
 
-auto profile::is_api_attribute(const std::string& name) const -> bool
+static auto loader_spawn(
+      loader_region& region
+    , size_t w
+    , const std::vector<std::string>& paths
+    , const process_loader::settings& config
+    ) -> pid_t
 {
-  return 
-       name == "startdate"
-    || name == "starttime"
-    || name == "enddate"
-    || name == "endtime"
-    || dataset::is_api_attribute(name);
+  auto& status = region.worker(w);
+  status.phase = loader_idle;
+  status.file = loader_npos;
+
+  auto pid = fork();
+  if (pid < 0)
+    throw make_error({}, "process loader", "fork", strerror(errno));
+  if (pid == 0)
+  {
+    // never return into the caller or run exit handlers, which would close files shared with the parent
+    try
+    {
+      loader_work(region, w, paths, config);
+    }
+    catch (...)
+    {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  return pid;
 }
 
+auto process_loader::load(const std::vector<std::string>& paths, const std::function<void(const result&)>& consume) -> void
+{
+  if (paths.empty())
+    return;
+
+  /* a forked child only contains the thread which called fork(), so any lock held by another thread at
+   * that moment (ours, HDF5's or the worker pool's) would never be released in the child */
+  // threads kept by the library after earlier parallel or asynchronous calls are idle once every other
+  // thread has gone, so stop them before checking again
+  if (loader_thread_count() > 1 + worker_pool().running() + io_executor::instance().thread_count())
+    throw make_error({}, "process loader", nullptr, "calling process must be single threaded");
+  release_threads();
+  if (loader_thread_count() > 1)
+    throw make_error({}, "process loader", nullptr, "calling process must be single threaded");
+
+  auto workers = std::min(config_.workers, paths.size());
+  loader_region region{workers, config_.slots, config_.slot_bytes};
+  std::vector<pid_t> pids(workers, -1);
+  std::vector<bool> delivered(paths.size(), false);
+  size_t remaining = paths.size();
+
+  // ensure no worker outlives this call, even when the callback throws
+  struct reaper
+  {
+    std::vector<pid_t>& pids;
+    ~reaper()
+    {
+      for (auto pid : pids)
+        if (pid > 0)
+          kill(pid, SIGKILL);
+      for (auto pid : pids)
+        if (pid > 0)
+          waitpid(pid, nullptr, 0);
+    }
+  } reap{pids};
+
+  for (size_t w = 0; w < workers; ++w)
+    pids[w] = loader_spawn(region, w, paths, config_);
+
+  auto deliver_failure = [&](size_t file, const char* what)
+  {
+    if (file >= paths.size() || delivered[file])
+      return;
+    delivered[file] = true;
+    --remaining;
+    consume(result{file, paths[file].c_str(), what, {}});
+  };
+
+  auto& ctl = region.control();
+  result res;
+  while (remaining > 0)
+  {
+    // wake periodically so that terminated workers are noticed
+    loader_timed_wait(&ctl.ready, loader_poll_nsec);
+
+    // hand completed slots to the callback and return them to the workers
+    for (size_t s = 0; s < region.slots(); ++s)
+    {
+      if (region.state(s) != loader_slot_ready)
+        continue;
+      auto& slot = region.slot(s);
+      if (slot.file < paths.size() && !delivered[slot.file])
+      {
+        res.index = slot.file;
+        res.path = paths[slot.file].c_str();
+        res.error = slot.failed ? slot.error : nullptr;
+        res.layers.clear();
+        for (size_t l = 0; l < slot.layers; ++l)
+        {
+          auto& desc = slot.layer[l];
+          res.layers.push_back(layer{
+                desc.dataset
+              , desc.index
+              , desc.quantity
+              , desc.rows
+              , desc.cols
+              , reinterpret_cast<const float*>(region.slot_data(s) + desc.offset)});
+        }
+        delivered[slot.file] = true;
+        --remaining;
+        consume(res);
+      }
+      region.state(s) = loader_slot_free;
+      sem_post(&ctl.free_slots);
+    }
+
+    // recover from workers which have terminated, only our own workers are waited on so that the exit
+    // status of other children of the host process is left for their owners
+    size_t running = 0;
+    for (size_t w = 0; w < pids.size(); ++w)
+    {
+      int status;
+      if (pids[w] <= 0 || waitpid(pids[w], &status, WNOHANG) != pids[w])
+        continue;
+      pids[w] = -1;
+
+      auto& worker = region.worker(w);
+      auto clean = WIFEXITED(status) && WEXITSTATUS(status) == 0 && worker.phase == loader_idle;
+      if (!clean)
+      {
+        // the claim of a slot is recorded by the same compare and exchange that takes it
+        auto owner = static_cast<int>(w + 1);
+        auto held = region.slots();
+        for (size_t s = 0; s < region.slots(); ++s)
+          if (region.state(s) == owner)
+            held = s;
+
+        // a worker only claims a file while holding a slot, so publishing a failure through the slot (which
+        // also returns it) covers every file the worker may have claimed
+        if (held != region.slots())
+        {
+          auto& slot = region.slot(held);
+          slot.file = worker.file.load();
+          loader_fail(slot, "worker process terminated while decoding file");
+          region.state(held) = loader_slot_ready;
+          sem_post(&ctl.ready);
+        }
+        if (ctl.next < paths.size())
+          pids[w] = loader_spawn(region, w, paths, config_);
+      }
+    }
+    for (auto p : pids)
+      running += p > 0;
+
+    // catch any file lost by a worker which terminated between claiming it and recording the claim
+    if (running == 0 && remaining > 0)
+    {
+      bool ready = false;
+      for (size_t s = 0; s < region.slots(); ++s)
+        ready = ready || region.state(s) == loader_slot_ready;
+      if (!ready)
+        for (size_t i = 0; i < paths.size(); ++i)
+          deliver_failure(i, "worker process terminated before decoding file");
+    }
+  }
+}
+#else
+auto process_loader::load(const std::vector<std::string>& paths, const std::function<void(const result&)>& consume) -> void
+{
+  throw make_error({}, "process loader", nullptr, "not supported on this platform");
+}
+#endif
@@ -18,13 +18,26 @@
 #ifndef ODIM_H5_H
 #define ODIM_H5_H
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+// awaitable futures are provided when compiled as C++20 with coroutine support
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define ODIM_H5_HAVE_COROUTINES
+#endif
+#endif
+
 namespace odim_h5
 {
   /// Get the SCM release tag that the library was built from
@@ -33,6 +46,37 @@ namespace odim_h5
   /// Get the default ODIM_H5 conventions version used
   auto default_odim_version() -> std::pair<int, int>;
 
+  /// Enable or disable thread safe mode
+  /**
+   * By default the library provides no thread safety of its own.  Separate files may only be used from
+   * separate threads if the HDF5 library was built with its threadsafe option, and objects must never be
+   * shared between threads.
+   *
+   * In thread safe mode every call into the HDF5 library is serialised behind a single library wide
+   * lock, so objects belonging to the same or different files may be used concurrently from different
+   * threads regardless of how HDF5 was built.  A single object must still not be used by more than one
+   * thread at a time.  Unpacking, packing, chunk compression and error formatting run outside of the
+   * lock, so threads overlap except while HDF5 itself is busy.
+   *
+   * Thread safe mode should be set before any objects are shared between threads.
+   */
+  auto set_thread_safe(bool enable) -> void;
+
+  /// Determine whether thread safe mode is enabled
+  auto thread_safe() -> bool;
+
+  /// Stop the threads owned by the library once their outstanding work is complete
+  /**
+   * The worker pool used by the parallel read and write functions and the threads of the io_executor
+   * are started on first use and are otherwise kept for the life of the process.  This function waits
+   * for any queued work to finish and then joins those threads.  They are started again as needed by
+   * later calls.  The threads of sweep_reader and volume_writer objects are owned by those objects and
+   * are not affected.
+   *
+   * This must not be called while other threads are using the library.
+   */
+  auto release_threads() -> void;
+
   // Internal - RAII object for managing an HDF5 API hid_t
   struct handle
   {
@@ -41,7 +85,7 @@ namespace odim_h5
     id_t id;
 
     handle() noexcept : id{-1} { }
-    handle(id_t id) noexcept : id{id} { }
+    explicit handle(id_t id) noexcept : id{id} { }
     handle(const handle& rhs);
     handle(handle&& rhs) noexcept : id(rhs.id) { rhs.id = -1; }
     auto operator=(const handle& rhs) -> handle&;
@@ -64,12 +108,366 @@ namespace odim_h5
     error(const char* what);
   };
 
+  /// Options which control how a file and the objects within it are accessed
+  struct open_options
+  {
+    /// Read every attribute value when a group is opened and serve later reads from memory
+    /**
+     * Values written through the library update the cache as they are written.  Changes made to the
+     * file by other means while it is open will not be seen.
+     */
+    bool cache_attributes = false;
+
+    /// Maximum number of HDF5 ids held by the cache of opened dataset and data objects (0 disables the cache)
+    /**
+     * When enabled, opening the same dataset or data layer again returns a copy of the cached object
+     * instead of reopening its groups and attributes.  Objects are evicted in least recently used order
+     * once the limit is exceeded.  A data layer typically holds five ids and a dataset four.  The cache is
+     * only used for files opened read only.
+     */
+    size_t object_cache_ids = 0;
+
+    /// Never open the 'data' dataset of a layer
+    /**
+     * Intended for metadata scanning.  Layers may be opened and their attributes used, however any
+     * function which reads, writes or describes the values of a layer will fail.  The structure_index of
+     * a file opened this way does not record layer dimensions.
+     */
+    bool metadata_only = false;
+  };
+
+  /// Counters describing the effectiveness of the open object cache
+  struct cache_statistics
+  {
+    size_t hits;        ///< Number of opens served from the cache
+    size_t misses;      ///< Number of opens which had to open the object
+    size_t evictions;   ///< Number of objects evicted to honour the id limit
+    size_t objects;     ///< Number of objects currently cached
+    size_t open_ids;    ///< Number of HDF5 ids currently held by the cache
+  };
+
+  /// Alignment of buffers allocated by the library for use with SIMD instructions
+  constexpr size_t simd_alignment = 64;
+
+  /// Source of memory for buffers allocated by the library (modelled on std::pmr::memory_resource)
+  class memory_resource
+  {
+  public:
+    virtual ~memory_resource() = default;
+
+    /// Allocate memory, throwing std::bad_alloc on failure
+    auto allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) -> void*
+    {
+      return do_allocate(bytes, alignment);
+    }
+
+    /// Return memory obtained from allocate()
+    auto deallocate(void* ptr, size_t bytes, size_t alignment = alignof(std::max_align_t)) -> void
+    {
+      do_deallocate(ptr, bytes, alignment);
+    }
+
+  protected:
+    virtual auto do_allocate(size_t bytes, size_t alignment) -> void* = 0;
+    virtual auto do_deallocate(void* ptr, size_t bytes, size_t alignment) -> void = 0;
+  };
+
+  /// Get the memory resource which allocates from the heap
+  auto heap_resource() -> memory_resource&;
+
+  /// Memory resource which allocates sequentially from large blocks and releases everything at once
+  /**
+   * Every allocation is aligned to at least simd_alignment.  Deallocation does nothing; instead all memory
+   * is reclaimed for reuse by reset().  If more than one block was needed since the previous reset, the
+   * blocks are replaced by a single block large enough for all of them.  An arena which is reset and
+   * reused for similar work (such as decoding one volume after another) therefore stops allocating from
+   * its upstream resource once it has warmed up.
+   */
+  class decode_arena : public memory_resource
+  {
+  public:
+    /// Create an arena, optionally reserving an initial block
+    decode_arena(size_t initial_size = 0, memory_resource& upstream = heap_resource());
+
+    decode_arena(const decode_arena& rhs) = delete;
+    auto operator=(const decode_arena& rhs) -> decode_arena& = delete;
+
+    ~decode_arena();
+
+    /// Reclaim every allocation for reuse
+    auto reset() -> void;
+
+    /// Get the number of bytes allocated since the last reset
+    auto used() const -> size_t                                 { return used_; }
+    /// Get the number of bytes held by the arena
+    auto capacity() const -> size_t;
+    /// Get the number of blocks obtained from the upstream resource since construction
+    auto upstream_allocations() const -> size_t                 { return upstream_allocations_; }
+
+  protected:
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override;
+    auto do_deallocate(void* ptr, size_t bytes, size_t alignment) -> void override;
+
+  private:
+    struct block
+    {
+      unsigned char*  base;
+      size_t          size;
+    };
+
+  private:
+    auto add_block(size_t size) -> void;
+    auto release() noexcept -> void;
+
+  private:
+    memory_resource*    upstream_;
+    std::vector<block>  blocks_;
+    size_t              offset_;                // next free byte in the last block
+    size_t              used_;
+    size_t              upstream_allocations_;
+  };
+
+  /// Standard allocator which obtains memory from a memory_resource (e.g. to back a std::vector with an arena)
+  template <typename T>
+  class resource_allocator
+  {
+  public:
+    typedef T value_type;
+
+    resource_allocator(memory_resource& mem) noexcept : mem_{&mem} { }
+    template <typename U>
+    resource_allocator(const resource_allocator<U>& rhs) noexcept : mem_{rhs.resource()} { }
+
+    auto allocate(size_t n) -> T*               { return static_cast<T*>(mem_->allocate(n * sizeof(T), alignof(T))); }
+    auto deallocate(T* ptr, size_t n) -> void   { mem_->deallocate(ptr, n * sizeof(T), alignof(T)); }
+
+    auto resource() const noexcept -> memory_resource*        { return mem_; }
+
+  private:
+    memory_resource* mem_;
+  };
+
+  template <typename T, typename U>
+  inline auto operator==(const resource_allocator<T>& lhs, const resource_allocator<U>& rhs) noexcept -> bool
+  {
+    return lhs.resource() == rhs.resource();
+  }
+
+  template <typename T, typename U>
+  inline auto operator!=(const resource_allocator<T>& lhs, const resource_allocator<U>& rhs) noexcept -> bool
+  {
+    return lhs.resource() != rhs.resource();
+  }
+
+  /// Values allocated from a memory_resource
+  /**
+   * The view does not own its memory.  It must be returned to the resource it was allocated from using
+   * deallocate(size * sizeof(T), simd_alignment), or reclaimed by resetting an arena.
+   */
+  template <typename T>
+  struct buffer_view
+  {
+    T*      data;   ///< First value
+    size_t  size;   ///< Number of values
+
+    auto begin() const -> T*                                    { return data; }
+    auto end() const -> T*                                      { return data + size; }
+    auto operator[](size_t i) const -> T&                       { return data[i]; }
+  };
+
+  /// Queue depth and latency metrics of the I/O executor
+  struct io_statistics
+  {
+    size_t    queued;         ///< Number of tasks currently waiting to run
+    size_t    peak_queued;    ///< Largest number of tasks ever waiting at once
+    uint64_t  submitted;      ///< Number of tasks submitted
+    uint64_t  completed;      ///< Number of tasks which have finished running
+    double    mean_wait;      ///< Mean time in seconds tasks spent queued before running
+    double    max_wait;       ///< Longest time in seconds a task spent queued before running
+    double    mean_run;       ///< Mean time in seconds tasks spent running
+  };
+
+  // Internal - notification of task completion used to resume awaiting coroutines
+  struct io_continuation;
+
+  /// Future for the result of an asynchronous operation
+  /**
+   * When compiled with C++20 coroutine support the future may also be co_await'ed.  The awaiting
+   * coroutine is resumed on a completion thread owned by the I/O executor once the operation completes,
+   * so it should hand any lengthy work elsewhere to avoid delaying other resumptions.
+   */
+  template <typename T>
+  class io_future : public std::future<T>
+  {
+  public:
+    io_future(std::future<T> future, std::shared_ptr<io_continuation> cont)
+      : std::future<T>(std::move(future))
+      , cont_(std::move(cont))
+    { }
+
+#ifdef ODIM_H5_HAVE_COROUTINES
+    auto await_ready() const -> bool;
+    auto await_suspend(std::coroutine_handle<> waiter) -> bool;
+    auto await_resume() -> T                                    { return this->get(); }
+#endif
+
+  private:
+    std::shared_ptr<io_continuation> cont_;
+  };
+
+  /// Library owned executor which runs asynchronous operations on a dedicated I/O thread
+  /**
+   * Tasks run one at a time in submission order, so asynchronous operations never contend with each
+   * other for the HDF5 library.  Since the caller will typically go on to use the resulting objects from
+   * its own threads, thread safe mode must be enabled (see set_thread_safe()) before submitting tasks.
+   */
+  class io_executor
+  {
+  public:
+    /// Get the library executor
+    static auto instance() -> io_executor&;
+
+    io_executor(const io_executor&) = delete;
+    auto operator=(const io_executor&) -> io_executor& = delete;
+
+    /// Run a function on the I/O thread
+    template <typename F>
+    auto submit(F fn) -> io_future<decltype(fn())>;
+
+    /// Get the number of tasks currently waiting to run
+    auto queue_depth() const -> size_t;
+
+    /// Get queue depth and latency metrics
+    auto statistics() const -> io_statistics;
+
+    /// Get the number of threads currently started by the executor
+    auto thread_count() const -> size_t;
+
+  private:
+    struct state;
+
+  private:
+    io_executor();
+    ~io_executor();
+
+    auto start() -> void;
+    auto release() -> void;
+    auto post(std::function<void()> task) -> std::shared_ptr<io_continuation>;
+
+    static auto suspend(const std::shared_ptr<io_continuation>& cont, void (*resume)(void*), void* arg) -> bool;
+
+  private:
+    std::unique_ptr<state> state_;
+
+    template <typename T>
+    friend class io_future;
+    friend auto release_threads() -> void;
+  };
+
+  template <typename F>
+  auto io_executor::submit(F fn) -> io_future<decltype(fn())>
+  {
+    // std::function requires a copyable target so the task is shared
+    auto task = std::make_shared<std::packaged_task<decltype(fn())()>>(std::move(fn));
+    auto future = task->get_future();
+    auto cont = post([task]{ (*task)(); });
+    return {std::move(future), std::move(cont)};
+  }
+
+#ifdef ODIM_H5_HAVE_COROUTINES
+  template <typename T>
+  auto io_future<T>::await_ready() const -> bool
+  {
+    return this->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  template <typename T>
+  auto io_future<T>::await_suspend(std::coroutine_handle<> waiter) -> bool
+  {
+    auto resume = [](void* address) { std::coroutine_handle<>::from_address(address).resume(); };
+    return io_executor::suspend(cont_, resume, waiter.address());
+  }
+#endif
+
+  /// Summary of the groups and layers within a file gathered by a single traversal
+  /**
+   * The index is built when a file is opened read only and is shared by every object opened through the
+   * file, which use it to determine their child counts without probing for each group.  Files opened for
+   * writing do not keep an index, however a snapshot of their current state may be requested through
+   * file::structure().
+   *
+   * All indices are zero based to match the object API (i.e. 'dataset1' is dataset 0).
+   */
+  class structure_index
+  {
+  public:
+    /// Value used to indicate an absent index
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /// Description of a single dataX or qualityX layer
+    struct layer
+    {
+      size_t              dataset;    ///< Index of the parent datasetX group
+      size_t              data;       ///< Index of the dataX layer, or parent dataX of a quality layer (npos if none)
+      size_t              quality;    ///< Index of the qualityX layer (npos for data layers)
+      std::string         quantity;   ///< Value of the 'quantity' attribute (empty if missing)
+      std::vector<size_t> dims;       ///< Dimensions of the layer (empty if the layer has no 'data' dataset)
+    };
+
+  public:
+    /// Get the number of datasetX groups
+    auto dataset_count() const -> size_t                        { return datasets_; }
+    /// Get the number of dataX layers in a dataset
+    auto data_count(size_t dataset) const -> size_t;
+    /// Get the number of qualityX layers in a dataset, or in a dataX layer of the dataset
+    auto quality_count(size_t dataset, size_t data = npos) const -> size_t;
+
+    /// Get all layers ordered by dataset, data and quality index
+    auto layers() const -> const std::vector<layer>&            { return layers_; }
+    /// Get a layer by position (returns nullptr if not present)
+    auto find(size_t dataset, size_t data, size_t quality = npos) const -> const layer*;
+    /// Get all dataX layers of a quantity ordered by dataset (e.g. all DBZH layers by sweep)
+    auto find(const std::string& quantity) const -> std::vector<const layer*>;
+
+  private:
+    structure_index(const handle& hnd, bool dims);
+
+    struct node
+    {
+      size_t data_count;
+      size_t quality_count;
+    };
+
+    auto counts(const std::string& path) const -> const node*;
+
+  private:
+    size_t                                  datasets_;
+    std::vector<layer>                      layers_;
+    std::unordered_map<std::string, node>   nodes_;     // child counts of each group by path
+
+    friend class dataset;
+    friend class data;
+    friend class file;
+  };
+
+  class object_cache;
+
+  // Internal - state shared by a file and every object opened through it
+  struct file_state
+  {
+    file_state(const open_options& options) : options(options) { }
+
+    open_options                            options;
+    std::shared_ptr<const structure_index>  structure;
+    std::shared_ptr<object_cache>           cache;
+  };
+
   /// Attribute handle
   class attribute
   {
   public:
     /// Attribute data types
-    enum class data_type
+    enum class data_type : uint8_t
     {
         uninitialized     ///< New attribute which has not been set yet
       , unknown           ///< Unknown data type
@@ -83,7 +481,7 @@ namespace odim_h5
 
   public:
     /// Get attribute name
-    auto name() const -> const std::string&                     { return name_; }
+    auto name() const -> const std::string&                     { return *name_; }
 
     /// Get data type of attribute
     auto type() const -> data_type;
@@ -101,6 +499,13 @@ namespace odim_h5
     /// Get the attribute as a vector of doubles
     auto get_real_array() const -> std::vector<double>;
 
+    /// Get the number of elements of an array attribute (1 for other types)
+    auto array_size() const -> size_t;
+    /// Get the attribute as longs written to a caller supplied buffer of array_size() elements
+    auto get_integer_array(long* val) const -> void;
+    /// Get the attribute as doubles written to a caller supplied buffer of array_size() elements
+    auto get_real_array(double* val) const -> void;
+
     /// Set the attribute
     auto set(bool val) -> void;
     /// Set the attribute
@@ -116,23 +521,210 @@ namespace odim_h5
     /// Set the attribute
     auto set(const std::vector<double>& val) -> void;
 
+    /// Get the attribute as T (one of bool, long, double, std::string, std::vector<long> or std::vector<double>)
+    template <typename T>
+    auto get() const -> T;
+
   private:
-    attribute(const handle* parent, std::string name, bool existing);
+    attribute(handle::id_t parent, const char* name, bool existing, bool cache = false);
     auto open(handle* type_out = nullptr) const -> handle;
     auto open_or_create(data_type type, size_t size, handle* type_out = nullptr) -> handle;
+    auto load() const -> void;
 
   private:
-    const handle*     parent_;
-    std::string       name_;
-    mutable data_type type_;
-    mutable size_t    size_;      // number of elements in array or characters in string
+    union scalar
+    {
+      long    integer;
+      double  real;
+    };
+
+  /* Members are ordered so that an attribute occupies a single 64 byte cache line on LP64 targets.  The
+   * parent group is held as a plain id owned by the attribute_store, and the name points into a table of
+   * interned names.  Strings short enough for the small string buffer of blob_ are cached inline. */
+  private:
+    handle::id_t        parent_;    // group containing the attribute (not owned)
+    const std::string*  name_;      // interned name
+    mutable uint32_t    size_;      // number of elements in array or characters in string
+    mutable data_type   type_;
+    bool                cache_;     // values are cached for this attribute
+    mutable bool        cached_;    // cached value is valid
+    mutable scalar      scalar_;    // cached integer or real value
+    mutable std::string blob_;      // cached string or raw array elements
 
     friend class attribute_store;
     friend class data;
     friend class file;
+    friend class structure_index;
   };
 
+  /// Get the attribute as a bool
+  template <>
+  inline auto attribute::get<bool>() const -> bool                                { return get_boolean(); }
+  /// Get the attribute as a long
+  template <>
+  inline auto attribute::get<long>() const -> long                                { return get_integer(); }
+  /// Get the attribute as a double
+  template <>
+  inline auto attribute::get<double>() const -> double                            { return get_real(); }
+  /// Get the attribute as a string
+  template <>
+  inline auto attribute::get<std::string>() const -> std::string                  { return get_string(); }
+  /// Get the attribute as a vector of longs
+  template <>
+  inline auto attribute::get<std::vector<long>>() const -> std::vector<long>      { return get_integer_array(); }
+  /// Get the attribute as a vector of doubles
+  template <>
+  inline auto attribute::get<std::vector<double>>() const -> std::vector<double>  { return get_real_array(); }
+
+  /// Catalogue of the standard ODIM_H5 'what' and 'where' attributes
+  /**
+   * Catalogued attributes are located by a fixed slot in the attribute_store rather than by a string
+   * comparison.  Each attribute is also described by a key type which records its value type so that
+   * it can be used with the attribute_store::get and attribute_store::set templates.  For example:
+   *
+   *   long bins = scan.attributes().get<keys::nbins>();
+   *
+   * The 'prodpar' attribute may be either a real or a string depending on the product, so it has an
+   * identifier but no typed key.
+   */
+  namespace keys
+  {
+    /// Catalogue identifiers (these MUST remain in ASCII sorted order of the attribute names)
+    enum class id : uint8_t
+    {
+        LL_lat
+      , LL_lon
+      , LR_lat
+      , LR_lon
+      , UL_lat
+      , UL_lon
+      , UR_lat
+      , UR_lon
+      , a1gate
+      , angles
+      , az_angle
+      , date
+      , elangle
+      , enddate
+      , endtime
+      , gain
+      , height
+      , interval
+      , lat
+      , levels
+      , lon
+      , maxheight
+      , minheight
+      , nbins
+      , nodata
+      , nrays
+      , object
+      , offset
+      , prodpar
+      , product
+      , projdef
+      , quantity
+      , range
+      , rscale
+      , rstart
+      , source
+      , start_lat
+      , start_lon
+      , startaz
+      , startdate
+      , starttime
+      , stop_lat
+      , stop_lon
+      , stopaz
+      , time
+      , undetect
+      , version
+      , xscale
+      , xsize
+      , yscale
+      , ysize
+      , none      ///< Not a catalogued attribute
+    };
+
+    /// Number of catalogued attributes
+    constexpr size_t count = static_cast<size_t>(id::none);
+
+    /// Get the name of a catalogued attribute
+    auto name(id key) -> const char*;
+
+    /// Get the catalogue identifier of an attribute name, or id::none if it is not catalogued
+    auto lookup(const char* name) -> id;
+
+    /// Compile time description of a catalogued attribute
+    template <id Key, typename T>
+    struct key
+    {
+      /// Catalogue identifier of the attribute
+      static constexpr id value = Key;
+      /// Type used to read and write the attribute
+      typedef T value_type;
+    };
+
+    typedef key<id::LL_lat, double>              LL_lat;
+    typedef key<id::LL_lon, double>              LL_lon;
+    typedef key<id::LR_lat, double>              LR_lat;
+    typedef key<id::LR_lon, double>              LR_lon;
+    typedef key<id::UL_lat, double>              UL_lat;
+    typedef key<id::UL_lon, double>              UL_lon;
+    typedef key<id::UR_lat, double>              UR_lat;
+    typedef key<id::UR_lon, double>              UR_lon;
+    typedef key<id::a1gate, long>                a1gate;
+    typedef key<id::angles, std::vector<double>> angles;
+    typedef key<id::az_angle, double>            az_angle;
+    typedef key<id::date, std::string>           date;
+    typedef key<id::elangle, double>             elangle;
+    typedef key<id::enddate, std::string>        enddate;
+    typedef key<id::endtime, std::string>        endtime;
+    typedef key<id::gain, double>                gain;
+    typedef key<id::height, double>              height;
+    typedef key<id::interval, double>            interval;
+    typedef key<id::lat, double>                 lat;
+    typedef key<id::levels, long>                levels;
+    typedef key<id::lon, double>                 lon;
+    typedef key<id::maxheight, double>           maxheight;
+    typedef key<id::minheight, double>           minheight;
+    typedef key<id::nbins, long>                 nbins;
+    typedef key<id::nodata, double>              nodata;
+    typedef key<id::nrays, long>                 nrays;
+    typedef key<id::object, std::string>         object;
+    typedef key<id::offset, double>              offset;
+    typedef key<id::product, std::string>        product;
+    typedef key<id::projdef, std::string>        projdef;
+    typedef key<id::quantity, std::string>       quantity;
+    typedef key<id::range, double>               range;
+    typedef key<id::rscale, double>              rscale;
+    typedef key<id::rstart, double>              rstart;
+    typedef key<id::source, std::string>         source;
+    typedef key<id::start_lat, double>           start_lat;
+    typedef key<id::start_lon, double>           start_lon;
+    typedef key<id::startaz, double>             startaz;
+    typedef key<id::startdate, std::string>      startdate;
+    typedef key<id::starttime, std::string>      starttime;
+    typedef key<id::stop_lat, double>            stop_lat;
+    typedef key<id::stop_lon, double>            stop_lon;
+    typedef key<id::stopaz, double>              stopaz;
+    typedef key<id::time, std::string>           time;
+    typedef key<id::undetect, double>            undetect;
+    typedef key<id::version, std::string>        version;
+    typedef key<id::xscale, double>              xscale;
+    typedef key<id::xsize, long>                 xsize;
+    typedef key<id::yscale, double>              yscale;
+    typedef key<id::ysize, long>                 ysize;
+  }
+
   /// Interface to metadata attributes at a particular level
+  /**
+   * The attributes and the 'what', 'where' and 'how' groups are held in a table which is shared by all
+   * copies of a store.  Copying an object therefore costs one HDF5 reference and two reference count
+   * increments regardless of how many attributes it has, and attributes inserted, erased or set through
+   * one copy are visible through the others (they refer to the same object in the file).  As with any
+   * other object, a store (and its copies) must not be modified by more than one thread at a time.
+   */
   class attribute_store
   {
   private:
@@ -150,33 +742,33 @@ namespace odim_h5
 
   public:
     /// Get the number of attributes in the store
-    auto size() const noexcept -> size_t                        { return attrs_.size(); }
+    auto size() const noexcept -> size_t                        { return table_->attrs.size(); }
 
     /// Get an iterator to the first attribute in the store
-    auto begin() noexcept -> iterator                           { return attrs_.begin(); }
+    auto begin() noexcept -> iterator                           { return table_->attrs.begin(); }
     /// Get an iterator to the first attribute in the store
-    auto begin() const noexcept -> const_iterator               { return attrs_.begin(); }
+    auto begin() const noexcept -> const_iterator               { return table_->attrs.begin(); }
     /// Get an iterator to the first attribute in the store
-    auto cbegin() const noexcept -> const_iterator              { return attrs_.begin(); }
+    auto cbegin() const noexcept -> const_iterator              { return table_->attrs.begin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto rbegin() noexcept -> reverse_iterator                  { return attrs_.rbegin(); }
+    auto rbegin() noexcept -> reverse_iterator                  { return table_->attrs.rbegin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto rbegin() const noexcept -> const_reverse_iterator      { return attrs_.rbegin(); }
+    auto rbegin() const noexcept -> const_reverse_iterator      { return table_->attrs.rbegin(); }
     /// Get an iterator to the first attribute in the store (reversed)
-    auto crbegin() const noexcept -> const_reverse_iterator     { return attrs_.rbegin(); }
+    auto crbegin() const noexcept -> const_reverse_iterator     { return table_->attrs.rbegin(); }
 
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto end() noexcept -> iterator                             { return attrs_.end(); }
+    auto end() noexcept -> iterator                             { return table_->attrs.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto end() const noexcept -> const_iterator                 { return attrs_.end(); }
+    auto end() const noexcept -> const_iterator                 { return table_->attrs.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store
-    auto cend() const noexcept -> const_iterator                { return attrs_.end(); }
+    auto cend() const noexcept -> const_iterator                { return table_->attrs.end(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto rend() noexcept -> reverse_iterator                    { return attrs_.rend(); }
+    auto rend() noexcept -> reverse_iterator                    { return table_->attrs.rend(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto rend() const noexcept -> const_reverse_iterator        { return attrs_.rend(); }
+    auto rend() const noexcept -> const_reverse_iterator        { return table_->attrs.rend(); }
     /// Get an iterator referring to the past-the-end attribute in the store (reversed)
-    auto crend() const noexcept -> const_reverse_iterator       { return attrs_.rend(); }
+    auto crend() const noexcept -> const_reverse_iterator       { return table_->attrs.rend(); }
 
     /// Find an attribute by name
     auto find(const char* name) noexcept -> iterator;
@@ -186,6 +778,10 @@ namespace odim_h5
     auto find(const std::string& name) noexcept -> iterator;
     /// Find an attribute by name
     auto find(const std::string& name) const noexcept -> const_iterator;
+    /// Find a catalogued attribute
+    auto find(keys::id key) noexcept -> iterator;
+    /// Find a catalogued attribute
+    auto find(keys::id key) const noexcept -> const_iterator;
 
     /// Get an attribute by name and create if not found
     auto operator[](const char* name) -> attribute&;
@@ -195,6 +791,17 @@ namespace odim_h5
     auto operator[](const std::string& name) -> attribute&      { return operator[](name.c_str()); }
     /// Get an attribute by name and throw if not found
     auto operator[](const std::string& name) const -> const attribute& { return operator[](name.c_str()); }
+    /// Get a catalogued attribute and create if not found
+    auto operator[](keys::id key) -> attribute&;
+    /// Get a catalogued attribute and throw if not found
+    auto operator[](keys::id key) const -> const attribute&;
+
+    /// Get the value of a catalogued attribute and throw if not found
+    template <class Key>
+    auto get() const -> typename Key::value_type                { return operator[](Key::value).template get<typename Key::value_type>(); }
+    /// Set the value of a catalogued attribute and create if not found
+    template <class Key>
+    auto set(const typename Key::value_type& val) -> void       { operator[](Key::value).set(val); }
 
     /// Erase an attribute from the store
     auto erase(iterator i) -> void;
@@ -202,23 +809,40 @@ namespace odim_h5
     auto erase(const std::string& name) -> void;
 
   protected:
-    attribute_store(handle::id_t hnd, bool existing);
-    attribute_store(const handle& parent, const char* name, size_t index, bool existing);
+    attribute_store(handle::id_t hnd, bool existing, const std::shared_ptr<file_state>& state);
+    attribute_store(const handle& parent, const char* name, size_t index, bool existing, const std::shared_ptr<file_state>& state);
 
-    attribute_store(const attribute_store& rhs);
+    attribute_store(const attribute_store& rhs) = default;
     attribute_store(attribute_store&& rhs) noexcept;
 
-    auto operator=(const attribute_store& rhs) -> attribute_store&;
+    auto operator=(const attribute_store& rhs) -> attribute_store& = default;
     auto operator=(attribute_store&& rhs) noexcept -> attribute_store&;
 
-    auto fix_attribute_parents(const attribute_store& old) -> void;
+    auto insert(handle::id_t parent, const char* name, bool existing) -> attribute&;
+    auto lookup(const char* name) const noexcept -> size_t;
+    auto reindex() -> void;
+
+  protected:
+    struct table
+    {
+      table() : slots() { }
+
+      handle        what;
+      handle        where;
+      handle        how;
+      store_impl    attrs;
+      // index + 1 of each catalogued attribute, or 0 if absent (one table is shared by every copy of an object)
+      uint32_t      slots[keys::count];
+      // index of uncatalogued attributes, only allocated once the first one is added
+      std::unique_ptr<std::unordered_map<std::string, size_t>> index;
+    };
+
+    static auto empty_table() noexcept -> const std::shared_ptr<table>&;
 
   protected:
-    handle      hnd_;
-    handle      what_;
-    handle      where_;
-    handle      how_;
-    store_impl  attrs_;
+    handle                      hnd_;
+    std::shared_ptr<table>      table_;
+    std::shared_ptr<file_state> state_;
   };
 
   /// Base class for ODIM_H5 objects with 'what', 'where' and 'how' attributes
@@ -232,14 +856,170 @@ namespace odim_h5
     /// Get the attributes stored at this level
     auto attributes() const -> const attribute_store&           { return *this; }
 
+    /// Get the options used to open the file containing this object
+    auto options() const -> const open_options&                 { return state_->options; }
+
     /// Determine whether the named attribute is directly accessible through the object API
     virtual auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    group(handle::id_t hnd, bool existing);
-    group(const handle& parent, const char* name, size_t index, bool existing);
+    group(handle::id_t hnd, bool existing, const std::shared_ptr<file_state>& state);
+    group(const handle& parent, const char* name, size_t index, bool existing, const std::shared_ptr<file_state>& state);
+
+    // declared explicitly since the virtual destructor would otherwise suppress the moves
+    group(const group& rhs) = default;
+    group(group&& rhs) noexcept = default;
+    auto operator=(const group& rhs) -> group& = default;
+    auto operator=(group&& rhs) noexcept -> group& = default;
+
+    friend class object_cache;
+  };
+
+  /// Hyperslab selection used to read a subset of a data layer
+  /**
+   * A selection is made up of one or more boxes, each described by a start, count and optional stride
+   * per dimension.  Where multiple boxes are added the selected points are returned in dataset order
+   * (row-major), not in the order that the boxes were added.  Boxes must not overlap.
+   *
+   * Selections are reusable.  The HDF5 dataspaces needed to perform a read are built on first use and
+   * retained until the selection is used with a data layer of different dimensions.
+   */
+  class selection
+  {
+  public:
+    /// Construct an empty selection of the given rank
+    selection(size_t rank = 0);
+    /// Construct a selection containing a single box
+    selection(size_t rank, const size_t* start, const size_t* count, const size_t* stride = nullptr);
+
+    /// Add a box to the selection
+    auto add(const size_t* start, const size_t* count, const size_t* stride = nullptr) -> void;
+
+    /// Get the rank of the selection
+    auto rank() const noexcept -> size_t                        { return rank_; }
+    /// Get the number of boxes in the selection
+    auto box_count() const noexcept -> size_t                   { return rank_ > 0 ? boxes_.size() / (rank_ * 3) : 0; }
+    /// Get the start of a box
+    auto start(size_t box) const noexcept -> const size_t*      { return &boxes_[box * rank_ * 3]; }
+    /// Get the number of points along each dimension of a box
+    auto count(size_t box) const noexcept -> const size_t*      { return &boxes_[box * rank_ * 3 + rank_]; }
+    /// Get the stride of a box
+    auto stride(size_t box) const noexcept -> const size_t*     { return &boxes_[box * rank_ * 3 + rank_ * 2]; }
+    /// Get the total number of points in the selection
+    auto size() const noexcept -> size_t                        { return size_; }
+
+  private:
+    auto prepare(const handle& dset) const -> void;
+
+  private:
+    size_t              rank_;
+    size_t              size_;
+    std::vector<size_t> boxes_;     // start, count and stride for each box
+
+    // cached dataspaces (valid for the dimensions in dims_)
+    mutable std::vector<size_t> dims_;
+    mutable handle              file_space_;
+    mutable handle              mem_space_;
+
+    friend class data;
+  };
+
+  /// Chunk layout used when creating a data layer
+  /**
+   * By default a data layer is stored as a single chunk, which is the most efficient layout when the
+   * layer is always read in full.  When partial reads are expected, an explicit chunk shape may be
+   * supplied or one may be chosen automatically based on the expected access pattern.
+   */
+  class chunk_layout
+  {
+  public:
+    /// Access pattern used to automatically choose a chunk shape
+    enum class access_pattern
+    {
+        whole       ///< Layer is read in full (single chunk)
+      , ray_major   ///< Layer is read as blocks of whole rays (or rows)
+      , tile        ///< Layer is read as rectangular regions of the two innermost dimensions
+      , contiguous  ///< Layer is stored unchunked and uncompressed, allowing it to be mapped
+    };
+
+  public:
+    /// Choose the chunk shape automatically based on an access pattern
+    chunk_layout(access_pattern pattern = access_pattern::whole);
+    /// Use an explicit chunk shape (clamped to the dataset dimensions)
+    chunk_layout(size_t rank, const size_t* shape);
+
+    /// Get the access pattern (only valid if no explicit shape was supplied)
+    auto pattern() const noexcept -> access_pattern             { return pattern_; }
+    /// Determine whether an explicit chunk shape was supplied
+    auto is_explicit() const noexcept -> bool                   { return !shape_.empty(); }
+
+    /// Determine the chunk shape to use for a dataset
+    auto resolve(size_t rank, const size_t* dims, size_t element_size, size_t* chunk) const -> void;
+
+  private:
+    access_pattern      pattern_;
+    std::vector<size_t> shape_;
   };
 
+  /// Compression policy used when creating a data layer
+  /**
+   * A policy consists of default compression settings and optional per-quantity overrides.  The LZ4
+   * and Zstandard codecs are provided through the standard HDF5 filter plugins (registered filter ids
+   * 32004 and 32015) which must be discoverable by HDF5 (see HDF5_PLUGIN_PATH) to read or write layers
+   * that use them.
+   */
+  class compression_policy
+  {
+  public:
+    /// Compression codec
+    enum class codec
+    {
+        none      ///< No compression
+      , deflate   ///< Deflate (zlib) compression
+      , lz4       ///< LZ4 compression (filter plugin)
+      , zstd      ///< Zstandard compression (filter plugin)
+      , other     ///< Unrecognized filter (reported for existing layers only)
+    };
+
+    /// Compression settings for a single layer
+    struct settings
+    {
+      codec type;     ///< Compression codec
+      int   level;    ///< Codec specific compression level (ignored by lz4)
+      bool  shuffle;  ///< Apply byte shuffle filter before compression
+    };
+
+  public:
+    /// Deflate at the given level, or disable compression if level is 0
+    compression_policy(int level = 6);
+    /// Use the given codec and level by default
+    compression_policy(codec type, int level, bool shuffle = false);
+
+    /// Preset favouring write speed (shuffle + deflate level 1)
+    static auto fast() -> compression_policy                    { return {codec::deflate, 1, true}; }
+    /// Preset balancing speed and size (shuffle + deflate level 6)
+    static auto balanced() -> compression_policy                { return {codec::deflate, 6, true}; }
+    /// Preset favouring file size (shuffle + deflate level 9)
+    static auto archive() -> compression_policy                 { return {codec::deflate, 9, true}; }
+
+    /// Get the default settings
+    auto defaults() const noexcept -> const settings&           { return defaults_; }
+
+    /// Override the settings used for a particular quantity
+    auto set_override(const std::string& quantity, codec type, int level, bool shuffle = false) -> void;
+    /// Remove the override for a particular quantity
+    auto erase_override(const std::string& quantity) -> void;
+
+    /// Get the settings to use for a particular quantity
+    auto lookup(const std::string& quantity) const noexcept -> const settings&;
+
+  private:
+    settings                                      defaults_;
+    std::vector<std::pair<std::string, settings>> overrides_;
+  };
+
+  class mapped_data;
+
   /// Dataset object
   class data : public group
   {
@@ -260,6 +1040,14 @@ namespace odim_h5
       , f64       ///< 64 bit float
     };
 
+    /// Strategies used to unpack data
+    enum class decode_strategy
+    {
+        automatic   ///< Choose a strategy based on the storage and output types
+      , arithmetic  ///< Scale and offset each value
+      , lookup      ///< Gather from a cached table of every possible value (8 and 16 bit integers only)
+    };
+
     /// Maximum supported dataset rank
     constexpr static size_t max_rank = 32;
 
@@ -276,7 +1064,17 @@ namespace odim_h5
           data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = default_compression
+        , const compression_policy& compression = default_compression
+        , const chunk_layout& layout = chunk_layout{}
+        ) -> data;
+    /// Append a new quality layer, set its quantity and apply any compression override for the quantity
+    auto quality_append(
+          const std::string& quantity
+        , data_type type
+        , size_t rank
+        , const size_t* dims
+        , const compression_policy& compression = default_compression
+        , const chunk_layout& layout = chunk_layout{}
         ) -> data;
 
     /// Get the type used to store dataset in file
@@ -287,6 +1085,8 @@ namespace odim_h5
     auto dims(size_t* val) const -> size_t;
     /// Get the total number of points in the dataset
     auto size() const -> size_t;
+    /// Get the compression settings used to store the dataset
+    auto compression() const -> compression_policy::settings;
 
     /// Get the quantity identifier
     auto quantity() const -> std::string;
@@ -322,82 +1122,340 @@ namespace odim_h5
     auto read(T* data) const -> void;
 
     /// Unpack and read the dataset, replace nodata and undetect with user values
+    /**
+     * Values are read in their storage type and unpacked directly into the output buffer in a single
+     * pass.  This means that nodata and undetect are matched exactly against the packed values.
+     *
+     * For 8 and 16 bit integer storage the lookup strategy decodes values using a table which is built
+     * on first use and shared by all layers with the same packing and output type.  The automatic
+     * strategy uses arithmetic for float and double output (where it is vectorized) and lookup
+     * otherwise.  Both strategies produce identical results.
+     */
+    template <typename T>
+    auto read_unpack(T* data, T undetect, T nodata, decode_strategy strategy = decode_strategy::automatic) const -> void;
+
+    /// Read a subset of the dataset without unpacking
+    /**
+     * The output buffer must have space for sel.size() values which are returned in dataset order.
+     */
+    template <typename T>
+    auto read(T* data, const selection& sel) const -> void;
+
+    /// Unpack and read a subset of the dataset, replace nodata and undetect with user values
+    template <typename T>
+    auto read_unpack(
+          T* data
+        , T undetect
+        , T nodata
+        , const selection& sel
+        , decode_strategy strategy = decode_strategy::automatic
+        ) const -> void;
+
+    /// Read the dataset using multiple threads to decompress chunks
+    /**
+     * Compressed chunks are read directly from the file and decompressed on a shared pool of worker
+     * threads, outside of the HDF5 library.  This is supported for chunked layers compressed using only
+     * the deflate and shuffle filters when T matches the storage type.  Other layers are read normally.
+     *
+     * At most threads chunks are decompressed concurrently by a call.  If threads is 0 the size of the
+     * worker pool (one thread per processor) is used.
+     */
+    template <typename T>
+    auto read_parallel(T* data, size_t threads = 0) const -> void;
+
+    /// Read the dataset without unpacking on the I/O executor
+    /**
+     * The output buffer must remain valid until the returned future is ready.
+     */
     template <typename T>
-    auto read_unpack(T* data, T undetect, T nodata) const -> void;
+    auto read_async(T* data) const -> io_future<void>;
+
+    /// Read the dataset without unpacking into a SIMD aligned buffer allocated from a memory resource
+    template <typename T>
+    auto read(memory_resource& mem) const -> buffer_view<T>;
+
+    /// Unpack and read the dataset into a SIMD aligned buffer allocated from a memory resource
+    template <typename T>
+    auto read_unpack(
+          memory_resource& mem
+        , T undetect
+        , T nodata
+        , decode_strategy strategy = decode_strategy::automatic
+        ) const -> buffer_view<T>;
+
+    /// Unpack and read the dataset on the I/O executor
+    /**
+     * The output buffer must remain valid until the returned future is ready.
+     */
+    template <typename T>
+    auto read_unpack_async(T* data, T undetect, T nodata) const -> io_future<void>;
+
+    /// Unpack and read the dataset using multiple threads to decompress chunks
+    /**
+     * As for read_parallel, with each chunk unpacked by its worker before being copied into the output.
+     * Layers which can't be decompressed directly are read using read_unpack.
+     */
+    template <typename T>
+    auto read_unpack_parallel(
+          T* data
+        , T undetect
+        , T nodata
+        , size_t threads = 0
+        , decode_strategy strategy = decode_strategy::automatic
+        ) const -> void;
+
+    /// Determine whether the layer can be memory mapped using map()
+    auto is_mappable() const -> bool;
+
+    /// Map the values of the layer directly from the file
+    /**
+     * Only layers which are stored contiguously (see chunk_layout::access_pattern::contiguous) without
+     * filters, in a native storage type, and in a file opened from disk using the default driver can
+     * be mapped.  An exception is thrown for any other layer.  The mapping remains valid after the file
+     * has been closed.
+     */
+    auto map() const -> mapped_data;
+
+    /// Release all cached decode tables
+    /**
+     * Tables in use by another thread remain valid until that thread has finished with them.
+     */
+    static auto clear_decode_tables() -> void;
 
     /// Write the dataset without packing
     template <typename T>
     auto write(const T* data) -> void;
 
+    /// Get the number of bytes needed to hold the dataset in its storage type
+    auto packed_size() const -> size_t;
+
+    /// Write the dataset from values already packed in its storage type
+    auto write_packed(const void* data) -> void;
+
+    /// Write the dataset using multiple threads to compress chunks
+    /**
+     * For chunked layers compressed using only the deflate and shuffle filters, chunks are compressed on
+     * a shared pool of worker threads and committed to the file in order by the calling thread, so that
+     * the commit of each chunk overlaps compression of those which follow.  The stored chunks are
+     * identical in format to those produced by the HDF5 filters.  Other layers, or values of a type
+     * which differs from the storage type, are written using write().
+     *
+     * At most threads chunks are compressed concurrently by a call.  If threads is 0 the size of the
+     * worker pool (one thread per processor) is used.
+     */
+    template <typename T>
+    auto write_parallel(const T* data, size_t threads = 0) -> void;
+
+    /// Layer and values packed in its storage type for use with write_packed_parallel
+    struct packed_layer
+    {
+      data*       layer;
+      const void* values;
+    };
+
+    /// Write several layers using multiple threads to compress chunks
+    /**
+     * The chunks of all layers are passed through a single pipeline so that compression of each layer
+     * overlaps the commit of the previous one.  Layers which can't be compressed directly are written
+     * using write_packed().
+     */
+    static auto write_packed_parallel(const packed_layer* layers, size_t count, size_t threads = 0) -> void;
+
     /// Pack and write the dataset, use passed functors to test for undetect and nodata
+    /**
+     * Values are packed directly into the storage type of the dataset.  For integer storage types the
+     * packed values are rounded to the nearest integer (ties to even) and saturated to the range of the
+     * type.  The nodata and undetect codes are never produced for unflagged values: a value which would
+     * round to one of them is moved to the nearest free code on the same side.  Unflagged NaN values are
+     * packed as the lowest value in the range.
+     *
+     * Packing is performed into a buffer owned by the calling thread which is reused between calls.
+     */
+    template <typename T, class UndetectTest, class NoDataTest>
+    auto write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void;
+
+    /// Pack and write the dataset using a caller supplied buffer of at least packed_size() bytes
+    template <typename T, class UndetectTest, class NoDataTest>
+    auto write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata, void* buffer) -> void;
+
+    /// Pack and write the dataset using a temporary buffer allocated from a memory resource
     template <typename T, class UndetectTest, class NoDataTest>
-    auto write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void;
+    auto write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata, memory_resource& mem) -> void;
+
+  protected:
+    // packing parameters for a dataset
+    struct packing
+    {
+      data_type type;
+      size_t    size;
+      double    gain;
+      double    offset;
+      double    nodata;
+      double    undetect;
+    };
+
+    // flags used to mark values during packing
+    enum : unsigned char { pack_value = 0, pack_undetect = 1, pack_nodata = 2 };
+    static constexpr size_t pack_block = 4096;
 
   protected:
-    data(const handle& parent, bool quality, size_t index);
+    data(const handle& parent, bool quality, size_t index, const std::shared_ptr<file_state>& state);
     data(
           const handle& parent
         , bool quality
         , size_t index
+        , const std::shared_ptr<file_state>& state
         , data_type type
         , size_t rank
         , const size_t* dims
-        , int compression);
+        , const compression_policy::settings& compression
+        , const chunk_layout& layout);
+
+    template <typename T>
+    auto read_unpack(
+          T* data
+        , T undetect
+        , T nodata
+        , size_t size
+        , handle::id_t mem_space
+        , handle::id_t file_space
+        , decode_strategy strategy
+        ) const -> void;
+
+    auto pack_params() const -> packing;
+    template <typename T>
+    static auto pack(const packing& p, const T* in, const unsigned char* flags, void* out, size_t offset, size_t count) -> void;
+    static auto pack_buffer(size_t bytes) -> void*;
 
   protected:
     size_t  size_quality_;
     handle  data_;
 
     friend class dataset;
+    friend class object_cache;
   };
 
-  template <typename T>
-  auto data::read_unpack(T* data, T undetect, T nodata) const -> void
-  {
-    read(data);
-
-    const T nd = this->nodata();
-    const T ud = this->undetect();
-    const auto a = gain();
-    const auto b = offset();
-    const auto size = this->size();
-
-    for (size_t i = 0; i < size; ++i)
-    {
-      // TODO - if T is a floating point, then the == operations below are unsafe
-      //      - should introduce a tolerance, or if store type is int, read as int and convert to T
-      if (data[i] == ud)
-        data[i] = undetect;
-      else if (data[i] == nd)
-        data[i] = nodata;
-      else
-        data[i] = a * data[i] + b;
-    }
+  template <typename T, class UndetectTest, class NoDataTest>
+  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void
+  {
+    write_pack(data, is_undetect, is_nodata, pack_buffer(packed_size()));
   }
 
   template <typename T, class UndetectTest, class NoDataTest>
-  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata) -> void
+  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata, void* buffer) -> void
   {
-    const T nd = nodata();
-    const T ud = undetect();
-    const auto a = gain();
-    const auto b = offset();
-    const auto size = this->size();
-
-    std::unique_ptr<T[]> buf{new T[size]};
-    for (size_t i = 0; i < size; ++i)
-    {
-      if (is_undetect(data[i]))
-        buf[i] = ud;
-      else if (is_nodata(data[i]))
-        buf[i] = nd;
-      else
-        buf[i] = (data[i] - b) / a;
+    const auto params = pack_params();
+
+    // classify a block of values using the user functors, then pack the block in one pass
+    unsigned char flags[pack_block];
+    for (size_t i = 0; i < params.size; i += pack_block)
+    {
+      const auto count = params.size - i < pack_block ? params.size - i : pack_block;
+      for (size_t j = 0; j < count; ++j)
+      {
+        if (is_undetect(data[i + j]))
+          flags[j] = pack_undetect;
+        else if (is_nodata(data[i + j]))
+          flags[j] = pack_nodata;
+        else
+          flags[j] = pack_value;
+      }
+      pack(params, data + i, flags, buffer, i, count);
     }
 
-    write(buf.get());
+    write_packed(buffer);
+  }
+
+  template <typename T, class UndetectTest, class NoDataTest>
+  auto data::write_pack(const T* data, UndetectTest is_undetect, NoDataTest is_nodata, memory_resource& mem) -> void
+  {
+    const auto bytes = packed_size();
+    auto buffer = mem.allocate(bytes, simd_alignment);
+    try
+    {
+      write_pack(data, is_undetect, is_nodata, buffer);
+    }
+    catch (...)
+    {
+      mem.deallocate(buffer, bytes, simd_alignment);
+      throw;
+    }
+    mem.deallocate(buffer, bytes, simd_alignment);
   }
 
+  /// Read-only view of a data layer mapped directly from the file
+  /**
+   * The view carries the storage type, dimensions and packing parameters of the layer so that values
+   * may be unpacked lazily as they are needed.
+   */
+  class mapped_data
+  {
+  public:
+    /// Create an empty view
+    mapped_data() noexcept;
+
+    mapped_data(const mapped_data& rhs) = delete;
+    mapped_data(mapped_data&& rhs) noexcept;
+    auto operator=(const mapped_data& rhs) -> mapped_data& = delete;
+    auto operator=(mapped_data&& rhs) noexcept -> mapped_data&;
+
+    ~mapped_data();
+
+    /// Get the storage type of the values
+    auto type() const noexcept -> data::data_type               { return type_; }
+    /// Get the rank of the layer
+    auto rank() const noexcept -> size_t                        { return dims_.size(); }
+    /// Get the dimensions of the layer
+    auto dims() const noexcept -> const size_t*                 { return dims_.data(); }
+    /// Get the total number of values in the layer
+    auto size() const noexcept -> size_t                        { return size_; }
+
+    /// Get the gain used to pack values
+    auto gain() const noexcept -> double                        { return gain_; }
+    /// Get the offset used to pack values
+    auto offset() const noexcept -> double                      { return offset_; }
+    /// Get the packed value used to indicate no data
+    auto nodata() const noexcept -> double                      { return nodata_; }
+    /// Get the packed value used to indicate undetect
+    auto undetect() const noexcept -> double                    { return undetect_; }
+
+    /// Get a pointer to the packed values (size() values of the storage type)
+    auto values() const noexcept -> const void*                 { return values_; }
+
+    /// Unpack a range of values, replace nodata and undetect with user values
+    template <typename T>
+    auto unpack(T* data, T undetect, T nodata, size_t offset, size_t count) const -> void;
+    /// Unpack all values, replace nodata and undetect with user values
+    template <typename T>
+    auto unpack(T* data, T undetect, T nodata) const -> void     { unpack(data, undetect, nodata, 0, size_); }
+
+  private:
+    mapped_data(
+          void* map
+        , size_t map_size
+        , const void* values
+        , data::data_type type
+        , std::vector<size_t> dims
+        , double gain
+        , double offset
+        , double nodata
+        , double undetect);
+
+  private:
+    void*               map_;
+    size_t              map_size_;
+    const void*         values_;
+    data::data_type     type_;
+    std::vector<size_t> dims_;
+    size_t              size_;
+    double              gain_;
+    double              offset_;
+    double              nodata_;
+    double              undetect_;
+
+    friend class data;
+  };
+
   /// Dataset group which contains data and optional quality layers
   class dataset : public group
   {
@@ -411,7 +1469,17 @@ namespace odim_h5
           data::data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = data::default_compression
+        , const compression_policy& compression = data::default_compression
+        , const chunk_layout& layout = chunk_layout{}
+        ) -> data;
+    /// Append a data layer, set its quantity and apply any compression override for the quantity
+    auto data_append(
+          const std::string& quantity
+        , data::data_type type
+        , size_t rank
+        , const size_t* dims
+        , const compression_policy& compression = data::default_compression
+        , const chunk_layout& layout = chunk_layout{}
         ) -> data;
 
     /// Get the number of quality layers
@@ -423,11 +1491,21 @@ namespace odim_h5
           data::data_type type
         , size_t rank
         , const size_t* dims
-        , int compression = data::default_compression
+        , const compression_policy& compression = data::default_compression
+        , const chunk_layout& layout = chunk_layout{}
+        ) -> data;
+    /// Append a new quality layer, set its quantity and apply any compression override for the quantity
+    auto quality_append(
+          const std::string& quantity
+        , data::data_type type
+        , size_t rank
+        , const size_t* dims
+        , const compression_policy& compression = data::default_compression
+        , const chunk_layout& layout = chunk_layout{}
         ) -> data;
 
   protected:
-    dataset(const handle& parent, size_t index, bool existing);
+    dataset(const handle& parent, size_t index, bool existing, const std::shared_ptr<file_state>& state);
 
   protected:
     size_t  size_data_;
@@ -470,7 +1548,25 @@ namespace odim_h5
      * \param path  Path of file to open
      * \param mode  Mode of open
      */
-    file(const std::string& path, io_mode mode);
+    file(const std::string& path, io_mode mode, const open_options& options = open_options{});
+
+    /// Open or create an ODIM_H5 file held in memory
+    /**
+     * \param image  Buffer containing a complete HDF5 file image
+     * \param size   Size of the image in bytes
+     * \param mode   Mode of open
+     *
+     * When opened read_only the buffer is used in place without being copied.  In this case it must not
+     * be modified or released until the file and all objects opened from it have been destroyed.  When
+     * opened read_write the image is copied into a buffer owned by the library.  When mode is create a
+     * new empty file is created in memory and image and size are ignored.
+     *
+     * No part of the file is ever read from or written to disk.  Use image() to retrieve the result.
+     */
+    file(const void* image, size_t size, io_mode mode, const open_options& options = open_options{});
+
+    /// Open an ODIM_H5 file on the I/O executor
+    static auto open_async(const std::string& path, io_mode mode, const open_options& options = open_options{}) -> io_future<file>;
 
     /// Get the io_mode used to open the file
     auto mode() const noexcept -> io_mode                       { return mode_; }
@@ -478,6 +1574,22 @@ namespace odim_h5
     /// Ensure all write actions have been synced to disk
     auto flush() -> void;
 
+    /// Get the structure index of the file
+    /**
+     * For read only files this is the index built when the file was opened.  For other modes a new index
+     * reflecting the current content of the file is built on each call.
+     */
+    auto structure() const -> std::shared_ptr<const structure_index>;
+
+    /// Get the counters of the open object cache (all zero if the cache is not in use)
+    auto object_cache_statistics() const -> cache_statistics;
+
+    /// Get a complete image of the file as a contiguous buffer
+    /**
+     * All pending writes are flushed first.  This works for both in-memory and on-disk files.
+     */
+    auto image() const -> std::vector<unsigned char>;
+
     /// Get the number of datasets in the file
     auto dataset_count() const -> size_t                        { return size_; }
     /// Open a dataset
@@ -523,6 +1635,8 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
+    file(handle::id_t hnd, io_mode mode, const open_options& options);
+
     template <class T> auto dset_open_as(size_t i) const -> T;
     template <class T> auto dset_make_as() -> T;
 
@@ -604,22 +1718,77 @@ namespace odim_h5
     /// Set the scan end date and time using a time_t
     auto set_end_date_time(time_t val) -> void;
 
+    /// Build a selection covering the rays and bins which intersect a region of the scan
+    /**
+     * The region is given as a clockwise azimuth interval from az_min to az_max (degrees) and a range
+     * interval from range_min to range_max (m).  Every ray and bin which overlaps the region is included.
+     * If the azimuth interval crosses the first ray of the scan the selection will contain two boxes and
+     * the rays at the start of the scan will be returned first.
+     */
+    auto select(double az_min, double az_max, double range_min, double range_max) const -> selection;
+
     auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    scan(const handle& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
+    scan(const handle& parent, size_t index, bool existing, const std::shared_ptr<file_state>& state)
+      : dataset(parent, index, existing, state)
+    { }
     friend class file;
   };
 
+  /// Columnar snapshot of the dataX layers of every dataset in a file
+  /**
+   * Each member holds one element per layer.  Layers are ordered by dataset and then layer index.
+   */
+  struct layer_columns
+  {
+    std::vector<size_t>       dataset;    ///< Index of the dataset containing the layer
+    std::vector<size_t>       layer;      ///< Index of the layer within its dataset
+    std::vector<std::string>  quantity;   ///< Quantity (empty if missing)
+    std::vector<double>       gain;       ///< Gain (NaN if missing)
+    std::vector<double>       offset;     ///< Offset (NaN if missing)
+    std::vector<double>       nodata;     ///< Value used to indicate no data (NaN if missing)
+    std::vector<double>       undetect;   ///< Value used to indicate undetect (NaN if missing)
+    std::vector<size_t>       rows;       ///< Size of the first dimension (0 if opened metadata only)
+    std::vector<size_t>       cols;       ///< Size of the second dimension (1 for rank 1 layers, 0 if opened metadata only)
+
+    /// Get the number of layers
+    auto size() const -> size_t                                 { return dataset.size(); }
+  };
+
+  /// Columnar snapshot of the metadata of a polar volume
+  /**
+   * Except for layers, each member holds one element per scan.  Missing attributes are reported as NaN
+   * for reals, -1 for integers and 0 for times.
+   */
+  struct polar_volume_metadata
+  {
+    std::vector<double>   elevation_angle;      ///< Elevation angle
+    std::vector<long>     bin_count;            ///< Number of range bins in each ray
+    std::vector<long>     ray_count;            ///< Number of azimuth gates in the scan
+    std::vector<double>   range_scale;          ///< Distance between bins
+    std::vector<double>   range_start;          ///< Range of the start of the first bin
+    std::vector<long>     first_ray_radiated;   ///< Index of the first ray radiated
+    std::vector<time_t>   start_date_time;      ///< Start date/time of the scan
+    std::vector<time_t>   end_date_time;        ///< End date/time of the scan
+    std::vector<size_t>   first_layer;          ///< Index into layers of the first layer of each scan (plus a final total)
+    layer_columns         layers;               ///< Columns describing the dataX layers of every scan
+  };
+
   /// Polar volume ODIM_H5 file
   class polar_volume : public file
   {
   public:
     /// Open or create a polar volume ODIM_H5 file
-    polar_volume(const std::string& path, io_mode mode);
+    polar_volume(const std::string& path, io_mode mode, const open_options& options = open_options{});
+    /// Open or create a polar volume ODIM_H5 file held in memory
+    polar_volume(const void* image, size_t size, io_mode mode, const open_options& options = open_options{});
     /// Cast an open ODIM_H5 file to a polar volume handle
     polar_volume(file f);
 
+    /// Open a polar volume ODIM_H5 file on the I/O executor
+    static auto open_async(const std::string& path, io_mode mode, const open_options& options = open_options{}) -> io_future<polar_volume>;
+
     /// Get the number of scans in the volume
     auto scan_count() const -> size_t                           { return dataset_count(); }
     /// Open a scan
@@ -627,6 +1796,11 @@ namespace odim_h5
     /// Append a new scan
     auto scan_append() -> scan                                  { return dset_make_as<scan>(); }
 
+    /// Get the metadata of every scan and layer in a single call
+    auto metadata() const -> polar_volume_metadata;
+    /// Get the metadata of every scan and layer on the I/O executor
+    auto metadata_async() const -> io_future<polar_volume_metadata>;
+
     /// Get the longitude of the antenna
     auto longitude() const -> double;
     /// Set the longitude of the antenna
@@ -645,6 +1819,204 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
   };
 
+  /// Iterates through the scans of a polar volume while reading ahead on a background thread
+  /**
+   * A background thread opens the upcoming scans in order and reads and unpacks their selected dataX
+   * layers, staying at most a fixed number of scans and bytes ahead of the caller.  This overlaps file
+   * I/O and decompression with whatever processing the caller performs on the current scan.
+   *
+   * The background thread uses the HDF5 library concurrently with the caller, so thread safe mode must
+   * be enabled (see set_thread_safe()) before a reader is created.  Destroying the reader cancels any
+   * outstanding read ahead and waits for the background thread to finish.
+   */
+  class sweep_reader
+  {
+  public:
+    /// Options controlling the read ahead
+    struct settings
+    {
+      size_t                    lookahead = 2;            ///< Maximum number of decoded scans waiting for the caller
+      size_t                    max_bytes = 256 << 20;    ///< Maximum bytes of decoded values waiting for the caller
+      std::vector<std::string>  quantities;               ///< Quantities to decode (empty for all)
+      float                     undetect = std::numeric_limits<float>::quiet_NaN();  ///< Value used for undetect
+      float                     nodata = std::numeric_limits<float>::quiet_NaN();    ///< Value used for nodata
+    };
+
+    /// A decoded dataX layer
+    struct layer
+    {
+      size_t              index;      ///< Index of the layer within its scan
+      std::string         quantity;   ///< Quantity of the layer
+      size_t              rows;       ///< Size of the first dimension (rays)
+      size_t              cols;       ///< Size of the second dimension (bins)
+      std::vector<float>  values;     ///< Unpacked values
+    };
+
+    /// A decoded scan
+    struct sweep
+    {
+      size_t              index;      ///< Index of the scan within the volume
+      double              elevation;  ///< Elevation angle of the scan (NaN if unknown)
+      std::vector<layer>  layers;     ///< Decoded layers in file order
+    };
+
+  public:
+    /// Begin reading ahead through every scan of a volume
+    sweep_reader(const polar_volume& volume);
+
+    /// Begin reading ahead through every scan of a volume
+    sweep_reader(const polar_volume& volume, settings config);
+
+    sweep_reader(const sweep_reader& rhs) = delete;
+    sweep_reader(sweep_reader&& rhs) noexcept = default;
+    auto operator=(const sweep_reader& rhs) -> sweep_reader& = delete;
+    auto operator=(sweep_reader&& rhs) noexcept -> sweep_reader&;
+
+    ~sweep_reader();
+
+    /// Get the next scan, blocking until it has been decoded
+    /**
+     * Returns false once every scan has been returned or the reader has been cancelled.  Any error
+     * encountered while reading ahead is thrown by the call which would have returned the failed scan.
+     * The buffers previously held by out are recycled by the background thread.
+     */
+    auto next(sweep& out) -> bool;
+
+    /// Stop reading ahead and discard any decoded scans not yet returned
+    auto cancel() -> void;
+
+  private:
+    struct state;
+
+  private:
+    auto stop() noexcept -> void;
+    static auto run(const std::shared_ptr<state>& st) -> void;
+
+  private:
+    std::shared_ptr<state>  state_;
+  };
+
+  /// Creates a polar volume by capturing each operation and performing it on a background thread
+  /**
+   * Calls on the writer only copy values and metadata into buffers owned by the writer before returning.
+   * A background thread then creates the layers, packs and compresses values, sets attributes and commits
+   * everything to the file in the order the calls were made.  Once the captured values waiting to be
+   * written exceed the memory limit, calls which capture further values block until enough has been
+   * written.
+   *
+   * Scans are addressed by the index returned from scan_append() and layers by the index returned from
+   * data_append().  Attribute targets use npos as the scan index for the root of the file and as the
+   * layer index for the scan itself.  Attribute names are placed in the 'what', 'where' or 'how' group
+   * as for attribute_store.
+   *
+   * The first error encountered by the background thread is thrown by every subsequent call on the writer,
+   * including flush() and close().  Any operations still queued after a failure are discarded.  If the
+   * calling thread uses the HDF5 library elsewhere while a writer is open then thread safe mode must be
+   * enabled (see set_thread_safe()).
+   */
+  class volume_writer
+  {
+  public:
+    /// Value used to address the file root or a scan itself when setting attributes
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /// Options controlling a writer
+    struct settings
+    {
+      size_t              max_bytes = 256 << 20;                  ///< Maximum bytes of captured values waiting to be written
+      compression_policy  compression = data::default_compression; ///< Compression used for data layers
+      chunk_layout        layout;                                 ///< Chunk layout used for data layers
+    };
+
+  public:
+    /// Create a polar volume file
+    volume_writer(const std::string& path);
+
+    /// Create a polar volume file
+    volume_writer(const std::string& path, settings config);
+
+    volume_writer(const volume_writer& rhs) = delete;
+    auto operator=(const volume_writer& rhs) -> volume_writer& = delete;
+
+    /// Close the writer, any error is discarded (call close() to observe errors)
+    ~volume_writer();
+
+    /// Append a new scan, returning its index
+    auto scan_append() -> size_t;
+
+    /// Append a new data layer to a scan, returning its index within the scan
+    auto data_append(size_t scan, const std::string& quantity, data::data_type type, size_t rank, const size_t* dims) -> size_t;
+
+    /// Set an attribute of the file (scan is npos), a scan (layer is npos) or a data layer
+    template <typename T>
+    auto set_attribute(size_t scan, size_t layer, const std::string& name, T val) -> void;
+    auto set_attribute(size_t scan, size_t layer, const std::string& name, const char* val) -> void;
+
+    /// Write values to a layer without packing
+    template <typename T>
+    auto write(size_t scan, size_t layer, std::vector<T> values) -> void;
+
+    /// Pack and write values to a layer, using the gain, offset, nodata and undetect set on the layer
+    template <typename T, class UndetectTest, class NoDataTest>
+    auto write_pack(size_t scan, size_t layer, std::vector<T> values, UndetectTest is_undetect, NoDataTest is_nodata) -> void;
+
+    /// Pack and write values to a layer, copying the values first
+    template <typename T, class UndetectTest, class NoDataTest>
+    auto write_pack(size_t scan, size_t layer, const T* values, UndetectTest is_undetect, NoDataTest is_nodata) -> void;
+
+    /// Perform an arbitrary operation on the volume in order with the captured operations
+    auto defer(std::function<void(polar_volume&)> op) -> void;
+
+    /// Wait for every captured operation to be written and flushed to disk
+    auto flush() -> void;
+
+    /// Wait for every captured operation to be written and close the file
+    auto close() -> void;
+
+  private:
+    struct state;
+
+  private:
+    static auto enqueue(state& st, size_t bytes, std::function<void(state&)> op) -> void;
+    static auto run(state& st) -> void;
+
+    auto layer_size(size_t scan, size_t layer) const -> size_t;
+    auto enqueue_attribute(size_t scan, size_t layer, const std::string& name, std::function<void(attribute&)> op) -> void;
+    auto enqueue_layer(size_t scan, size_t layer, size_t count, size_t element_size, std::function<void(data&)> op) -> void;
+
+  private:
+    std::unique_ptr<state>  state_;
+  };
+
+  template <typename T>
+  auto volume_writer::set_attribute(size_t scan, size_t layer, const std::string& name, T val) -> void
+  {
+    enqueue_attribute(scan, layer, name, [val](attribute& attr) { attr.set(val); });
+  }
+
+  template <typename T>
+  auto volume_writer::write(size_t scan, size_t layer, std::vector<T> values) -> void
+  {
+    auto buf = std::make_shared<std::vector<T>>(std::move(values));
+    enqueue_layer(scan, layer, buf->size(), sizeof(T), [buf](data& layer) { layer.write(buf->data()); });
+  }
+
+  template <typename T, class UndetectTest, class NoDataTest>
+  auto volume_writer::write_pack(size_t scan, size_t layer, std::vector<T> values, UndetectTest is_undetect, NoDataTest is_nodata) -> void
+  {
+    auto buf = std::make_shared<std::vector<T>>(std::move(values));
+    enqueue_layer(scan, layer, buf->size(), sizeof(T), [buf, is_undetect, is_nodata](data& layer)
+    {
+      layer.write_pack(buf->data(), is_undetect, is_nodata);
+    });
+  }
+
+  template <typename T, class UndetectTest, class NoDataTest>
+  auto volume_writer::write_pack(size_t scan, size_t layer, const T* values, UndetectTest is_undetect, NoDataTest is_nodata) -> void
+  {
+    write_pack(scan, layer, std::vector<T>(values, values + layer_size(scan, layer)), is_undetect, is_nodata);
+  }
+
   /// Vertical profile object (datasetX level)
   class profile : public dataset
   {
@@ -682,19 +2054,38 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
 
   protected:
-    profile(const handle& parent, size_t index, bool existing) : dataset(parent, index, existing) { }
+    profile(const handle& parent, size_t index, bool existing, const std::shared_ptr<file_state>& state)
+      : dataset(parent, index, existing, state)
+    { }
     friend class file;
   };
 
+  /// Columnar snapshot of the metadata of a vertical profile
+  /**
+   * Except for layers, each member holds one element per profile.  Missing times are reported as 0.
+   */
+  struct vertical_profile_metadata
+  {
+    std::vector<time_t>   start_date_time;      ///< Start date/time of the profile
+    std::vector<time_t>   end_date_time;        ///< End date/time of the profile
+    std::vector<size_t>   first_layer;          ///< Index into layers of the first layer of each profile (plus a final total)
+    layer_columns         layers;               ///< Columns describing the dataX layers of every profile
+  };
+
   /// Vertical profile ODIM_H5 file
   class vertical_profile : public file
   {
   public:
     /// Open or create a polar volume ODIM_H5 file
-    vertical_profile(const std::string& path, io_mode mode);
+    vertical_profile(const std::string& path, io_mode mode, const open_options& options = open_options{});
+    /// Open or create a vertical profile ODIM_H5 file held in memory
+    vertical_profile(const void* image, size_t size, io_mode mode, const open_options& options = open_options{});
     /// Cast an open ODIM_H5 file to a polar volume handle
     vertical_profile(file f);
 
+    /// Open a vertical profile ODIM_H5 file on the I/O executor
+    static auto open_async(const std::string& path, io_mode mode, const open_options& options = open_options{}) -> io_future<vertical_profile>;
+
     /// Get the number of profiles in the volume
     auto profile_count() const -> size_t                        { return dataset_count(); }
     /// Open a profile
@@ -702,6 +2093,11 @@ namespace odim_h5
     /// Append a new profile
     auto profile_append() -> profile                            { return dset_make_as<profile>(); }
 
+    /// Get the metadata of every profile and layer in a single call
+    auto metadata() const -> vertical_profile_metadata;
+    /// Get the metadata of every profile and layer on the I/O executor
+    auto metadata_async() const -> io_future<vertical_profile_metadata>;
+
     /// Get the longitude of the antenna
     auto longitude() const -> double;
     /// Set the longitude of the antenna
@@ -740,6 +2136,374 @@ namespace odim_h5
     auto is_api_attribute(const std::string& name) const -> bool;
   };
 
+  /// Cartesian image or composite product object (datasetX level)
+  class cartesian_dataset : public dataset
+  {
+  public:
+    /// Get the product type string
+    auto product() const -> std::string;
+    /// Set the product type string
+    auto set_product(const std::string& val) -> void;
+
+    /// Get the product start date string
+    auto start_date() const -> std::string;
+    /// Set the product start date string
+    auto set_start_date(const std::string& val) -> void;
+
+    /// Get the product start time string
+    auto start_time() const -> std::string;
+    /// Set the product start time string
+    auto set_start_time(const std::string& val) -> void;
+
+    /// Get the product start date and time as a time_t
+    auto start_date_time() const -> time_t;
+    /// Set the product start date and time using a time_t
+    auto set_start_date_time(time_t val) -> void;
+
+    /// Get the product end date string
+    auto end_date() const -> std::string;
+    /// Set the product end date string
+    auto set_end_date(const std::string& val) -> void;
+
+    /// Get the product end time string
+    auto end_time() const -> std::string;
+    /// Set the product end time string
+    auto set_end_time(const std::string& val) -> void;
+
+    /// Get the product end date and time as a time_t
+    auto end_date_time() const -> time_t;
+    /// Set the product end date and time using a time_t
+    auto set_end_date_time(time_t val) -> void;
+
+    auto is_api_attribute(const std::string& name) const -> bool;
+
+  protected:
+    cartesian_dataset(const handle& parent, size_t index, bool existing, const std::shared_ptr<file_state>& state)
+      : dataset(parent, index, existing, state)
+    { }
+    friend class file;
+  };
+
+  /// Cartesian image ODIM_H5 file
+  /**
+   * The grid is described by the top level 'where' attributes.  Layers are stored as ysize rows of xsize
+   * columns, with the first row at the top (northern) edge of the image and the first column at the left
+   * (western) edge.
+   *
+   * Layers created with layer_append() use a tiled chunk layout by default, so that reading a region of a
+   * large image only decompresses the tiles which the region overlaps.  For example:
+   *
+   *   composite comp{"national.h5", file::io_mode::read_only};
+   *   auto sel = comp.select(x0, y0, x1, y1);
+   *   std::vector<float> vals(sel.size());
+   *   comp.image_open(0).data_open(0).read_unpack(vals.data(), undetect, nodata, sel);
+   */
+  class cartesian_image : public file
+  {
+  public:
+    /// Open or create a cartesian image ODIM_H5 file
+    cartesian_image(const std::string& path, io_mode mode, const open_options& options = open_options{});
+    /// Open or create a cartesian image ODIM_H5 file held in memory
+    cartesian_image(const void* image, size_t size, io_mode mode, const open_options& options = open_options{});
+    /// Cast an open ODIM_H5 file to a cartesian image handle
+    cartesian_image(file f);
+
+    /// Open a cartesian image ODIM_H5 file on the I/O executor
+    static auto open_async(const std::string& path, io_mode mode, const open_options& options = open_options{}) -> io_future<cartesian_image>;
+
+    /// Get the number of images in the file
+    auto image_count() const -> size_t                          { return dataset_count(); }
+    /// Open an image
+    auto image_open(size_t i) const -> cartesian_dataset        { return dset_open_as<cartesian_dataset>(i); }
+    /// Append a new image
+    auto image_append() -> cartesian_dataset                    { return dset_make_as<cartesian_dataset>(); }
+
+    /// Append a data layer covering the whole grid to an image
+    /**
+     * The layer dimensions are taken from y_size() and x_size(), which must be set first.
+     */
+    auto layer_append(
+          cartesian_dataset& image
+        , const std::string& quantity
+        , data::data_type type
+        , const compression_policy& compression = data::default_compression
+        , const chunk_layout& layout = chunk_layout{chunk_layout::access_pattern::tile}
+        ) -> data;
+
+    /// Get the projection definition string (PROJ.4 format)
+    auto projection() const -> std::string;
+    /// Set the projection definition string (PROJ.4 format)
+    auto set_projection(const std::string& val) -> void;
+
+    /// Get the number of columns in the grid
+    auto x_size() const -> long;
+    /// Set the number of columns in the grid
+    auto set_x_size(long val) -> void;
+
+    /// Get the number of rows in the grid
+    auto y_size() const -> long;
+    /// Set the number of rows in the grid
+    auto set_y_size(long val) -> void;
+
+    /// Get the distance between columns (m)
+    auto x_scale() const -> double;
+    /// Set the distance between columns (m)
+    auto set_x_scale(double val) -> void;
+
+    /// Get the distance between rows (m)
+    auto y_scale() const -> double;
+    /// Set the distance between rows (m)
+    auto set_y_scale(double val) -> void;
+
+    /// Get the longitude of the lower left corner of the image
+    auto lower_left_longitude() const -> double;
+    /// Set the longitude of the lower left corner of the image
+    auto set_lower_left_longitude(double val) -> void;
+
+    /// Get the latitude of the lower left corner of the image
+    auto lower_left_latitude() const -> double;
+    /// Set the latitude of the lower left corner of the image
+    auto set_lower_left_latitude(double val) -> void;
+
+    /// Get the longitude of the upper left corner of the image
+    auto upper_left_longitude() const -> double;
+    /// Set the longitude of the upper left corner of the image
+    auto set_upper_left_longitude(double val) -> void;
+
+    /// Get the latitude of the upper left corner of the image
+    auto upper_left_latitude() const -> double;
+    /// Set the latitude of the upper left corner of the image
+    auto set_upper_left_latitude(double val) -> void;
+
+    /// Get the longitude of the upper right corner of the image
+    auto upper_right_longitude() const -> double;
+    /// Set the longitude of the upper right corner of the image
+    auto set_upper_right_longitude(double val) -> void;
+
+    /// Get the latitude of the upper right corner of the image
+    auto upper_right_latitude() const -> double;
+    /// Set the latitude of the upper right corner of the image
+    auto set_upper_right_latitude(double val) -> void;
+
+    /// Get the longitude of the lower right corner of the image
+    auto lower_right_longitude() const -> double;
+    /// Set the longitude of the lower right corner of the image
+    auto set_lower_right_longitude(double val) -> void;
+
+    /// Get the latitude of the lower right corner of the image
+    auto lower_right_latitude() const -> double;
+    /// Set the latitude of the lower right corner of the image
+    auto set_lower_right_latitude(double val) -> void;
+
+    /// Build a selection covering a rectangular region of the grid
+    /**
+     * The region covers columns x_min to x_max - 1 and rows y_min to y_max - 1, clipped to the grid.
+     */
+    auto select(size_t x_min, size_t y_min, size_t x_max, size_t y_max) const -> selection;
+
+    auto is_api_attribute(const std::string& name) const -> bool;
+
+  protected:
+    cartesian_image(file f, object_type type);
+  };
+
+  /// Composite ODIM_H5 file
+  class composite : public cartesian_image
+  {
+  public:
+    /// Open or create a composite ODIM_H5 file
+    composite(const std::string& path, io_mode mode, const open_options& options = open_options{});
+    /// Open or create a composite ODIM_H5 file held in memory
+    composite(const void* image, size_t size, io_mode mode, const open_options& options = open_options{});
+    /// Cast an open ODIM_H5 file to a composite handle
+    composite(file f);
+
+    /// Open a composite ODIM_H5 file on the I/O executor
+    static auto open_async(const std::string& path, io_mode mode, const open_options& options = open_options{}) -> io_future<composite>;
+  };
+
+  /// Index of the metadata of many files supporting source and date/time queries
+  /**
+   * Files are scanned in metadata only mode, so no 'data' dataset is ever opened.  The index is stored
+   * as a single file of fixed size records and string tables.  It is memory mapped when opened, so
+   * queries neither parse nor load it.  Updating an index only rescans files which are new or whose
+   * size or modification time has changed.
+   *
+   * For example, to find volumes from a radar between two times which contain ZDR at 0.5 degrees:
+   *
+   *   catalogue cat{"archive.idx"};
+   *   for (auto i : cat.find("NOD:fianj", t0, t1))
+   *   {
+   *     auto rec = cat.entry(i);
+   *     if (rec.object == "PVOL" && rec.contains("ZDR", 0.5))
+   *       ...
+   *   }
+   */
+  class catalogue
+  {
+  public:
+    /// Metadata of a single datasetX group
+    struct sweep
+    {
+      time_t                    start_time;       ///< Start date/time (0 if missing)
+      time_t                    end_time;         ///< End date/time (0 if missing)
+      double                    elevation_angle;  ///< Elevation angle (NaN if missing)
+      long                      bin_count;        ///< Number of range bins (0 if missing)
+      long                      ray_count;        ///< Number of rays (0 if missing)
+      std::vector<std::string>  quantities;       ///< Quantities of the dataX layers
+    };
+
+    /// Metadata of a single file
+    struct record
+    {
+      std::string         path;       ///< Path of the file
+      int64_t             modified;   ///< Modification time of the file when it was scanned
+      uint64_t            size;       ///< Size of the file when it was scanned
+      std::string         object;     ///< Value of the root 'object' attribute
+      std::string         source;     ///< Value of the root 'source' attribute
+      time_t              date_time;  ///< Nominal date/time of the file (0 if missing)
+      double              latitude;   ///< Latitude of the site (NaN if missing)
+      double              longitude;  ///< Longitude of the site (NaN if missing)
+      double              height;     ///< Height of the site (NaN if missing)
+      std::vector<sweep>  datasets;   ///< Metadata of each datasetX group
+
+      /// Determine whether any dataset at the given elevation angle contains the quantity
+      auto contains(const std::string& quantity, double elevation_angle, double tolerance = 0.01) const -> bool;
+    };
+
+  public:
+    /// Extract the metadata of a single file without opening any data layers
+    static auto scan(const std::string& path) -> record;
+
+    /// Create or update an index file
+    /**
+     * Each listed file is scanned unless it is already in the index with the same size and modification
+     * time.  Listed files which no longer exist are removed, while entries for files which are not listed
+     * are retained.  Files which cannot be scanned are skipped and, if failed is not null, their paths are
+     * appended to it.  The index is written to a temporary file which is then renamed over the original,
+     * so existing readers are unaffected.
+     */
+    static auto update(
+          const std::string& index_path
+        , const std::vector<std::string>& paths
+        , std::vector<std::string>* failed = nullptr
+        ) -> void;
+
+  public:
+    /// Create an empty catalogue
+    catalogue() noexcept;
+    /// Open an index file
+    catalogue(const std::string& index_path);
+
+    catalogue(const catalogue& rhs) = delete;
+    catalogue(catalogue&& rhs) noexcept;
+    auto operator=(const catalogue& rhs) -> catalogue& = delete;
+    auto operator=(catalogue&& rhs) noexcept -> catalogue&;
+
+    ~catalogue();
+
+    /// Get the number of files in the catalogue
+    auto size() const noexcept -> size_t;
+    /// Get the metadata of a file (entries are ordered by source and then date/time)
+    auto entry(size_t i) const -> record;
+    /// Get the path of a file without decoding the whole entry
+    auto path(size_t i) const -> const char*;
+    /// Get the source of a file without decoding the whole entry
+    auto source(size_t i) const -> const char*;
+    /// Get the nominal date/time of a file without decoding the whole entry
+    auto date_time(size_t i) const -> time_t;
+
+    /// Find files with a nominal date/time in [from, till) ordered by date/time
+    auto find(time_t from, time_t till) const -> std::vector<size_t>;
+    /// Find files from a source ordered by date/time
+    /**
+     * The source matches either the whole 'source' attribute or any one of its comma separated
+     * identifiers (e.g. "NOD:fianj").
+     */
+    auto find(const std::string& source) const -> std::vector<size_t>;
+    /// Find files from a source with a nominal date/time in [from, till) ordered by date/time
+    auto find(const std::string& source, time_t from, time_t till) const -> std::vector<size_t>;
+
+  private:
+    auto release() noexcept -> void;
+
+  private:
+    const unsigned char*  base_;
+    size_t                size_;
+    bool                  mapped_;  // base_ is a memory mapping rather than a heap allocation
+  };
+
+  /// Decodes many files in parallel using a pool of worker processes
+  /**
+   * Each worker is a forked copy of the calling process which claims the next file from a shared counter,
+   * decodes its dataX layers using data::read_unpack and writes the values directly into a result slot of
+   * an anonymous shared memory mapping.  The calling process hands each completed slot to a callback
+   * without copying and then returns the slot to the workers.  Memory use is bounded by the number and
+   * size of the slots.
+   *
+   * Failures are isolated per file.  An error opening or decoding a file is reported for that file
+   * alone, and a worker which terminates abnormally causes only the file it was decoding to fail before it
+   * is replaced.
+   *
+   * Workers are created by fork(), which copies only the calling thread into the child.  A lock held by any
+   * other thread at that moment would remain locked forever in the child, so load() throws unless the
+   * calling process is single threaded.  The idle threads kept by the library after earlier parallel or
+   * asynchronous calls are stopped first using release_threads(), so these calls do not prevent a later
+   * load().  Threads of a live sweep_reader or volume_writer do, as does any other thread.  Only Linux is
+   * supported; elsewhere load() throws.
+   */
+  class process_loader
+  {
+  public:
+    /// Options controlling a loader
+    struct settings
+    {
+      size_t                    workers = 0;              ///< Number of worker processes (0 for one per hardware thread)
+      size_t                    slots = 0;                ///< Number of result slots (0 for two per worker)
+      size_t                    slot_bytes = 64 << 20;    ///< Capacity of each result slot in bytes
+      std::vector<std::string>  quantities;               ///< Quantities to decode (empty for all)
+      float                     undetect = std::numeric_limits<float>::quiet_NaN();  ///< Value used for undetect
+      float                     nodata = std::numeric_limits<float>::quiet_NaN();    ///< Value used for nodata
+    };
+
+    /// A decoded layer, values remain valid only for the duration of the callback
+    struct layer
+    {
+      size_t        dataset;    ///< Index of the dataset containing the layer
+      size_t        index;      ///< Index of the layer within its dataset
+      const char*   quantity;   ///< Quantity of the layer
+      size_t        rows;       ///< Size of the first dimension
+      size_t        cols;       ///< Size of the second dimension (1 for rank 1 layers)
+      const float*  values;     ///< Unpacked values
+    };
+
+    /// A decoded file, passed to the callback in order of completion
+    struct result
+    {
+      size_t              index;    ///< Index of the file in the list passed to load()
+      const char*         path;     ///< Path of the file
+      const char*         error;    ///< Description of the failure, or nullptr on success
+      std::vector<layer>  layers;   ///< Decoded layers (empty on failure)
+    };
+
+  public:
+    /// Create a loader with default settings
+    process_loader();
+
+    /// Create a loader
+    process_loader(settings config);
+
+    /// Decode a list of files, calling consume once for each file
+    /**
+     * The callback is always called from the calling thread.  If it throws, the workers are terminated
+     * and the exception is propagated.
+     */
+    auto load(const std::vector<std::string>& paths, const std::function<void(const result&)>& consume) -> void;
+
+  private:
+    settings config_;
+  };
+
   /* efficient use of library:
    *
    * // best...
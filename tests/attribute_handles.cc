@@ -0,0 +1,94 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "../odim_h5.h"
+
+#include <hdf5.h>
+#include <string>
+#include <utility>
+
+using namespace odim_h5;
+
+/* Error paths taken by attribute reads must not release the group or file ids which the attribute_store
+ * owns.  Each case triggers an error and then checks that no HDF5 object was closed and that the file
+ * can still be used. */
+
+static auto open_objects() -> ssize_t
+{
+  return H5Fget_obj_count(H5F_OBJ_ALL, H5F_OBJ_ALL);
+}
+
+int main(int argc, char* argv[])
+{
+  const std::string path = "attribute_handles.h5";
+
+  // build a small volume, then remove the Conventions attribute behind the library's back
+  {
+    polar_volume vol{path, file::io_mode::create};
+    auto scan = vol.scan_append();
+    scan.set_elevation_angle(0.5);
+    const size_t dims[2] = { 4, 8 };
+    scan.data_append("DBZH", data::data_type::u8, 2, dims);
+  }
+  {
+    auto fid = H5Fopen(path.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    CHECK(fid >= 0);
+    CHECK(H5Adelete(fid, "Conventions") >= 0);
+    CHECK(H5Fclose(fid) >= 0);
+  }
+
+  // type mismatch on a cached attribute
+  {
+    open_options options;
+    options.cache_attributes = true;
+    polar_volume vol{path, file::io_mode::read_only, options};
+    auto scan = vol.scan_open(0);
+    auto before = open_objects();
+    CHECK_THROWS(error, scan.attributes()[keys::id::elangle].get_integer());
+    CHECK(open_objects() == before);
+    CHECK(scan.elevation_angle() == 0.5);
+    CHECK(scan.data_open(0).quantity() == "DBZH");
+  }
+
+  // type mismatch and missing attribute on uncached attributes
+  {
+    polar_volume vol{path, file::io_mode::read_only};
+    auto scan = vol.scan_open(0);
+    auto before = open_objects();
+    CHECK_THROWS(error, scan.attributes()[keys::id::elangle].get_string());
+    CHECK_THROWS(error, vol.conventions());
+    CHECK(open_objects() == before);
+    CHECK(vol.scan_open(0).elevation_angle() == 0.5);
+    CHECK(vol.scan_open(0).data_open(0).quantity() == "DBZH");
+  }
+
+  // moved from stores are empty rather than invalid
+  {
+    polar_volume vol{path, file::io_mode::read_only};
+    auto scan = vol.scan_open(0);
+    auto moved = std::move(scan);
+    CHECK(moved.attributes().size() > 0);
+    CHECK(scan.attributes().size() == 0);
+    CHECK(scan.attributes().find("elangle") == scan.attributes().end());
+    CHECK(scan.attributes().find(keys::id::elangle) == scan.attributes().end());
+    scan = std::move(moved);
+    CHECK(scan.elevation_angle() == 0.5);
+  }
+
+  return EXIT_SUCCESS;
+}
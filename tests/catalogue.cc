@@ -0,0 +1,191 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <utime.h>
+
+using namespace odim_h5;
+
+/* Checks that an index can be built, queried by source and time, updated incrementally without rescanning
+ * unchanged files, and that a truncated or corrupt index is rejected when opened. */
+
+// both sources have the same length so that swapping them leaves the file size unchanged
+static const std::string aumel = "WMO:94866,NOD:aumel";
+static const std::string ausyd = "WMO:94000,NOD:ausyd";
+static const time_t t0 = 1500000000;
+
+static auto make(const std::string& path, const std::string& source, unsigned index, size_t scans) -> void
+{
+  polar_volume vol{path, file::io_mode::create};
+  synthetic::write_volume(vol, synthetic::shape{scans, 10, 20}, index * 600);
+  vol.set_source(source);
+}
+
+static auto read_bytes(const std::string& path) -> std::string
+{
+  std::ifstream in{path, std::ios::binary};
+  return std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+static auto write_bytes(const std::string& path, const std::string& bytes) -> void
+{
+  std::ofstream{path, std::ios::binary | std::ios::trunc} << bytes;
+}
+
+static auto times(const catalogue& cat, const std::vector<size_t>& hits) -> std::vector<time_t>
+{
+  std::vector<time_t> ret;
+  for (auto i : hits)
+    ret.push_back(cat.date_time(i));
+  return ret;
+}
+
+static auto entry_for(const catalogue& cat, const std::string& path) -> catalogue::record
+{
+  for (size_t i = 0; i < cat.size(); ++i)
+    if (path == cat.path(i))
+      return cat.entry(i);
+  CHECK(false);
+  return {};
+}
+
+int main(int argc, char* argv[])
+{
+  const std::string index = "catalogue.idx";
+  const size_t file_count = 6;
+
+  std::vector<std::string> paths;
+  for (unsigned i = 0; i < file_count; ++i)
+  {
+    paths.push_back("catalogue_" + std::to_string(i) + ".h5");
+    make(paths.back(), i % 2 ? aumel : ausyd, i, 2);
+  }
+  write_bytes("catalogue_notes.txt", "not an hdf5 file\n");
+
+  // initial build, unreadable and missing files are reported and skipped
+  std::remove(index.c_str());
+  {
+    auto listed = paths;
+    listed.push_back("catalogue_missing.h5");
+    listed.push_back("catalogue_notes.txt");
+    std::vector<std::string> failed;
+    catalogue::update(index, listed, &failed);
+    CHECK((failed == std::vector<std::string>{"catalogue_missing.h5", "catalogue_notes.txt"}));
+  }
+
+  catalogue cat{index};
+  CHECK(cat.size() == file_count);
+  for (size_t i = 0; i + 1 < cat.size(); ++i)
+  {
+    auto cmp = std::string{cat.source(i)}.compare(cat.source(i + 1));
+    CHECK(cmp < 0 || (cmp == 0 && cat.date_time(i) < cat.date_time(i + 1)));
+  }
+  {
+    auto rec = entry_for(cat, paths[3]);
+    CHECK(rec.object == "PVOL");
+    CHECK(rec.source == aumel);
+    CHECK(rec.date_time == t0 + 1800);
+    CHECK(rec.latitude == -37.5 && rec.longitude == 144.5 && rec.height == 50.0);
+    CHECK(rec.datasets.size() == 2);
+    CHECK(rec.datasets[1].elevation_angle == 1.5);
+    CHECK(rec.datasets[1].ray_count == 10 && rec.datasets[1].bin_count == 20);
+    CHECK((rec.datasets[1].quantities == std::vector<std::string>{"DBZH", "VRADH"}));
+    CHECK(rec.contains("VRADH", 1.5) && !rec.contains("ZDR", 1.5) && !rec.contains("DBZH", 2.5));
+  }
+
+  // find by source using either an identifier or the whole attribute, partial identifiers never match
+  CHECK((times(cat, cat.find("NOD:aumel")) == std::vector<time_t>{t0 + 600, t0 + 1800, t0 + 3000}));
+  CHECK((times(cat, cat.find("WMO:94866")) == std::vector<time_t>{t0 + 600, t0 + 1800, t0 + 3000}));
+  CHECK((times(cat, cat.find(ausyd)) == std::vector<time_t>{t0, t0 + 1200, t0 + 2400}));
+  CHECK(cat.find("NOD:aum").empty());
+  CHECK(cat.find("NOD:fianj").empty());
+
+  // find by time range, the end of the range is exclusive
+  CHECK((times(cat, cat.find(t0 + 600, t0 + 1800)) == std::vector<time_t>{t0 + 600, t0 + 1200}));
+  CHECK((times(cat, cat.find(t0, t0 + 3001)).size() == file_count));
+  CHECK(cat.find(t0 + 3001, t0 + 6000).empty());
+  CHECK((times(cat, cat.find("NOD:ausyd", t0, t0 + 1201)) == std::vector<time_t>{t0, t0 + 1200}));
+  CHECK((times(cat, cat.find("NOD:aumel", t0 + 601, t0 + 3000)) == std::vector<time_t>{t0 + 1800}));
+
+  // incremental update: a file with a new size is rescanned, one with the same size and modification time is
+  // not, a deleted file is dropped and files which are not listed are kept
+  {
+    make(paths[0], ausyd, 0, 3);
+
+    struct stat before, after;
+    CHECK(stat(paths[1].c_str(), &before) == 0);
+    make(paths[1], ausyd, 1, 2);
+    CHECK(stat(paths[1].c_str(), &after) == 0 && after.st_size == before.st_size);
+    struct utimbuf stamp{before.st_atime, before.st_mtime};
+    CHECK(utime(paths[1].c_str(), &stamp) == 0);
+
+    std::remove(paths[5].c_str());
+
+    std::vector<std::string> failed;
+    catalogue::update(index, {paths[0], paths[1], paths[5]}, &failed);
+    CHECK(failed.empty());
+  }
+  {
+    catalogue upd{index};
+    CHECK(upd.size() == file_count - 1);
+    CHECK(entry_for(upd, paths[0]).datasets.size() == 3);
+    CHECK(entry_for(upd, paths[1]).source == aumel);
+    for (size_t i = 0; i < upd.size(); ++i)
+      CHECK(paths[5] != upd.path(i));
+    for (size_t i = 2; i < 5; ++i)
+      CHECK(entry_for(upd, paths[i]).datasets.size() == 2);
+    CHECK((times(upd, upd.find("NOD:aumel")) == std::vector<time_t>{t0 + 600, t0 + 1800}));
+  }
+
+  // the index is replaced by a rename, so an index which was already open is unaffected
+  CHECK(cat.size() == file_count);
+  CHECK(entry_for(cat, paths[0]).datasets.size() == 2);
+
+  // truncated or corrupt indexes are rejected, by update as well as when opened
+  {
+    auto bytes = read_bytes(index);
+    CHECK(bytes.size() > 64);
+
+    auto corrupt = bytes;
+    corrupt[0] ^= 0x55;
+    write_bytes("catalogue_bad.idx", corrupt);
+    CHECK_THROWS(error, catalogue{"catalogue_bad.idx"});
+    CHECK_THROWS(error, catalogue::update("catalogue_bad.idx", {paths[0]}));
+
+    write_bytes("catalogue_bad.idx", bytes.substr(0, bytes.size() / 2));
+    CHECK_THROWS(error, catalogue{"catalogue_bad.idx"});
+
+    write_bytes("catalogue_bad.idx", bytes.substr(0, 8));
+    CHECK_THROWS(error, catalogue{"catalogue_bad.idx"});
+
+    write_bytes("catalogue_bad.idx", "");
+    CHECK_THROWS(error, catalogue{"catalogue_bad.idx"});
+
+    CHECK_THROWS(error, catalogue{"catalogue_missing.idx"});
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// minimal self-checking support shared by the test programs, a failed check reports and exits non-zero
+#define CHECK(expr) \
+  do \
+  { \
+    if (!(expr)) \
+    { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while (false)
+
+// check that an expression throws an exception derived from T
+#define CHECK_THROWS(T, expr) \
+  do \
+  { \
+    bool thrown_ = false; \
+    try { expr; } catch (const T&) { thrown_ = true; } \
+    if (!thrown_) \
+    { \
+      fprintf(stderr, "%s:%d: expected exception: %s\n", __FILE__, __LINE__, #expr); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while (false)
@@ -0,0 +1,165 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "../odim_h5.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace odim_h5;
+
+/* Packed values must match a plain scalar reference bit for bit, whichever kernel variant runs.  In particular
+ * a real value must never be written as the undetect or nodata code, even when the codes lie in the middle of
+ * the storage range.  Each case packs a sweep of real values which crosses both codes and both ends of the
+ * range, compares the stored codes with the reference and checks that every real value unpacks as real. */
+
+static const double undetect_flag = -1.0e30;
+static const double nodata_flag = 1.0e30;
+
+// nearest code to a reserved one on the given side which is neither reserved nor outside the type
+template <typename S>
+static auto free_code(S code, bool up, S ud, S nd) -> S
+{
+  for (int pass = 0; pass < 2; ++pass, up = !up)
+  {
+    for (long long c = code; ; )
+    {
+      c += up ? 1 : -1;
+      if (c < std::numeric_limits<S>::lowest() || c > std::numeric_limits<S>::max())
+        break;
+      if (c != ud && c != nd)
+        return static_cast<S>(c);
+    }
+  }
+  return code;
+}
+
+template <typename T, typename S>
+static auto reference(const std::vector<T>& vals, double a, double b, S ud, S nd) -> std::vector<S>
+{
+  // reserved codes at the ends of the type are removed from the saturation range
+  double lo = std::numeric_limits<S>::lowest(), hi = std::numeric_limits<S>::max();
+  while (lo == ud || lo == nd)
+    ++lo;
+  while (hi == ud || hi == nd)
+    --hi;
+
+  std::vector<S> out(vals.size());
+  for (size_t i = 0; i < vals.size(); ++i)
+  {
+    if (vals[i] == T(undetect_flag))
+      out[i] = ud;
+    else if (vals[i] == T(nodata_flag))
+      out[i] = nd;
+    else
+    {
+      volatile double x = (vals[i] - b) / a;
+      auto r = static_cast<S>(std::nearbyint(std::isnan(x) ? lo : std::min(std::max(double(x), lo), hi)));
+      if (r == ud || r == nd)
+        r = free_code(r, !(x < r), ud, nd);
+      out[i] = r;
+    }
+  }
+  return out;
+}
+
+template <typename T, typename S>
+static auto check_case(dataset& dset, data::data_type type, double a, double b, S ud, S nd) -> void
+{
+  // step through the whole range in fractions of a code so that ties and both reserved codes are crossed
+  const double lowest = std::numeric_limits<S>::lowest(), highest = std::numeric_limits<S>::max();
+  std::vector<T> vals;
+  for (double c = lowest - 3.0; c <= std::min(highest, lowest + 70000.0) + 3.0; c += 0.25)
+    vals.push_back(static_cast<T>(c * a + b));
+  for (double c = ud - 2.0; c <= ud + 2.0; c += 0.125)
+    vals.push_back(static_cast<T>(c * a + b));
+  for (double c = nd - 2.0; c <= nd + 2.0; c += 0.125)
+    vals.push_back(static_cast<T>(c * a + b));
+  vals.push_back(std::numeric_limits<T>::quiet_NaN());
+  vals.push_back(T(undetect_flag));
+  vals.push_back(T(nodata_flag));
+
+  const size_t dims[1] = { vals.size() };
+  auto layer = dset.data_append(type, 1, dims);
+  layer.set_gain(a);
+  layer.set_offset(b);
+  layer.set_undetect(ud);
+  layer.set_nodata(nd);
+  layer.write_pack(
+        vals.data()
+      , [](T v) { return v == T(undetect_flag); }
+      , [](T v) { return v == T(nodata_flag); });
+
+  std::vector<S> stored(vals.size());
+  layer.read(stored.data());
+  auto expected = reference(vals, a, b, ud, nd);
+  CHECK(memcmp(stored.data(), expected.data(), stored.size() * sizeof(S)) == 0);
+
+  // only the flagged values may come back as undetect or nodata
+  std::vector<double> unpacked(vals.size());
+  layer.read_unpack(unpacked.data(), undetect_flag, nodata_flag);
+  for (size_t i = 0; i < vals.size(); ++i)
+  {
+    CHECK((unpacked[i] == undetect_flag) == (vals[i] == T(undetect_flag)));
+    CHECK((unpacked[i] == nodata_flag) == (vals[i] == T(nodata_flag)));
+  }
+}
+
+template <typename T>
+static auto check_input(dataset& dset) -> void
+{
+  // reserved codes at the ends of the range
+  check_case<T, uint8_t>(dset, data::data_type::u8, 0.5, -32.0, 0, 255);
+  check_case<T, uint16_t>(dset, data::data_type::u16, 0.01, -327.68, 0, 65535);
+
+  // reserved codes in the middle of the range
+  check_case<T, int16_t>(dset, data::data_type::i16, 0.1, 1.0, 0, -32768);
+  check_case<T, uint8_t>(dset, data::data_type::u8, 0.5, -32.0, 100, 101);
+  check_case<T, int16_t>(dset, data::data_type::i16, 0.25, 0.0, -5, 7);
+  check_case<T, int32_t>(dset, data::data_type::i32, 0.001, 0.0, 0, 1);
+}
+
+int main(int argc, char* argv[])
+{
+  polar_volume vol{"pack_values.h5", file::io_mode::create};
+  auto dset = vol.scan_append();
+  dset.set_elevation_angle(0.5);
+
+  check_input<float>(dset);
+  check_input<double>(dset);
+
+  // the case from the original report, a real value of exactly the offset must not become undetect
+  {
+    const size_t dims[1] = { 1 };
+    auto layer = dset.data_append(data::data_type::i16, 1, dims);
+    layer.set_gain(0.1);
+    layer.set_offset(1.0);
+    layer.set_undetect(0);
+    layer.set_nodata(-32768);
+    const double val = 1.0;
+    layer.write_pack(&val, [](double) { return false; }, [](double) { return false; });
+    int16_t code;
+    layer.read(&code);
+    CHECK(code == 1);
+  }
+
+  return EXIT_SUCCESS;
+}
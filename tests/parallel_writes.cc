@@ -0,0 +1,136 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace odim_h5;
+
+/* Layers written by write_parallel and write_packed_parallel compress their chunks outside of HDF5, so the
+ * stored chunks must be exactly what the standard deflate and shuffle filters would accept.  Each case
+ * writes a layer whose dimensions are not a multiple of the chunk shape (so the edge chunks are partial),
+ * closes the file and reads it back through the normal HDF5 filter pipeline, comparing exactly. */
+
+static const size_t dims[2] = { 361, 997 };
+
+static auto layouts() -> std::vector<chunk_layout>
+{
+  static const size_t odd[2] = { 7, 130 };
+  return
+  {
+      chunk_layout{chunk_layout::access_pattern::ray_major}
+    , chunk_layout{chunk_layout::access_pattern::tile}
+    , chunk_layout{2, odd}
+  };
+}
+
+static auto policies() -> std::vector<compression_policy>
+{
+  return
+  {
+      compression_policy{compression_policy::codec::deflate, 6, false}
+    , compression_policy{compression_policy::codec::deflate, 1, true}
+    , compression_policy{compression_policy::codec::deflate, 9, true}
+  };
+}
+
+template <typename T>
+static auto values(unsigned seed) -> std::vector<T>
+{
+  return synthetic::pattern<T>(seed, dims[0], dims[1], seed, std::numeric_limits<T>::max());
+}
+
+static auto reals(unsigned seed) -> std::vector<float>
+{
+  std::vector<float> vals(dims[0] * dims[1]);
+  for (size_t i = 0; i < vals.size(); ++i)
+    vals[i] = static_cast<float>((i * (seed + 7)) % 1000) * 0.125f - 40.0f;
+  return vals;
+}
+
+template <typename T>
+static auto check_read(const data& layer, const std::vector<T>& expected) -> void
+{
+  std::vector<T> vals(layer.size());
+  layer.read(vals.data());
+  CHECK(vals == expected);
+}
+
+int main(int argc, char* argv[])
+{
+  const std::string path = "parallel_writes.h5";
+
+  std::vector<std::vector<uint8_t>> u8;
+  std::vector<std::vector<uint16_t>> u16;
+  std::vector<std::vector<float>> f32;
+
+  // one layer of each storage type for every combination, written alone or as a batch
+  {
+    polar_volume vol{path, file::io_mode::create};
+    auto scn = vol.scan_append();
+    scn.set_elevation_angle(0.5);
+    unsigned seed = 0;
+    for (auto& layout : layouts())
+    {
+      for (auto& policy : policies())
+      {
+        u8.push_back(values<uint8_t>(++seed));
+        scn.data_append(data::data_type::u8, 2, dims, policy, layout).write_parallel(u8.back().data(), 3);
+
+        u16.push_back(values<uint16_t>(++seed));
+        scn.data_append(data::data_type::u16, 2, dims, policy, layout).write_parallel(u16.back().data(), 3);
+
+        f32.push_back(reals(++seed));
+        scn.data_append(data::data_type::f32, 2, dims, policy, layout).write_parallel(f32.back().data(), 3);
+
+        // the same values again through a single batch
+        auto a = scn.data_append(data::data_type::u8, 2, dims, policy, layout);
+        auto b = scn.data_append(data::data_type::u16, 2, dims, policy, layout);
+        auto c = scn.data_append(data::data_type::f32, 2, dims, policy, layout);
+        const data::packed_layer batch[] =
+        {
+            { &a, u8.back().data() }
+          , { &b, u16.back().data() }
+          , { &c, f32.back().data() }
+        };
+        data::write_packed_parallel(batch, 3, 2);
+      }
+    }
+  }
+
+  // read back through the HDF5 filters, in the order written
+  polar_volume vol{path, file::io_mode::read_only};
+  auto scn = vol.scan_open(0);
+  CHECK(scn.data_count() == u8.size() * 6);
+  for (size_t i = 0; i < u8.size(); ++i)
+  {
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+      auto base = i * 6 + pass * 3;
+      check_read(scn.data_open(base), u8[i]);
+      check_read(scn.data_open(base + 1), u16[i]);
+      check_read(scn.data_open(base + 2), f32[i]);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace odim_h5;
+
+/* Checks that the process loader delivers every file exactly once with the same values as an in-process
+ * decode, isolates missing files, survives workers being killed, leaves children of the host process
+ * which it did not create alone, refuses to fork from a multithreaded process and stops the library's own
+ * idle threads itself. */
+
+#ifdef __linux__
+// kill every child of this process, which at the point of use are only the loader's workers
+static auto kill_workers() -> void
+{
+  std::ifstream children{"/proc/self/task/" + std::to_string(getpid()) + "/children"};
+  pid_t pid;
+  while (children >> pid)
+    kill(pid, SIGKILL);
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifdef __linux__
+  const synthetic::shape shp{2, 90, 120};
+  const size_t file_count = 6;
+
+  std::vector<std::string> paths;
+  std::vector<double> reference;
+  for (size_t i = 0; i < file_count; ++i)
+  {
+    paths.push_back("process_loader_" + std::to_string(i) + ".h5");
+    {
+      polar_volume vol{paths.back(), file::io_mode::create};
+      synthetic::write_volume(vol, shp, i);
+    }
+    reference.push_back(synthetic::checksum(file{paths.back(), file::io_mode::read_only}));
+  }
+  paths.push_back("process_loader_missing.h5");
+
+  // a child of the host which has already exited, its status must still be available afterwards
+  auto other = fork();
+  CHECK(other >= 0);
+  if (other == 0)
+    _exit(7);
+  usleep(10000);
+
+  process_loader::settings config;
+  config.workers = 3;
+  config.slots = 2;
+  config.slot_bytes = 4 << 20;
+  config.undetect = 0.0f;
+  config.nodata = 0.0f;
+  std::vector<size_t> seen(paths.size(), 0);
+  process_loader{config}.load(paths, [&](const process_loader::result& res)
+  {
+    CHECK(res.index < paths.size());
+    ++seen[res.index];
+    if (res.index == file_count)
+    {
+      CHECK(res.error != nullptr);
+      return;
+    }
+    CHECK(res.error == nullptr);
+    CHECK(res.layers.size() == shp.scans * 2);
+    double sum = 0.0;
+    for (auto& layer : res.layers)
+      for (size_t i = 0; i < layer.rows * layer.cols; ++i)
+        sum += layer.values[i];
+    CHECK(sum == reference[res.index]);
+  });
+  for (auto n : seen)
+    CHECK(n == 1);
+
+  int status = 0;
+  CHECK(waitpid(other, &status, 0) == other);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 7);
+
+  // workers killed at arbitrary points must neither lose a file nor stall the remaining workers
+  for (int round = 0; round < 4; ++round)
+  {
+    std::vector<size_t> delivered(paths.size(), 0);
+    process_loader{config}.load(paths, [&](const process_loader::result& res)
+    {
+      ++delivered[res.index];
+      if (res.index % 2 == size_t(round % 2))
+        kill_workers();
+    });
+    for (auto n : delivered)
+      CHECK(n == 1);
+  }
+
+  // forking while another thread is running is refused
+  {
+    std::promise<void> release;
+    std::thread busy{[&] { release.get_future().wait(); }};
+    CHECK_THROWS(error, process_loader{config}.load(paths, [](const process_loader::result&) { }));
+    release.set_value();
+    busy.join();
+  }
+
+  // the idle threads kept by the library after parallel and asynchronous calls do not prevent a load
+  {
+    set_thread_safe(true);
+    polar_volume vol{paths[0], file::io_mode::read_only};
+    auto layer = vol.scan_open(0).data_open(0);
+    std::vector<float> vals(layer.size());
+    layer.read_unpack_parallel(vals.data(), 0.0f, 0.0f, 2);
+    layer.read_unpack_async(vals.data(), 0.0f, 0.0f).get();
+    set_thread_safe(false);
+
+    size_t delivered = 0;
+    process_loader{config}.load(paths, [&](const process_loader::result&) { ++delivered; });
+    CHECK(delivered == paths.size());
+
+    // and they start again when next needed
+    std::vector<float> again(layer.size());
+    layer.read_unpack_parallel(again.data(), 0.0f, 0.0f, 2);
+    CHECK(again == vals);
+  }
+#endif
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <hdf5.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace odim_h5;
+
+/* Checks that a sweep_reader returns exactly what read_unpack gives for every scan, that it reads ahead
+ * no further than its lookahead and max_bytes bounds allow, that cancel() ends iteration, and that an error
+ * is only thrown once every scan decoded before it has been returned.
+ *
+ * The read ahead bounds are observed by letting the reader settle, then overwriting every layer through
+ * the same volume.  Scans decoded before the overwrite still hold the old values while later scans hold
+ * the new ones, which shows exactly how far ahead the reader went. */
+
+static const synthetic::shape shp{6, 90, 120};
+static const size_t scan_bytes = shp.rays * shp.bins * 2 * sizeof(float);
+
+static auto identical(const std::vector<float>& lhs, const std::vector<float>& rhs) -> bool
+{
+  return lhs.size() == rhs.size() && memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(float)) == 0;
+}
+
+static auto unpacked(const data& layer) -> std::vector<float>
+{
+  std::vector<float> vals(layer.size());
+  layer.read_unpack(vals.data(), -1.0f, NAN);
+  return vals;
+}
+
+static auto settings_for(size_t lookahead, size_t max_bytes) -> sweep_reader::settings
+{
+  sweep_reader::settings config;
+  config.lookahead = lookahead;
+  config.max_bytes = max_bytes;
+  config.undetect = -1.0f;
+  return config;
+}
+
+static auto create(const std::string& path) -> void
+{
+  polar_volume vol{path, file::io_mode::create};
+  synthetic::write_volume(vol, shp, 1);
+}
+
+// every scan and layer matches read_unpack, optionally restricted to some quantities
+static auto check_values(const std::string& path) -> void
+{
+  polar_volume vol{path, file::io_mode::read_only};
+  for (int filtered = 0; filtered < 2; ++filtered)
+  {
+    auto config = settings_for(2, scan_bytes);
+    if (filtered)
+      config.quantities.push_back("VRADH");
+    sweep_reader reader{vol, config};
+    sweep_reader::sweep sw;
+    size_t count = 0;
+    while (reader.next(sw))
+    {
+      auto scan = vol.scan_open(count);
+      CHECK(sw.index == count);
+      CHECK(sw.elevation == scan.elevation_angle());
+      CHECK(sw.layers.size() == (filtered ? 1 : scan.data_count()));
+      for (auto& l : sw.layers)
+      {
+        auto layer = scan.data_open(l.index);
+        CHECK(l.quantity == layer.quantity());
+        CHECK(!filtered || l.quantity == "VRADH");
+        CHECK(l.rows == shp.rays && l.cols == shp.bins);
+        CHECK(identical(l.values, unpacked(layer)));
+      }
+      ++count;
+    }
+    CHECK(count == shp.scans);
+  }
+}
+
+// count the scans which were decoded before their layers were overwritten
+static auto scans_read_ahead(const std::string& path, size_t lookahead, size_t max_bytes) -> size_t
+{
+  create(path);
+  polar_volume vol{path, file::io_mode::read_write};
+  sweep_reader reader{vol, settings_for(lookahead, max_bytes)};
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  std::vector<std::vector<float>> before;
+  for (size_t s = 0; s < shp.scans; ++s)
+  {
+    auto scan = vol.scan_open(s);
+    before.push_back(unpacked(scan.data_open(0)));
+    scan.data_open(0).write(std::vector<uint8_t>(shp.rays * shp.bins, 42).data());
+  }
+
+  size_t early = 0;
+  sweep_reader::sweep sw;
+  while (reader.next(sw))
+  {
+    auto stale = identical(sw.layers[0].values, before[sw.index]);
+    // once a scan holds the new values so must every later one
+    CHECK(!stale || sw.index == early);
+    early += stale;
+  }
+  return early;
+}
+
+static auto check_cancel(const std::string& path) -> void
+{
+  polar_volume vol{path, file::io_mode::read_only};
+
+  // cancelling between scans ends iteration
+  {
+    sweep_reader reader{vol, settings_for(1, scan_bytes)};
+    sweep_reader::sweep sw;
+    CHECK(reader.next(sw));
+    reader.cancel();
+    CHECK(!reader.next(sw));
+  }
+
+  // cancelling from another thread while the caller waits in next()
+  for (int round = 0; round < 20; ++round)
+  {
+    sweep_reader reader{vol, settings_for(1, scan_bytes)};
+    std::thread canceller{[&]
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100 * round));
+      reader.cancel();
+    }};
+    sweep_reader::sweep sw;
+    size_t count = 0;
+    while (reader.next(sw))
+      ++count;
+    canceller.join();
+    CHECK(count <= shp.scans);
+    CHECK(!reader.next(sw));
+  }
+}
+
+static auto check_error_order(const std::string& path) -> void
+{
+  // break the third scan behind the library's back
+  create(path);
+  {
+    auto fid = H5Fopen(path.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    CHECK(fid >= 0);
+    CHECK(H5Ldelete(fid, "/dataset3/data1/data", H5P_DEFAULT) >= 0);
+    CHECK(H5Fclose(fid) >= 0);
+  }
+
+  polar_volume vol{path, file::io_mode::read_only};
+  sweep_reader reader{vol, settings_for(4, scan_bytes * 4)};
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  sweep_reader::sweep sw;
+  CHECK(reader.next(sw) && sw.index == 0);
+  CHECK(reader.next(sw) && sw.index == 1);
+  CHECK_THROWS(error, reader.next(sw));
+  CHECK(!reader.next(sw));
+}
+
+int main(int argc, char* argv[])
+{
+  const std::string path = "sweep_reader.h5";
+  set_thread_safe(true);
+
+  create(path);
+  check_values(path);
+
+  // the reader waits with at most lookahead scans decoded, or one scan when max_bytes is reached first
+  CHECK(scans_read_ahead("sweep_reader_lookahead.h5", 2, scan_bytes * shp.scans) == 2);
+  CHECK(scans_read_ahead("sweep_reader_bytes.h5", shp.scans, scan_bytes + scan_bytes / 2) == 1);
+  CHECK(scans_read_ahead("sweep_reader_bytes.h5", shp.scans, scan_bytes * 3) == 3);
+
+  check_cancel(path);
+  check_error_order("sweep_reader_error.h5");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#pragma once
+
+#include "../odim_h5.h"
+
+#include <cstdint>
+#include <vector>
+
+// generation of synthetic polar volumes shared by the test and benchmark programs
+namespace synthetic
+{
+  /// Shape of a synthetic volume
+  struct shape
+  {
+    size_t  scans;
+    size_t  rays;
+    size_t  bins;
+  };
+
+  /// Fill a layer with a deterministic pattern which includes undetect and nodata codes
+  template <typename T>
+  inline auto pattern(size_t scan, size_t rays, size_t bins, unsigned seed, T max) -> std::vector<T>
+  {
+    std::vector<T> vals(rays * bins);
+    uint32_t state = seed * 2654435761u + scan * 40503u + 1;
+    for (size_t i = 0; i < vals.size(); ++i)
+    {
+      state = state * 1664525u + 1013904223u;
+      // roughly 10% undetect (0) and 2% nodata (max), smooth values otherwise
+      auto r = (state >> 8) % 100;
+      vals[i] = r < 10 ? 0 : r < 12 ? max : static_cast<T>(1 + (i % bins + i / bins + (state >> 24)) % (max - 1));
+    }
+    return vals;
+  }
+
+  /// Write a volume of u8 DBZH and u16 VRADH layers
+  inline auto write_volume(
+        odim_h5::polar_volume& vol
+      , const shape& shp
+      , unsigned seed
+      , const odim_h5::compression_policy& compression = odim_h5::data::default_compression
+      ) -> void
+  {
+    using namespace odim_h5;
+    vol.set_source("WMO:94000");
+    vol.set_date_time(1500000000 + seed);
+    vol.set_latitude(-37.5);
+    vol.set_longitude(144.5);
+    vol.set_height(50.0);
+    const size_t dims[2] = { shp.rays, shp.bins };
+    for (size_t s = 0; s < shp.scans; ++s)
+    {
+      auto scan = vol.scan_append();
+      scan.set_elevation_angle(0.5 + s);
+      scan.set_ray_count(shp.rays);
+      scan.set_bin_count(shp.bins);
+      scan.set_range_start(0.0);
+      scan.set_range_scale(250.0);
+      scan.set_start_date_time(1500000000 + seed + s * 30);
+      scan.set_end_date_time(1500000000 + seed + s * 30 + 25);
+
+      auto dbz = scan.data_append("DBZH", data::data_type::u8, 2, dims, compression);
+      dbz.set_gain(0.5);
+      dbz.set_offset(-32.0);
+      dbz.set_undetect(0);
+      dbz.set_nodata(255);
+      dbz.write(pattern<uint8_t>(s, shp.rays, shp.bins, seed, 255).data());
+
+      auto vel = scan.data_append("VRADH", data::data_type::u16, 2, dims, compression);
+      vel.set_gain(0.01);
+      vel.set_offset(-327.68);
+      vel.set_undetect(0);
+      vel.set_nodata(65535);
+      vel.write(pattern<uint16_t>(s, shp.rays, shp.bins, seed + 1, 65535).data());
+    }
+  }
+
+  /// Sum every unpacked value of a file (undetect and nodata map to 0)
+  inline auto checksum(const odim_h5::file& f) -> double
+  {
+    double sum = 0.0;
+    std::vector<float> vals;
+    for (size_t i = 0; i < f.dataset_count(); ++i)
+    {
+      auto dset = f.dataset_open(i);
+      for (size_t j = 0; j < dset.data_count(); ++j)
+      {
+        auto layer = dset.data_open(j);
+        vals.resize(layer.size());
+        layer.read_unpack(vals.data(), 0.0f, 0.0f);
+        for (auto v : vals)
+          sum += v;
+      }
+    }
+    return sum;
+  }
+}
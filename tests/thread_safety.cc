@@ -0,0 +1,104 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace odim_h5;
+
+/* Stress test of thread safe mode.  Several threads concurrently read volumes through their own file
+ * objects, through one shared file object with an object cache, and create, write and read back in-memory
+ * volumes.  Every result must match the value computed single threaded and no call may fail. */
+
+int main(int argc, char* argv[])
+{
+  set_thread_safe(true);
+  CHECK(thread_safe());
+
+  const synthetic::shape shp{3, 360, 400};
+  const size_t file_count = 4;
+  const size_t thread_count = 8;
+  const size_t iterations = 12;
+
+  std::vector<std::string> paths;
+  std::vector<double> reference;
+  for (size_t i = 0; i < file_count; ++i)
+  {
+    paths.push_back("thread_safety_" + std::to_string(i) + ".h5");
+    {
+      polar_volume vol{paths.back(), file::io_mode::create};
+      synthetic::write_volume(vol, shp, i);
+    }
+    reference.push_back(synthetic::checksum(file{paths.back(), file::io_mode::read_only}));
+  }
+
+  open_options cached;
+  cached.object_cache_ids = 16;
+  file shared{paths[0], file::io_mode::read_only, cached};
+
+  std::atomic<size_t> failures{0}, completed{0};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_count; ++t)
+  {
+    threads.emplace_back([&, t]
+    {
+      try
+      {
+        for (size_t i = 0; i < iterations; ++i)
+        {
+          auto k = (t + i) % file_count;
+          switch ((t + i) % 3)
+          {
+          case 0:
+            if (synthetic::checksum(shared) != reference[0])
+              ++failures;
+            break;
+          case 1:
+            if (synthetic::checksum(file{paths[k], file::io_mode::read_only}) != reference[k])
+              ++failures;
+            break;
+          case 2:
+            {
+              polar_volume vol{nullptr, 0, file::io_mode::create};
+              synthetic::write_volume(vol, shp, k);
+              auto img = vol.image();
+              if (synthetic::checksum(file{img.data(), img.size(), file::io_mode::read_only}) != reference[k])
+                ++failures;
+            }
+            break;
+          }
+          ++completed;
+        }
+      }
+      catch (std::exception& err)
+      {
+        fprintf(stderr, "thread %zu: %s\n", t, err.what());
+        ++failures;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  CHECK(failures == 0);
+  CHECK(completed == thread_count * iterations);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "../odim_h5.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace odim_h5;
+
+/* The unpacking kernels are compiled for several instruction sets and the best one is chosen at load time,
+ * while 8 and 16 bit layers may also be decoded through lookup tables.  Every path must give bit identical
+ * results to a plain scalar loop.  Each case writes a layer containing every kind of code, then compares
+ * all the ways of unpacking it against a scalar reference built from the raw values.  Each layer is stored
+ * as a single chunk and in several multi-chunk layouts whose edge chunks are partial, so that the parallel
+ * reads scatter chunks into the output.  The layer size is deliberately not a multiple of any vector width
+ * so that the loop remainders are covered too. */
+
+static const size_t dims[2] = { 361, 997 };
+
+static auto layouts() -> std::vector<chunk_layout>
+{
+  static const size_t odd[2] = { 7, 130 };
+  return
+  {
+      chunk_layout{chunk_layout::access_pattern::whole}
+    , chunk_layout{chunk_layout::access_pattern::ray_major}
+    , chunk_layout{chunk_layout::access_pattern::tile}
+    , chunk_layout{2, odd}
+  };
+}
+
+// scalar reference, the volatile keeps the multiply and add separate just as the library build does
+template <typename S, typename T>
+static auto reference(const std::vector<S>& raw, double a, double b, S ud, S nd, T undetect, T nodata) -> std::vector<T>
+{
+  std::vector<T> out(raw.size());
+  for (size_t i = 0; i < raw.size(); ++i)
+  {
+    volatile double scaled = a * raw[i];
+    out[i] = raw[i] == nd ? nodata : raw[i] == ud ? undetect : static_cast<T>(scaled + b);
+  }
+  return out;
+}
+
+template <typename T>
+static auto identical(const std::vector<T>& lhs, const std::vector<T>& rhs) -> bool
+{
+  return lhs.size() == rhs.size() && memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(T)) == 0;
+}
+
+template <typename S, typename T>
+static auto check_outputs(const data& layer, double a, double b, S ud, S nd, T undetect, T nodata) -> void
+{
+  std::vector<S> raw(layer.size());
+  layer.read(raw.data());
+  auto expected = reference(raw, a, b, ud, nd, undetect, nodata);
+
+  std::vector<S> raw_parallel(layer.size());
+  layer.read_parallel(raw_parallel.data(), 3);
+  CHECK(identical(raw_parallel, raw));
+
+  const data::decode_strategy strategies[] =
+  {
+      data::decode_strategy::automatic
+    , data::decode_strategy::arithmetic
+    , data::decode_strategy::lookup
+  };
+  for (auto strategy : strategies)
+  {
+    std::vector<T> out(layer.size());
+    layer.read_unpack(out.data(), undetect, nodata, strategy);
+    CHECK(identical(out, expected));
+
+    std::fill(out.begin(), out.end(), T(0));
+    layer.read_unpack_parallel(out.data(), undetect, nodata, 3, strategy);
+    CHECK(identical(out, expected));
+  }
+}
+
+template <typename S>
+static auto check_layer(scan& scn, data::data_type type, const std::vector<S>& vals, double a, double b, S ud, S nd) -> void
+{
+  for (auto& layout : layouts())
+  {
+    auto layer = scn.data_append(type, 2, dims, data::default_compression, layout);
+    layer.set_gain(a);
+    layer.set_offset(b);
+    layer.set_undetect(ud);
+    layer.set_nodata(nd);
+    layer.write(vals.data());
+
+    check_outputs<S, float>(layer, a, b, ud, nd, -1.0f, NAN);
+    check_outputs<S, double>(layer, a, b, ud, nd, NAN, -999.0);
+  }
+}
+
+// cycle through every code of an integer type so that undetect, nodata and both extremes all appear
+template <typename S>
+static auto integer_codes() -> std::vector<S>
+{
+  std::vector<S> vals(dims[0] * dims[1]);
+  for (size_t i = 0; i < vals.size(); ++i)
+    vals[i] = static_cast<S>(i * 7919u);
+  vals[0] = std::numeric_limits<S>::min();
+  vals[1] = std::numeric_limits<S>::max();
+  return vals;
+}
+
+int main(int argc, char* argv[])
+{
+  polar_volume vol{"unpack_kernels.h5", file::io_mode::create};
+  auto scn = vol.scan_append();
+  scn.set_elevation_angle(0.5);
+
+  check_layer<uint8_t>(scn, data::data_type::u8, integer_codes<uint8_t>(), 0.5, -32.0, 0, 255);
+  check_layer<uint16_t>(scn, data::data_type::u16, integer_codes<uint16_t>(), 0.01, -327.68, 0, 65535);
+  check_layer<int16_t>(scn, data::data_type::i16, integer_codes<int16_t>(), 0.1, 1.0, 0, -32768);
+
+  // real valued storage, with the codes mixed through values which don't scale exactly
+  std::vector<float> reals(dims[0] * dims[1]);
+  for (size_t i = 0; i < reals.size(); ++i)
+    reals[i] = i % 11 == 0 ? -9999.0f : i % 13 == 0 ? -8888.0f : static_cast<float>(i) * 0.37f - 500.0f;
+  check_layer<float>(scn, data::data_type::f32, reals, 0.3, 0.1, -8888.0f, -9999.0f);
+
+  // 32 bit storage takes the path where HDF5 converts to the output type before unpacking
+  check_layer<int32_t>(scn, data::data_type::i32, integer_codes<int32_t>(), 0.001, -5.0, 0, -1);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/*------------------------------------------------------------------------------
+ * ODIM (HDF5 format) Support Library
+ *
+ * Copyright 2016 Commonwealth of Australia, Bureau of Meteorology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *----------------------------------------------------------------------------*/
+#include "check.h"
+#include "synthetic.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace odim_h5;
+
+/* Checks that a volume written through a volume_writer reads back exactly, that calls capturing values
+ * block while the memory limit is reached, and that the first error raised on the background thread is
+ * thrown by every later call (including flush() and close()) while the operations queued behind it are
+ * discarded. */
+
+static const size_t rays = 360;
+static const size_t bins = 100;
+
+// real values which pack exactly using a gain of 0.5 and offset of -32, with flagged values mixed in
+static auto reals(size_t scan) -> std::vector<double>
+{
+  auto codes = synthetic::pattern<uint8_t>(scan, rays, bins, 3, 255);
+  std::vector<double> vals(codes.size());
+  for (size_t i = 0; i < codes.size(); ++i)
+    vals[i] = codes[i] == 0 ? -1000.0 : codes[i] == 255 ? 1000.0 : codes[i] * 0.5 - 32.0;
+  return vals;
+}
+
+static auto is_undetect(double v) -> bool { return v == -1000.0; }
+static auto is_nodata(double v) -> bool { return v == 1000.0; }
+
+static auto write_and_read_back() -> void
+{
+  const std::string path = "volume_writer.h5";
+  const size_t dims[2] = { rays, bins };
+  const size_t scans = 3;
+
+  {
+    volume_writer::settings config;
+    config.max_bytes = rays * bins * sizeof(uint16_t) + 1000;
+    volume_writer writer{path, config};
+    writer.set_attribute(volume_writer::npos, volume_writer::npos, "source", "WMO:94000");
+    for (size_t s = 0; s < scans; ++s)
+    {
+      auto scan = writer.scan_append();
+      writer.set_attribute(scan, volume_writer::npos, "elangle", 0.5 + s);
+
+      auto raw = writer.data_append(scan, "VRADH", data::data_type::u16, 2, dims);
+      writer.set_attribute(scan, raw, "gain", 0.01);
+      writer.write(scan, raw, synthetic::pattern<uint16_t>(s, rays, bins, 1, 65535));
+
+      auto packed = writer.data_append(scan, "DBZH", data::data_type::u8, 2, dims);
+      writer.set_attribute(scan, packed, "gain", 0.5);
+      writer.set_attribute(scan, packed, "offset", -32.0);
+      writer.set_attribute(scan, packed, "undetect", 0.0);
+      writer.set_attribute(scan, packed, "nodata", 255.0);
+      writer.write_pack(scan, packed, reals(s), is_undetect, is_nodata);
+    }
+
+    // hold the background thread so that captured values pile up against the memory limit
+    std::promise<void> gate;
+    auto opened = gate.get_future().share();
+    writer.defer([opened](polar_volume&) { opened.wait(); });
+    writer.write(0, 0, synthetic::pattern<uint16_t>(0, rays, bins, 1, 65535));
+
+    std::atomic<bool> returned{false};
+    std::thread blocked{[&]
+    {
+      writer.write(1, 0, synthetic::pattern<uint16_t>(1, rays, bins, 1, 65535));
+      returned = true;
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(!returned);
+    gate.set_value();
+    blocked.join();
+    CHECK(returned);
+
+    writer.flush();
+    writer.close();
+  }
+
+  polar_volume vol{path, file::io_mode::read_only};
+  CHECK(vol.source() == "WMO:94000");
+  CHECK(vol.scan_count() == scans);
+  for (size_t s = 0; s < scans; ++s)
+  {
+    auto scan = vol.scan_open(s);
+    CHECK(scan.elevation_angle() == 0.5 + s);
+    CHECK(scan.data_count() == 2);
+
+    auto raw = scan.data_open(0);
+    CHECK(raw.quantity() == "VRADH");
+    CHECK(raw.gain() == 0.01);
+    std::vector<uint16_t> u16(raw.size());
+    raw.read(u16.data());
+    CHECK(u16 == synthetic::pattern<uint16_t>(s, rays, bins, 1, 65535));
+
+    auto packed = scan.data_open(1);
+    CHECK(packed.quantity() == "DBZH");
+    std::vector<uint8_t> u8(packed.size());
+    packed.read(u8.data());
+    CHECK(u8 == synthetic::pattern<uint8_t>(s, rays, bins, 3, 255));
+  }
+}
+
+static auto failure_is_sticky() -> void
+{
+  volume_writer writer{"volume_writer_failure.h5"};
+  writer.scan_append();
+  writer.defer([](polar_volume&) { throw std::runtime_error{"deferred failure"}; });
+
+  // queued behind the failure, so it must never run
+  std::atomic<bool> ran{false};
+  writer.defer([&](polar_volume&) { ran = true; });
+
+  auto thrown = [](const std::exception& err) { return strstr(err.what(), "deferred failure") != nullptr; };
+  try
+  {
+    writer.flush();
+    CHECK(false);
+  }
+  catch (const std::exception& err)
+  {
+    CHECK(thrown(err));
+  }
+  try
+  {
+    writer.scan_append();
+    CHECK(false);
+  }
+  catch (const std::exception& err)
+  {
+    CHECK(thrown(err));
+  }
+  try
+  {
+    writer.close();
+    CHECK(false);
+  }
+  catch (const std::exception& err)
+  {
+    CHECK(thrown(err));
+  }
+  CHECK(!ran);
+}
+
+static auto failure_surfaces_from_close() -> void
+{
+  volume_writer writer{"volume_writer_close.h5"};
+  writer.defer([](polar_volume&) { throw std::runtime_error{"deferred failure"}; });
+  CHECK_THROWS(std::runtime_error, writer.close());
+}
+
+int main(int argc, char* argv[])
+{
+  write_and_read_back();
+  failure_is_sticky();
+  failure_surfaces_from_close();
+  return EXIT_SUCCESS;
+}